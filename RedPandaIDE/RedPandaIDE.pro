@@ -1,4 +1,4 @@
-QT       += core gui printsupport network svg
+QT       += core gui printsupport network svg concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -56,9 +56,11 @@ SOURCES += \
     cpprefacter.cpp \
     parser/cppparser.cpp \
     parser/cpppreprocessor.cpp \
+    parser/cppsystemheaderstore.cpp \
     parser/cpptokenizer.cpp \
     parser/parserutils.cpp \
     parser/statementmodel.cpp \
+    parser/symbolindex.cpp \
     problems/ojproblemset.cpp \
     problems/problemcasevalidator.cpp \
     project.cpp \
@@ -94,6 +96,7 @@ SOURCES += \
     symbolusagemanager.cpp \
     thememanager.cpp \
     todoparser.cpp \
+    backgroundjobscheduler.cpp \
     toolsmanager.cpp \
     widgets/aboutdialog.cpp \
     widgets/bookmarkmodel.cpp \
@@ -104,12 +107,14 @@ SOURCES += \
     debugger.cpp \
     editor.cpp \
     editorlist.cpp \
+    fileutils.cpp \
     iconsmanager.cpp \
     main.cpp \
     mainwindow.cpp \
     qsynedit/CodeFolding.cpp \
     qsynedit/Constants.cpp \
     qsynedit/KeyStrokes.cpp \
+    qsynedit/LineStore.cpp \
     qsynedit/MiscClasses.cpp \
     qsynedit/MiscProcs.cpp \
     qsynedit/SynEdit.cpp \
@@ -156,7 +161,8 @@ SOURCES += \
     widgets/qpatchedcombobox.cpp \
     widgets/searchdialog.cpp \
     widgets/searchresultview.cpp \
-    widgets/signalmessagedialog.cpp
+    widgets/signalmessagedialog.cpp \
+    widgets/symbolquickopenpopup.cpp
 
 HEADERS += \
     HighlighterManager.h \
@@ -178,9 +184,11 @@ HEADERS += \
     gdbmiresultparser.h \
     parser/cppparser.h \
     parser/cpppreprocessor.h \
+    parser/cppsystemheaderstore.h \
     parser/cpptokenizer.h \
     parser/parserutils.h \
     parser/statementmodel.h \
+    parser/symbolindex.h \
     platform.h \
     problems/ojproblemset.h \
     problems/problemcasevalidator.h \
@@ -216,6 +224,7 @@ HEADERS += \
     symbolusagemanager.h \
     thememanager.h \
     todoparser.h \
+    backgroundjobscheduler.h \
     toolsmanager.h \
     widgets/aboutdialog.h \
     widgets/bookmarkmodel.h \
@@ -231,6 +240,7 @@ HEADERS += \
     qsynedit/CodeFolding.h \
     qsynedit/Constants.h \
     qsynedit/KeyStrokes.h \
+    qsynedit/LineStore.h \
     qsynedit/MiscClasses.h \
     qsynedit/MiscProcs.h \
     qsynedit/SynEdit.h \
@@ -279,7 +289,8 @@ HEADERS += \
     widgets/qpatchedcombobox.h \
     widgets/searchdialog.h \
     widgets/searchresultview.h \
-    widgets/signalmessagedialog.h
+    widgets/signalmessagedialog.h \
+    widgets/symbolquickopenpopup.h
 
 FORMS += \
     settingsdialog/compilerautolinkwidget.ui \
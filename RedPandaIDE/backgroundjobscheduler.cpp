@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "backgroundjobscheduler.h"
+#include <QtConcurrent>
+#include <algorithm>
+
+BackgroundJobScheduler::BackgroundJobScheduler(QObject *parent) : QObject(parent),
+    mNextJobId(0)
+{
+    mThreadPool.setMaxThreadCount(qBound(1,QThread::idealThreadCount()/2,4));
+    mTimer.setSingleShot(true);
+    mClock.start();
+    connect(&mTimer, &QTimer::timeout,
+            this, &BackgroundJobScheduler::dispatch);
+    connect(this, &BackgroundJobScheduler::jobFinished,
+            this, &BackgroundJobScheduler::onJobFinished,
+            Qt::QueuedConnection);
+}
+
+BackgroundJobScheduler::~BackgroundJobScheduler()
+{
+    mTimer.stop();
+    mPendingJobs.clear();
+    mThreadPool.waitForDone();
+}
+
+void BackgroundJobScheduler::schedule(BackgroundJobKind kind, const void *owner,
+                                      BackgroundJobPriority priority, bool inGuiThread,
+                                      const BackgroundJob &job, int delay)
+{
+    PendingJob pendingJob;
+    pendingJob.priority = priority;
+    pendingJob.inGuiThread = inGuiThread;
+    pendingJob.job = job;
+    pendingJob.dueTime = mClock.elapsed() + delay;
+    // replaces the job that's not started yet
+    mPendingJobs.insert(JobKey(static_cast<int>(kind),owner),pendingJob);
+    if (!mTimer.isActive() || mTimer.remainingTime()>delay)
+        mTimer.start(delay);
+}
+
+void BackgroundJobScheduler::cancel(const void *owner)
+{
+    for (auto it=mPendingJobs.begin();it!=mPendingJobs.end();) {
+        if (it.key().second == owner)
+            it = mPendingJobs.erase(it);
+        else
+            ++it;
+    }
+    for (auto it=mRunningJobs.begin();it!=mRunningJobs.end();++it) {
+        // don't retry it
+        if (it.value().first.second == owner)
+            it.value().second.job = nullptr;
+    }
+}
+
+int BackgroundJobScheduler::maxThreadCount() const
+{
+    return mThreadPool.maxThreadCount();
+}
+
+void BackgroundJobScheduler::setMaxThreadCount(int count)
+{
+    mThreadPool.setMaxThreadCount(std::max(1,count));
+}
+
+void BackgroundJobScheduler::waitForDone()
+{
+    mThreadPool.waitForDone();
+}
+
+void BackgroundJobScheduler::dispatch()
+{
+    qint64 now = mClock.elapsed();
+    QList<JobKey> readyJobs;
+    for (auto it=mPendingJobs.constBegin();it!=mPendingJobs.constEnd();++it) {
+        // wait until the running one of the same kind and owner is finished
+        if (it.value().dueTime<=now && !mRunningJobIds.contains(it.key()))
+            readyJobs.append(it.key());
+    }
+    std::sort(readyJobs.begin(),readyJobs.end(),[this](const JobKey& key1, const JobKey& key2){
+        const PendingJob& job1 = mPendingJobs[key1];
+        const PendingJob& job2 = mPendingJobs[key2];
+        if (job1.priority != job2.priority)
+            return job1.priority < job2.priority;
+        return job1.dueTime < job2.dueTime;
+    });
+    foreach (const JobKey& key, readyJobs) {
+        PendingJob job = mPendingJobs.value(key);
+        if (job.inGuiThread) {
+            mPendingJobs.remove(key);
+            if (!job.job())
+                retryLater(key,job);
+            continue;
+        }
+        if (mRunningJobs.count()>=mThreadPool.maxThreadCount())
+            continue;
+        mPendingJobs.remove(key);
+        quint64 id = mNextJobId++;
+        mRunningJobs.insert(id,QPair<JobKey,PendingJob>(key,job));
+        mRunningJobIds.insert(key,id);
+        BackgroundJob func = job.job;
+        QtConcurrent::run(&mThreadPool,[this,id,func](){
+            bool started = func();
+            emit jobFinished(id,started);
+        });
+    }
+
+    qint64 nextDueTime = -1;
+    for (auto it=mPendingJobs.constBegin();it!=mPendingJobs.constEnd();++it) {
+        if (mRunningJobIds.contains(it.key()))
+            continue;
+        if (nextDueTime<0 || it.value().dueTime<nextDueTime)
+            nextDueTime = it.value().dueTime;
+    }
+    // jobs waiting for a free thread are dispatched when a running job finishes
+    if (nextDueTime>now)
+        mTimer.start(nextDueTime-now);
+}
+
+void BackgroundJobScheduler::onJobFinished(quint64 id, bool started)
+{
+    QPair<JobKey,PendingJob> runningJob = mRunningJobs.take(id);
+    mRunningJobIds.remove(runningJob.first);
+    if (!started && runningJob.second.job
+            && !mPendingJobs.contains(runningJob.first)) {
+        retryLater(runningJob.first,runningJob.second);
+    }
+    dispatch();
+}
+
+void BackgroundJobScheduler::retryLater(const JobKey &key, PendingJob job)
+{
+    job.dueTime = mClock.elapsed() + BACKGROUND_JOB_RETRY_DELAY;
+    mPendingJobs.insert(key,job);
+    if (!mTimer.isActive() || mTimer.remainingTime()>BACKGROUND_JOB_RETRY_DELAY)
+        mTimer.start(BACKGROUND_JOB_RETRY_DELAY);
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef BACKGROUNDJOBSCHEDULER_H
+#define BACKGROUNDJOBSCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <QPair>
+#include <QThreadPool>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <functional>
+
+#define BACKGROUND_JOB_DELAY 300 // ms
+#define BACKGROUND_JOB_RETRY_DELAY 200 // ms
+
+enum class BackgroundJobKind {
+    Reparse,
+    SyntaxCheck,
+    TodoScan
+};
+
+enum class BackgroundJobPriority {
+    ActiveEditor,
+    VisibleEditor,
+    HiddenEditor
+};
+
+/**
+ * @brief returns false if the job can't be started now and should be tried again later
+ */
+using BackgroundJob = std::function<bool ()>;
+
+/**
+ * @brief Runs the editors' background analysis (reparse, syntax check, todo scan).
+ *
+ * A job is delayed a bit after it's scheduled. Scheduling the same kind of job for
+ * the same owner again before it starts replaces it and restarts the delay, so fast
+ * typing only analyses the latest text. While a job is running, the next one of the
+ * same kind and owner waits for it to finish. Ready jobs start in priority order on
+ * a bounded thread pool.
+ */
+class BackgroundJobScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BackgroundJobScheduler(QObject *parent = nullptr);
+    ~BackgroundJobScheduler();
+    /**
+     * @param inGuiThread run the job in the gui thread, for jobs that only read the editor
+     * and hand the real work to another thread
+     */
+    void schedule(BackgroundJobKind kind,
+                  const void* owner,
+                  BackgroundJobPriority priority,
+                  bool inGuiThread,
+                  const BackgroundJob& job,
+                  int delay = BACKGROUND_JOB_DELAY);
+    /**
+     * @brief drop the owner's jobs that haven't started yet
+     */
+    void cancel(const void* owner);
+    int maxThreadCount() const;
+    void setMaxThreadCount(int count);
+    void waitForDone();
+signals:
+    void jobFinished(quint64 id, bool started);
+private slots:
+    void dispatch();
+    void onJobFinished(quint64 id, bool started);
+private:
+    using JobKey = QPair<int, const void*>;
+    struct PendingJob {
+        BackgroundJobPriority priority;
+        bool inGuiThread;
+        BackgroundJob job;
+        qint64 dueTime;
+    };
+    void retryLater(const JobKey& key, PendingJob job);
+
+    QHash<JobKey,PendingJob> mPendingJobs;
+    QHash<quint64,QPair<JobKey,PendingJob>> mRunningJobs;
+    QHash<JobKey,quint64> mRunningJobIds;
+    quint64 mNextJobId;
+    QThreadPool mThreadPool;
+    QTimer mTimer;
+    QElapsedTimer mClock;
+};
+
+#endif // BACKGROUNDJOBSCHEDULER_H
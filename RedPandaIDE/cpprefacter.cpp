@@ -22,8 +22,11 @@
 #include <QFile>
 #include <QMessageBox>
 #include <QTextCodec>
-#include "HighlighterManager.h"
+#include "qsynedit/highlighter/cpp.h"
 #include "project.h"
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent>
 
 CppRefacter::CppRefacter(QObject *parent) : QObject(parent)
 {
@@ -79,7 +82,8 @@ bool CppRefacter::findOccurence(const QString &statementFullname, SearchFileScop
     if (!parser)
         return false;
     {
-        parser->freeze();
+        if (!parser->freeze())
+            return false;
         auto action = finally([&parser]{
             parser->unFreeze();
         });
@@ -106,28 +110,51 @@ static QString fullParentName(PStatement statement) {
         return "";
     }
 }
+
+static QStringList projectSourceFiles(const std::shared_ptr<Project>& project)
+{
+    QStringList files;
+    foreach (const PProjectUnit& unit, project->units()) {
+        if (isCfile(unit->fileName()) || isHfile(unit->fileName()))
+            files.append(unit->fileName());
+    }
+    return files;
+}
+
 void CppRefacter::renameSymbol(Editor *editor, const BufferCoord &pos, const QString &word, const QString &newWord)
 {
-    if (!editor->parser()->freeze())
+    PCppParser parser = editor->parser();
+    if (!parser->freeze())
         return;
-    auto action = finally([&editor]{
-        editor->parser()->unFreeze();
+    auto action = finally([&parser]{
+        parser->unFreeze();
     });
     // get full phrase (such as s.name instead of name)
     QStringList expression = editor->getExpressionAtPosition(pos);
     // Find it's definition
-    PStatement oldStatement = editor->parser()->findStatementOf(
+    PStatement oldStatement = parser->findStatementOf(
                 editor->filename(),
                 expression,
                 pos.Line);
-    QString oldScope = fullParentName(oldStatement);
     // definition of the symbol not found
     if (!oldStatement)
         return;
-    // found but not in this file
-    if (editor->filename() != oldStatement->fileName
-            || editor->filename() != oldStatement->definitionFileName) {
+    QString oldScope = fullParentName(oldStatement);
+    std::shared_ptr<Project> project = pMainWindow->project();
+    bool inProject = editor->inProject() && project;
+    if (inProject) {
+        // symbols of system headers or files not in the project can't be changed
+        if (project->indexInUnits(oldStatement->fileName)<0
+                || project->indexInUnits(oldStatement->definitionFileName)<0) {
             QMessageBox::critical(editor,
+                                  tr("Rename Symbol Error"),
+                                  tr("Can't rename symbols not defined in the project."));
+            return;
+        }
+    } else if (editor->filename() != oldStatement->fileName
+            || editor->filename() != oldStatement->definitionFileName) {
+        // found but not in this file
+        QMessageBox::critical(editor,
                               tr("Rename Symbol Error"),
                               tr("Can't rename symbols not defined in this file."));
         return;
@@ -135,7 +162,7 @@ void CppRefacter::renameSymbol(Editor *editor, const BufferCoord &pos, const QSt
 
     QStringList newExpression = expression;
     newExpression[newExpression.count()-1]=newWord;
-    PStatement newStatement = editor->parser()->findStatementOf(
+    PStatement newStatement = parser->findStatementOf(
                 editor->filename(),
                 newExpression,
                 pos.Line);
@@ -145,7 +172,30 @@ void CppRefacter::renameSymbol(Editor *editor, const BufferCoord &pos, const QSt
                               tr("New symbol already exists!"));
         return;
     }
-    renameSymbolInFile(editor->filename(),oldStatement,newWord, editor->parser());
+    if (inProject) {
+        std::shared_ptr<QList<PSearchResultTreeItem>> fileItems =
+                std::make_shared<QList<PSearchResultTreeItem>>();
+        findOccurenceInFiles(
+                    projectSourceFiles(project),
+                    oldStatement,
+                    parser,
+                    [fileItems](const PSearchResultTreeItem& item) {
+            fileItems->append(item);
+        },
+                    [this,fileItems,word,newWord]() {
+            foreach (const PSearchResultTreeItem& fileItem, *fileItems) {
+                renameSymbolInFile(fileItem,word,newWord);
+                Editor * e = pMainWindow->editorList()->getOpenedEditorByFilename(fileItem->filename);
+                if (e && !fileItem->results.isEmpty())
+                    e->reparse();
+            }
+        });
+    } else {
+        renameSymbolInFile(
+                    findOccurenceInFile(editor->filename(),oldStatement, parser),
+                    word,
+                    newWord);
+    }
 }
 
 void CppRefacter::doFindOccurenceInEditor(PStatement statement , Editor *editor, const PCppParser &parser)
@@ -171,148 +221,316 @@ void CppRefacter::doFindOccurenceInProject(PStatement statement, std::shared_ptr
                 statement->fullName,
                 SearchFileScope::wholeProject
                 );
-    foreach (const PProjectUnit& unit, project->units()) {
-        if (isCfile(unit->fileName()) || isHfile(unit->fileName())) {
-            PSearchResultTreeItem item = findOccurenceInFile(
-                        unit->fileName(),
-                        statement,
-                        parser);
-            if (item && !(item->results.isEmpty())) {
-                results->results.append(item);
-            }
+    // show the results found so far while searching the other files
+    std::shared_ptr<QElapsedTimer> timer = std::make_shared<QElapsedTimer>();
+    timer->start();
+    findOccurenceInFiles(
+                projectSourceFiles(project),
+                statement,
+                parser,
+                [results,timer](const PSearchResultTreeItem& item) {
+        if (item->results.isEmpty())
+            return;
+        results->results.append(item);
+        if (timer->elapsed() > 200) {
+            pMainWindow->searchResultModel()->notifySearchResultsUpdated();
+            timer->restart();
+        }
+    },
+                []() {
+        pMainWindow->searchResultModel()->notifySearchResultsUpdated();
+    });
+}
+
+static bool isWordChar(const QChar& ch)
+{
+    return ch.isLetterOrNumber() || ch == '_';
+}
+
+// the name appears in the text as a whole word
+static bool containsWord(const QStringList& lines, const QString& word)
+{
+    foreach (const QString& line, lines) {
+        int pos = line.indexOf(word);
+        while (pos>=0) {
+            int end = pos + word.length();
+            if ((pos == 0 || !isWordChar(line[pos-1]))
+                    && (end >= line.length() || !isWordChar(line[end])))
+                return true;
+            pos = line.indexOf(word, pos+1);
         }
     }
+    return false;
 }
 
-PSearchResultTreeItem CppRefacter::findOccurenceInFile(
-        const QString &filename,
+struct OccurenceFileJob {
+    QString filename;
+    QString word;
+    QStringList lines;
+    bool opened;
+};
+
+struct OccurenceCandidate {
+    int line;
+    int start;
+    int len;
+    QStringList expression;
+};
+
+struct OccurenceFileScan {
+    QString filename;
+    QStringList lines;
+    QList<OccurenceCandidate> candidates;
+};
+
+using POccurenceFileScan = std::shared_ptr<OccurenceFileScan>;
+
+struct CppRefacter::OccurenceSearch {
+    PStatement statement;
+    PCppParser parser;
+    // filled as the workers finish, reset after resolved
+    QVector<POccurenceFileScan> scans;
+    int resolvedCount;
+    bool scanFinished;
+    bool done;
+    QMetaObject::Connection idleConnection;
+    QMetaObject::Connection resetConnection;
+    std::function<void (const PSearchResultTreeItem&)> onFileSearched;
+    std::function<void ()> onFinished;
+};
+
+static QStringList readSourceFile(const QString& filename)
+{
+    QStringList lines = readFileToLines(filename);
+    for (int i=0;i<lines.count();i++) {
+        QString& line = lines[i];
+        while (line.endsWith('\n') || line.endsWith('\r'))
+            line.chop(1);
+    }
+    return lines;
+}
+
+// find the tokens named word and their expressions. It uses neither
+// the parser nor any widget, so it can run in worker threads
+static POccurenceFileScan scanOccurences(const OccurenceFileJob& job)
+{
+    POccurenceFileScan scan = std::make_shared<OccurenceFileScan>();
+    scan->filename = job.filename;
+    QStringList lines = job.opened ? job.lines : readSourceFile(job.filename);
+    if (!containsWord(lines, job.word))
+        return scan;
+    PSynHighlighter highlighter = std::make_shared<SynEditCppHighlighter>();
+    QVector<SynRangeState> ranges;
+    ranges.reserve(lines.count());
+    highlighter->resetState();
+    for (int posY=0;posY<lines.count();posY++) {
+        if (posY>0)
+            highlighter->setState(ranges[posY-1]);
+        highlighter->setLine(lines[posY],posY);
+        while (!highlighter->eol()) {
+            int start = highlighter->getTokenPos() + 1;
+            QString token = highlighter->getToken();
+            PSynHighlighterAttribute attr = highlighter->getTokenAttribute();
+            if ((!attr || attr!=highlighter->commentAttribute())
+                    && token == job.word)
+                scan->candidates.append(OccurenceCandidate{posY+1, start, token.length(), QStringList()});
+            highlighter->next();
+        }
+        ranges.append(highlighter->getRangeState());
+    }
+    for (OccurenceCandidate& candidate: scan->candidates) {
+        BufferCoord p;
+        p.Line = candidate.line;
+        p.Char = candidate.start+1;
+        candidate.expression = Editor::getExpressionAtPosition(
+                    highlighter,
+                    lines.count(),
+                    [&lines](int line) { return lines[line]; },
+                    [&ranges](int line) { return ranges[line]; },
+                    p);
+    }
+    scan->lines = lines;
+    return scan;
+}
+
+// resolve the expressions found in the file, on the thread owning the parser
+static PSearchResultTreeItem resolveOccurencesInFile(
+        const POccurenceFileScan& scan,
         const PStatement &statement,
         const PCppParser& parser)
 {
     PSearchResultTreeItem parentItem = std::make_shared<SearchResultTreeItem>();
-    parentItem->filename = filename;
+    parentItem->filename = scan->filename;
     parentItem->parent = nullptr;
-    QStringList buffer;
-    Editor editor(nullptr);
-    if (pMainWindow->editorList()->getContentFromOpenedEditor(
-                filename,buffer)){
-        editor.lines()->setContents(buffer);
-    } else {
-        QByteArray encoding;
-        editor.lines()->loadFromFile(filename,ENCODING_AUTO_DETECT,encoding);
-    }
-    editor.setHighlighter(HighlighterManager().getCppHighlighter());
-    int posY = 0;
-    while (posY < editor.lines()->count()) {
-        QString line = editor.lines()->getString(posY);
-        if (line.isEmpty()) {
-            posY++;
-            continue;
+    foreach (const OccurenceCandidate& candidate, scan->candidates) {
+        //same name symbol , test if the same statement;
+        PStatement tokenStatement = parser->findStatementOf(
+                    scan->filename,
+                    candidate.expression, candidate.line);
+        if (tokenStatement
+                && (tokenStatement->line == statement->line)
+                && (tokenStatement->fileName == statement->fileName)) {
+            PSearchResultTreeItem item = std::make_shared<SearchResultTreeItem>();
+            item->filename = scan->filename;
+            item->line = candidate.line;
+            item->start = candidate.start;
+            item->len = candidate.len;
+            item->parent = parentItem.get();
+            item->text = scan->lines[candidate.line-1];
+            item->text.replace('\t',' ');
+            parentItem->results.append(item);
         }
+    }
+    return parentItem;
+}
+
+PSearchResultTreeItem CppRefacter::findOccurenceInFile(
+        const QString &filename,
+        const PStatement &statement,
+        const PCppParser& parser)
+{
+    OccurenceFileJob job;
+    job.filename = filename;
+    job.word = statement->command;
+    job.opened = pMainWindow->editorList()->getContentFromOpenedEditor(
+                filename,job.lines);
+    return resolveOccurencesInFile(scanOccurences(job), statement, parser);
+}
 
-        if (posY == 0) {
-            editor.highlighter()->resetState();
-        } else {
-            editor.highlighter()->setState(
-                        editor.lines()->ranges(posY-1));
+void CppRefacter::findOccurenceInFiles(
+        const QStringList &files,
+        const PStatement &statement,
+        const PCppParser &parser,
+        const std::function<void (const PSearchResultTreeItem &)> &onFileSearched,
+        const std::function<void ()> &onFinished)
+{
+    QList<OccurenceFileJob> jobs;
+    foreach (const QString& filename, files) {
+        OccurenceFileJob job;
+        job.filename = filename;
+        job.word = statement->command;
+        // texts of the editors must be get on this thread
+        job.opened = pMainWindow->editorList()->getContentFromOpenedEditor(filename,job.lines);
+        jobs.append(job);
+    }
+    std::shared_ptr<OccurenceSearch> search = std::make_shared<OccurenceSearch>();
+    search->statement = statement;
+    search->parser = parser;
+    search->scans.resize(jobs.count());
+    search->resolvedCount = 0;
+    search->scanFinished = false;
+    search->done = false;
+    search->onFileSearched = onFileSearched;
+    search->onFinished = onFinished;
+    // if the parser is busy when files are scanned, they are resolved after it's done
+    search->idleConnection = connect(parser.get(), &CppParser::onIdle,
+                                     this, [this,search]() {
+        resolveOccurences(search);
+    }, Qt::QueuedConnection);
+    // the statement found before is meaningless after the parser is reset
+    search->resetConnection = connect(parser.get(), &CppParser::onReset,
+                                      this, [this,search]() {
+        if (search->done)
+            return;
+        finishOccurenceSearch(search);
+        pMainWindow->updateStatusbarMessage(tr("Searching is stopped, because the parser is reset."));
+    });
+
+    QFutureWatcher<POccurenceFileScan> *watcher = new QFutureWatcher<POccurenceFileScan>(this);
+    connect(watcher, &QFutureWatcherBase::resultReadyAt,
+            this, [this,watcher,search](int index) {
+        search->scans[index] = watcher->resultAt(index);
+        resolveOccurences(search);
+    });
+    connect(watcher, &QFutureWatcherBase::finished,
+            this, [this,watcher,search]() {
+        for (int i=search->resolvedCount;i<search->scans.count();i++) {
+            if (!search->scans[i])
+                search->scans[i] = watcher->resultAt(i);
         }
-        editor.highlighter()->setLine(line,posY);
-        while (!editor.highlighter()->eol()) {
-            int start = editor.highlighter()->getTokenPos() + 1;
-            QString token = editor.highlighter()->getToken();
-            PSynHighlighterAttribute attr = editor.highlighter()->getTokenAttribute();
-            if (!attr || attr!=editor.highlighter()->commentAttribute()) {
-                if (token == statement->command) {
-                    //same name symbol , test if the same statement;
-                    BufferCoord p;
-                    p.Line = posY+1;
-                    p.Char = start+1;
+        search->scanFinished = true;
+        watcher->deleteLater();
+        resolveOccurences(search);
+    });
+    watcher->setFuture(QtConcurrent::mapped(jobs, scanOccurences));
+}
 
-                    QStringList expression = editor.getExpressionAtPosition(p);
-                    PStatement tokenStatement = parser->findStatementOf(
-                                filename,
-                                expression, p.Line);
-                    if (tokenStatement
-                            && (tokenStatement->line == statement->line)
-                            && (tokenStatement->fileName == statement->fileName)) {
-                        PSearchResultTreeItem item = std::make_shared<SearchResultTreeItem>();
-                        item->filename = filename;
-                        item->line = p.Line;
-                        item->start = start;
-                        item->len = token.length();
-                        item->parent = parentItem.get();
-                        item->text = line;
-                        item->text.replace('\t',' ');
-                        parentItem->results.append(item);
-                    }
-                }
-            }
-            editor.highlighter()->next();
+void CppRefacter::resolveOccurences(const std::shared_ptr<OccurenceSearch> &search)
+{
+    if (search->done)
+        return;
+    if (search->resolvedCount < search->scans.count()
+            && search->scans[search->resolvedCount]) {
+        // the parser is being reset, go on when it's idle
+        if (!search->parser->freeze())
+            return;
+        auto action = finally([&search]{
+            search->parser->unFreeze();
+        });
+        while (search->resolvedCount < search->scans.count()
+               && search->scans[search->resolvedCount]) {
+            PSearchResultTreeItem item = resolveOccurencesInFile(
+                        search->scans[search->resolvedCount],
+                        search->statement,
+                        search->parser);
+            // don't keep the file's text
+            search->scans[search->resolvedCount].reset();
+            search->resolvedCount++;
+            if (search->onFileSearched)
+                search->onFileSearched(item);
         }
-        posY++;
     }
-    return parentItem;
+    if (search->scanFinished && search->resolvedCount == search->scans.count()) {
+        finishOccurenceSearch(search);
+        if (search->onFinished)
+            search->onFinished();
+    }
+}
+
+void CppRefacter::finishOccurenceSearch(const std::shared_ptr<OccurenceSearch> &search)
+{
+    search->done = true;
+    // the connections hold the search
+    disconnect(search->idleConnection);
+    disconnect(search->resetConnection);
 }
 
-void CppRefacter::renameSymbolInFile(const QString &filename, const PStatement &statement,  const QString &newWord, const PCppParser &parser)
+void CppRefacter::renameSymbolInFile(const PSearchResultTreeItem& fileItem, const QString &word, const QString &newWord)
 {
-    QStringList buffer;
+    if (!fileItem || fileItem->results.isEmpty())
+        return;
+    QString filename = fileItem->filename;
     Editor editor(nullptr);
-    if (pMainWindow->editorList()->getContentFromOpenedEditor(
-                filename,buffer)){
-        editor.lines()->setContents(buffer);
+    Editor * oldEditor = pMainWindow->editorList()->getOpenedEditorByFilename(filename);
+    QStringList newContents;
+    QByteArray encoding;
+    if (oldEditor) {
+        newContents = oldEditor->contents();
     } else {
-        QByteArray encoding;
         editor.lines()->loadFromFile(filename,ENCODING_AUTO_DETECT,encoding);
+        newContents = editor.lines()->contents();
     }
-    QStringList newContents;
-    editor.setHighlighter(HighlighterManager().getCppHighlighter());
-    int posY = 0;
-    while (posY < editor.lines()->count()) {
-        QString line = editor.lines()->getString(posY);
-
-        if (posY == 0) {
-            editor.highlighter()->resetState();
-        } else {
-            editor.highlighter()->setState(
-                        editor.lines()->ranges(posY-1));
-        }
-        editor.highlighter()->setLine(line,posY);
-        QString newLine;
-        while (!editor.highlighter()->eol()) {
-            int start = editor.highlighter()->getTokenPos() + 1;
-            QString token = editor.highlighter()->getToken();
-            if (token == statement->command) {
-                //same name symbol , test if the same statement;
-                BufferCoord p;
-                p.Line = posY+1;
-                p.Char = start+1;
-
-                QStringList expression = editor.getExpressionAtPosition(p);
-                PStatement tokenStatement = parser->findStatementOf(
-                            filename,
-                            expression, p.Line);
-                if (tokenStatement
-                        && (tokenStatement->line == statement->line)
-                        && (tokenStatement->fileName == statement->fileName)) {
-                    token = newWord;
-                }
-            }
-            newLine += token;
-            editor.highlighter()->next();
-        }
-        newContents.append(newLine);
-        posY++;
+    // replace from the end, so positions of the other occurences don't change
+    for (int i=fileItem->results.count()-1;i>=0;i--) {
+        const PSearchResultTreeItem& item = fileItem->results[i];
+        if (item->line<1 || item->line>newContents.count())
+            continue;
+        // the file may be changed while searching in the background
+        if (newContents[item->line-1].mid(item->start-1, item->len) != word)
+            continue;
+        newContents[item->line-1].replace(item->start-1, item->len, newWord);
     }
 
-    Editor * oldEditor = pMainWindow->editorList()->getOpenedEditorByFilename(filename);
     if (oldEditor) {
         oldEditor->selectAll();
         oldEditor->setSelText(newContents.join(oldEditor->lineBreak()));
     } else {
+        editor.lines()->setContents(newContents);
         QByteArray realEncoding;
         QFile file(filename);
-        editor.lines()->saveToFile(file,ENCODING_AUTO_DETECT,
+        // keep the file's encoding. An ascii file gets the default one if the new name isn't ascii
+        editor.lines()->saveToFile(file,
+                                   encoding == ENCODING_ASCII ? QByteArray(ENCODING_AUTO_DETECT) : encoding,
                                    pSettings->editor().useUTF8ByDefault()? ENCODING_UTF8 : QTextCodec::codecForLocale()->name(),
                                    realEncoding);
     }
@@ -34,19 +34,37 @@ public:
     bool findOccurence(Editor * editor, const BufferCoord& pos);
     bool findOccurence(const QString& statementFullname, SearchFileScope scope);
 
+    /**
+     * @brief rename the symbol at pos. Symbols of project files are renamed in
+     * all files of the project, after the files are searched in the background.
+     */
     void renameSymbol(Editor* editor, const BufferCoord& pos, const QString& word, const QString& newWord);
 private:
+    struct OccurenceSearch;
     void doFindOccurenceInEditor(PStatement statement, Editor* editor, const PCppParser& parser);
     void doFindOccurenceInProject(PStatement statement, std::shared_ptr<Project> project, const PCppParser& parser);
     PSearchResultTreeItem findOccurenceInFile(
             const QString& filename,
             const PStatement& statement,
             const PCppParser& parser);
-    void renameSymbolInFile(
-            const QString& filename,
+    /**
+     * @brief search the files on a thread pool. The workers only scan the texts,
+     * the expressions found are resolved on this thread.
+     * @param onFileSearched called on this thread for each file, in the order of files
+     * @param onFinished called on this thread after all files are searched
+     */
+    void findOccurenceInFiles(
+            const QStringList& files,
             const PStatement& statement,
-            const QString& newWord,
-            const PCppParser& parser);
+            const PCppParser& parser,
+            const std::function<void (const PSearchResultTreeItem&)>& onFileSearched,
+            const std::function<void ()>& onFinished = nullptr);
+    void resolveOccurences(const std::shared_ptr<OccurenceSearch>& search);
+    void finishOccurenceSearch(const std::shared_ptr<OccurenceSearch>& search);
+    void renameSymbolInFile(
+            const PSearchResultTreeItem& fileItem,
+            const QString& word,
+            const QString& newWord);
 };
 
 #endif // CPPREFACTER_H
@@ -22,6 +22,7 @@
 #include <QVariant>
 #include <QWheelEvent>
 #include <memory>
+#include <algorithm>
 #include "settings.h"
 #include "mainwindow.h"
 #include "systemconsts.h"
@@ -67,6 +68,9 @@ const char* SaveException::what() const noexcept {
     return mReasonBuffer;
 }
 
+// files larger than this are loaded in a worker thread
+#define LOAD_IN_BACKGROUND_SIZE (4*1024*1024)
+
 Editor::Editor(QWidget *parent):
     Editor(parent,QObject::tr("untitled"),ENCODING_SYSTEM_DEFAULT,false,true,nullptr)
 {
@@ -92,7 +96,10 @@ Editor::Editor(QWidget *parent, const QString& filename,
   mCurrentTipType(TipType::None),
   mOldHighlightedWord(),
   mCurrentHighlightedWord(),
-  mSaving(false)
+  mSaving(false),
+  mLoading(false),
+  mReadOnlyBeforeLoading(false),
+  mPendingCaretPos{0,0}
 {
     mCurrentLineModified = false;
     mUseCppSyntax = pSettings->editor().defaultFileCpp();
@@ -105,6 +112,13 @@ Editor::Editor(QWidget *parent, const QString& filename,
         updateCaption();
     }
 
+    connect(lines().get(), &SynEditStringList::loadProgress,
+            this, &Editor::onLinesLoadProgress);
+    connect(lines().get(), &SynEditStringList::loaded,
+            this, &Editor::onLinesLoaded);
+    connect(lines().get(), &SynEditStringList::loadFailed,
+            this, &Editor::onLinesLoadFailed);
+
     PSynHighlighter highlighter;
     if (!isNew) {
         loadFile();
@@ -134,6 +148,7 @@ Editor::Editor(QWidget *parent, const QString& filename,
             && (mParser->isSystemHeaderFile(mFilename) || mParser->isProjectHeaderFile(mFilename))) {
         this->setModified(false);
         setReadOnly(true);
+        mReadOnlyBeforeLoading = true;
         updateCaption();
     }
 
@@ -162,6 +177,8 @@ Editor::Editor(QWidget *parent, const QString& filename,
             this, &Editor::onLinesDeleted);
     connect(this,&SynEdit::linesInserted,
             this, &Editor::onLinesInserted);
+    connect(lines().get(), &SynEditStringList::putted,
+            this, &Editor::onLinesPutted);
 
     setContextMenuPolicy(Qt::CustomContextMenu);
     connect(this, &QWidget::customContextMenuRequested,
@@ -183,6 +200,7 @@ Editor::Editor(QWidget *parent, const QString& filename,
 }
 
 Editor::~Editor() {
+    pMainWindow->backgroundJobScheduler()->cancel(this);
     pMainWindow->fileSystemWatcher()->removePath(mFilename);
     pMainWindow->caretList().removeEditor(this);
     pMainWindow->updateCaretActions();
@@ -195,11 +213,30 @@ Editor::~Editor() {
 
 void Editor::loadFile(QString filename) {
     if (filename.isEmpty()) {
-        this->lines()->loadFromFile(mFilename,mEncodingOption,mFileEncoding);
+        filename = mFilename;
     } else {
         filename = QFileInfo(filename).absoluteFilePath();
-        this->lines()->loadFromFile(filename,mEncodingOption,mFileEncoding);
     }
+    if (QFileInfo(filename).size() > LOAD_IN_BACKGROUND_SIZE) {
+        // large files (like test data) are decoded in a worker thread, and can't be
+        // edited until they are loaded
+        if (!mLoading)
+            mReadOnlyBeforeLoading = readOnly();
+        mLoading = true;
+        setReadOnly(true);
+        this->lines()->loadFromFileInBackground(filename,mEncodingOption);
+        return;
+    }
+    if (mLoading) {
+        mLoading = false;
+        setReadOnly(mReadOnlyBeforeLoading);
+    }
+    this->lines()->loadFromFile(filename,mEncodingOption,mFileEncoding);
+    finishLoadFile();
+}
+
+void Editor::finishLoadFile()
+{
     //this->setModified(false);
     updateCaption();
     pMainWindow->updateForEncodingInfo();
@@ -239,6 +276,9 @@ void Editor::convertToEncoding(const QByteArray &encoding)
 }
 
 bool Editor::save(bool force, bool doReparse) {
+    // the file isn't loaded yet
+    if (mLoading)
+        return false;
     if (this->mIsNew && !force) {
         return saveAs();
     }
@@ -897,23 +937,7 @@ void Editor::onPreparePaintHighlightToken(int line, int aChar, const QString &to
         return;
 
     if (mParser && highlighter() && (attr == highlighter()->identifierAttribute())) {
-        BufferCoord p{aChar,line};
-        BufferCoord pBeginPos,pEndPos;
-        QString s= getWordAtPosition(this,p, pBeginPos,pEndPos, WordPurpose::wpInformation);
-//        qDebug()<<s;
-        PStatement statement = mParser->findStatementOf(mFilename,
-          s , p.Line);
-        StatementKind kind = mParser->getKindOfStatement(statement);
-        if (kind == StatementKind::skUnknown) {
-            if ((pEndPos.Line>=1)
-              && (pEndPos.Char>=0)
-              && (pEndPos.Char < lines()->getString(pEndPos.Line-1).length())
-              && (lines()->getString(pEndPos.Line-1)[pEndPos.Char] == '(')) {
-                kind = StatementKind::skFunction;
-            } else {
-                kind = StatementKind::skVariable;
-            }
-        }
+        StatementKind kind = getIdentifierKind(line,aChar);
         PColorSchemeItem item = mStatementColors->value(kind,PColorSchemeItem());
 
         if (item) {
@@ -1257,6 +1281,7 @@ void Editor::copyAsHTML()
                                         ));
     exporter.setCreateHTMLFragment(true);
 
+    ensureLinesScanned(blockBegin().Line-1);
     exporter.ExportRange(lines(),blockBegin(),blockEnd());
 
     QMimeData * mimeData = new QMimeData;
@@ -1277,6 +1302,11 @@ void Editor::setCaretPosition(int line, int aChar)
 
 void Editor::setCaretPositionAndActivate(int line, int aChar)
 {
+    if (mLoading) {
+        // moved there when the file is loaded
+        mPendingCaretPos = BufferCoord{aChar,line};
+        return;
+    }
     this->uncollapseAroundLine(line);
     if (!this->hasFocus())
         this->activate();
@@ -1551,8 +1581,133 @@ void Editor::onTipEvalValueReady(const QString& value)
                this, &Editor::onTipEvalValueReady);
 }
 
+StatementKind Editor::getIdentifierKind(int line, int aChar)
+{
+    QString serialId = mParser->serialId();
+    if (mParser->declarationSerialId() != mSemanticTokensDeclarationSerialId) {
+        // any identifier may be declared or removed
+        mSemanticTokens.clear();
+        mSemanticTokensEditedLines.clear();
+        mSemanticTokensLastEditedLines.clear();
+        mSemanticTokensDeclarationSerialId = mParser->declarationSerialId();
+        mSemanticTokensSerialId = serialId;
+    } else if (serialId != mSemanticTokensSerialId && !mParser->parsing()) {
+        // only the bodies of the edited functions are reparsed
+        invalidateSemanticTokensOfEditedFunctions();
+        mSemanticTokensSerialId = serialId;
+    }
+    QString lineText = lines()->getString(line-1);
+    auto it = mSemanticTokens.find(line);
+    if (it != mSemanticTokens.end()) {
+        if (it->text == lineText) {
+            auto kindIt = it->kinds.constFind(aChar);
+            if (kindIt != it->kinds.constEnd())
+                return kindIt.value();
+        } else {
+            // the line is edited
+            it->text = lineText;
+            it->kinds.clear();
+        }
+    }
+
+    BufferCoord p{aChar,line};
+    BufferCoord pBeginPos,pEndPos;
+    QString s= getWordAtPosition(this,p, pBeginPos,pEndPos, WordPurpose::wpInformation);
+    PStatement statement = mParser->findStatementOf(mFilename,
+      s , p.Line);
+    StatementKind kind = mParser->getKindOfStatement(statement);
+    // nothing is found while parsing, don't remember it
+    bool resultValid = !mParser->parsing() && mParser->serialId() == serialId;
+    if (kind == StatementKind::skUnknown) {
+        if ((pEndPos.Line>=1)
+          && (pEndPos.Char>=0)
+          && (pEndPos.Char < lines()->getString(pEndPos.Line-1).length())
+          && (lines()->getString(pEndPos.Line-1)[pEndPos.Char] == '(')) {
+            kind = StatementKind::skFunction;
+        } else {
+            kind = StatementKind::skVariable;
+        }
+    }
+    if (resultValid) {
+        SemanticTokenLine& tokenLine = mSemanticTokens[line];
+        tokenLine.text = lineText;
+        tokenLine.kinds.insert(aChar,kind);
+    }
+    return kind;
+}
+
+void Editor::invalidateSemanticTokensOfEditedFunctions()
+{
+    QSet<int> editedLineSet = mSemanticTokensEditedLines;
+    editedLineSet.unite(mSemanticTokensLastEditedLines);
+    QList<int> editedLines = editedLineSet.values();
+    std::sort(editedLines.begin(),editedLines.end());
+    int invalidatedTo = 0;
+    foreach (int line, editedLines) {
+        // in the function invalidated already
+        if (line <= invalidatedTo)
+            continue;
+        int startLine = line;
+        int endLine = line;
+        PStatement scope = mParser->findAndScanBlockAt(mFilename,line);
+        while (scope && scope->kind == StatementKind::skBlock)
+            scope = scope->parentScope.lock();
+        if (scope && (scope->kind == StatementKind::skFunction
+                      || scope->kind == StatementKind::skConstructor
+                      || scope->kind == StatementKind::skDestructor)) {
+            if (scope->definitionFileName == mFilename) {
+                startLine = scope->definitionLine;
+                endLine = scope->definitionEndLine;
+            } else {
+                startLine = scope->line;
+                endLine = scope->endLine;
+            }
+            startLine = std::min(startLine,line);
+            endLine = std::max(endLine,line);
+        }
+        for (int i=startLine;i<=endLine;i++)
+            mSemanticTokens.remove(i);
+        invalidatedTo = endLine;
+    }
+    mSemanticTokensLastEditedLines = mSemanticTokensEditedLines;
+    mSemanticTokensEditedLines.clear();
+}
+
+void Editor::markSemanticTokensEdited(int firstLine, int lastLine)
+{
+    for (int i=firstLine;i<=lastLine;i++)
+        mSemanticTokensEditedLines.insert(i);
+}
+
+// line numbers after the deleted or inserted lines are moved, like bookmarks
+static void shiftLineNumbers(QSet<int>& lines, int first, int count, bool deleted)
+{
+    QSet<int> result;
+    foreach (int line, lines) {
+        if (line < first)
+            result.insert(line);
+        else if (!deleted)
+            result.insert(line+count);
+        else if (line >= first+count)
+            result.insert(line-count);
+    }
+    lines = result;
+}
+
 void Editor::onLinesDeleted(int first, int count)
 {
+    QHash<int,SemanticTokenLine> semanticTokens;
+    for (auto it=mSemanticTokens.begin();it!=mSemanticTokens.end();++it) {
+        if (it.key() < first)
+            semanticTokens.insert(it.key(),it.value());
+        else if (it.key() >= first+count)
+            semanticTokens.insert(it.key()-count,it.value());
+    }
+    mSemanticTokens = semanticTokens;
+    shiftLineNumbers(mSemanticTokensEditedLines,first,count,true);
+    shiftLineNumbers(mSemanticTokensLastEditedLines,first,count,true);
+    // the lines around the deleted ones are in the same function
+    markSemanticTokensEdited(std::max(first-1,1),first);
     pMainWindow->caretList().linesDeleted(this,first,count);
     pMainWindow->debugger()->breakpointModel()->onFileDeleteLines(mFilename,first,count);
     pMainWindow->bookmarkModel()->onFileDeleteLines(mFilename,first,count);
@@ -1565,6 +1720,17 @@ void Editor::onLinesDeleted(int first, int count)
 
 void Editor::onLinesInserted(int first, int count)
 {
+    QHash<int,SemanticTokenLine> semanticTokens;
+    for (auto it=mSemanticTokens.begin();it!=mSemanticTokens.end();++it) {
+        if (it.key() < first)
+            semanticTokens.insert(it.key(),it.value());
+        else
+            semanticTokens.insert(it.key()+count,it.value());
+    }
+    mSemanticTokens = semanticTokens;
+    shiftLineNumbers(mSemanticTokensEditedLines,first,count,false);
+    shiftLineNumbers(mSemanticTokensLastEditedLines,first,count,false);
+    markSemanticTokensEdited(first,first+count-1);
     pMainWindow->caretList().linesInserted(this,first,count);
     pMainWindow->debugger()->breakpointModel()->onFileInsertLines(mFilename,first,count);
     pMainWindow->bookmarkModel()->onFileInsertLines(mFilename,first,count);
@@ -1575,6 +1741,39 @@ void Editor::onLinesInserted(int first, int count)
     }
 }
 
+void Editor::onLinesLoadProgress(int percent)
+{
+    pMainWindow->updateStatusbarMessage(tr("Loading \"%1\": %2%")
+                                        .arg(extractFileName(mFilename)).arg(percent));
+}
+
+void Editor::onLinesLoaded(const QByteArray &realEncoding)
+{
+    mLoading = false;
+    setReadOnly(mReadOnlyBeforeLoading);
+    mFileEncoding = realEncoding;
+    pMainWindow->updateStatusbarMessage(tr("\"%1\" loaded").arg(extractFileName(mFilename)));
+    finishLoadFile();
+    if (mPendingCaretPos.Line>0) {
+        BufferCoord pos = mPendingCaretPos;
+        mPendingCaretPos = BufferCoord{0,0};
+        setCaretPositionAndActivate(pos.Line,pos.Char);
+    }
+}
+
+void Editor::onLinesLoadFailed(const QString &reason)
+{
+    mLoading = false;
+    setReadOnly(mReadOnlyBeforeLoading);
+    mPendingCaretPos = BufferCoord{0,0};
+    QMessageBox::critical(pMainWindow,tr("Error Load File"),reason);
+}
+
+void Editor::onLinesPutted(int index, int count)
+{
+    markSemanticTokensEdited(index+1,index+count);
+}
+
 bool Editor::isBraceChar(QChar ch)
 {
     switch( ch.unicode()) {
@@ -1657,26 +1856,42 @@ QStringList Editor::getOwnerExpressionAndMemberAtPositionForCompletion(
 QStringList Editor::getExpressionAtPosition(
         const BufferCoord &pos)
 {
-    QStringList result;
     if (!highlighter())
-        return result;
+        return QStringList();
+    PSynHighlighter highlighter = highlighterManager.getHighlighter(mFilename);
+    if (!highlighter)
+        return QStringList();
+    ensureLinesScanned(pos.Line);
+    return getExpressionAtPosition(
+                highlighter,
+                lines()->count(),
+                [this](int line) { return lines()->getString(line); },
+                [this](int line) { return lines()->ranges(line); },
+                pos);
+}
+
+QStringList Editor::getExpressionAtPosition(
+        const PSynHighlighter &highlighter,
+        int lineCount,
+        const std::function<QString (int)> &getLine,
+        const std::function<SynRangeState (int)> &getRange,
+        const BufferCoord &pos)
+{
+    QStringList result;
     int line = pos.Line-1;
     int ch = pos.Char-1;
     int symbolMatchingLevel = 0;
     LastSymbolType lastSymbolType=LastSymbolType::None;
-    PSynHighlighter highlighter = highlighterManager.getHighlighter(mFilename);
-    if (!highlighter)
-        return result;
     while (true) {
-        if (line>=lines()->count() || line<0)
+        if (line>=lineCount || line<0)
             break;
         QStringList tokens;
         if (line==0) {
             highlighter->resetState();
         } else {
-            highlighter->setState(lines()->ranges(line-1));
+            highlighter->setState(getRange(line-1));
         }
-        QString sLine = lines()->getString(line);
+        QString sLine = getLine(line);
         highlighter->setLine(sLine,line-1);
         while (!highlighter->eol()) {
             int start = highlighter->getTokenPos();
@@ -1704,7 +1919,7 @@ QStringList Editor::getExpressionAtPosition(
                 if (token==">") {
                     lastSymbolType=LastSymbolType::MatchingAngleQuotation;
                     symbolMatchingLevel=0;
-                } else if (isIdentChar(token.front())) {
+                } else if (highlighter->isIdentChar(token.front())) {
                     lastSymbolType=LastSymbolType::Identifier;
                 } else
                     return result;
@@ -1719,7 +1934,7 @@ QStringList Editor::getExpressionAtPosition(
                 } else if (token == "]") {
                     lastSymbolType=LastSymbolType::MatchingBracket;
                     symbolMatchingLevel = 0;
-                } else if (isIdentChar(token.front())) {
+                } else if (highlighter->isIdentChar(token.front())) {
                     lastSymbolType=LastSymbolType::Identifier;
                 } else
                     return result;
@@ -1756,7 +1971,7 @@ QStringList Editor::getExpressionAtPosition(
                     lastSymbolType=LastSymbolType::AsteriskSign;
                 } else if (token == "&") {
                     lastSymbolType=LastSymbolType::AmpersandSign;
-                } else if (isIdentChar(token.front())) {
+                } else if (highlighter->isIdentChar(token.front())) {
                     lastSymbolType=LastSymbolType::Identifier;
                 } else
                     return result;
@@ -1768,13 +1983,13 @@ QStringList Editor::getExpressionAtPosition(
                 } else if (token == "]") {
                     lastSymbolType=LastSymbolType::MatchingBracket;
                     symbolMatchingLevel = 0;
-                } else if (isIdentChar(token.front())) {
+                } else if (highlighter->isIdentChar(token.front())) {
                     lastSymbolType=LastSymbolType::Identifier;
                 } else
                     return result;
                 break;
             case LastSymbolType::AngleQuotationMatched: //before '<>'
-                if (isIdentChar(token.front())) {
+                if (highlighter->isIdentChar(token.front())) {
                     lastSymbolType=LastSymbolType::Identifier;
                 } else
                     return result;
@@ -1796,7 +2011,7 @@ QStringList Editor::getExpressionAtPosition(
                 } else if (token == "]") {
                     lastSymbolType=LastSymbolType::MatchingBracket;
                     symbolMatchingLevel = 0;
-                } else if (isIdentChar(token.front())) {
+                } else if (highlighter->isIdentChar(token.front())) {
                     lastSymbolType=LastSymbolType::Identifier;
                 } else
                     return result;
@@ -1869,7 +2084,7 @@ QStringList Editor::getExpressionAtPosition(
 
         line--;
         if (line>=0)
-            ch = lines()->getString(line).length()+1;
+            ch = getLine(line).length()+1;
     }
     return result;
 }
@@ -2381,12 +2596,35 @@ Editor::QuoteStatus Editor::getQuoteStatus()
 
 void Editor::reparse()
 {
-    parseFile(mParser,mFilename,mInProject);
+    if (!mParser)
+        return;
+    PCppParser parser = mParser;
+    QString fileName = mFilename;
+    bool inProject = mInProject;
+    pMainWindow->backgroundJobScheduler()->schedule(
+                BackgroundJobKind::Reparse, this, backgroundJobPriority(), false,
+                [parser,fileName,inProject]() {
+        // rescheduled if the parser is busy
+        return parser->parseFile(fileName,inProject);
+    });
 }
 
 void Editor::reparseTodo()
 {
-    pMainWindow->todoParser()->parseFile(mFilename);
+    pMainWindow->backgroundJobScheduler()->schedule(
+                BackgroundJobKind::TodoScan, this, backgroundJobPriority(), true,
+                [this]() {
+        return pMainWindow->todoParser()->parseFile(mFilename);
+    });
+}
+
+BackgroundJobPriority Editor::backgroundJobPriority()
+{
+    if (pMainWindow->editorList()->getEditor()==this)
+        return BackgroundJobPriority::ActiveEditor;
+    if (isVisible())
+        return BackgroundJobPriority::VisibleEditor;
+    return BackgroundJobPriority::HiddenEditor;
 }
 
 void Editor::insertString(const QString &value, bool moveCursor)
@@ -3329,7 +3567,7 @@ void Editor::updateFunctionTip()
     // Only do the cumbersome list filling when showing a new tooltip...
 
     if (s != pMainWindow->functionTip()->functionFullName()
-            && !mParser->parsing()) {
+            && mParser->readable()) {
         pMainWindow->functionTip()->clearTips();
         QList<PStatement> statements=mParser->getListOfFunctions(mFilename,
                                                                   s,
@@ -3913,8 +4151,13 @@ void Editor::checkSyntaxInBack()
 {
     if (readOnly())
         return;
-    if(pSettings->editor().syntaxCheck())
-        pMainWindow->checkSyntaxInBack(this);
+    if(!pSettings->editor().syntaxCheck())
+        return;
+    pMainWindow->backgroundJobScheduler()->schedule(
+                BackgroundJobKind::SyntaxCheck, this, backgroundJobPriority(), true,
+                [this]() {
+        return pMainWindow->checkSyntaxInBack(this);
+    });
 }
 
 const PCppParser &Editor::parser()
@@ -24,6 +24,7 @@
 #include "colorscheme.h"
 #include "common.h"
 #include "parser/cppparser.h"
+#include "backgroundjobscheduler.h"
 #include "widgets/codecompletionpopup.h"
 #include "widgets/headercompletionpopup.h"
 
@@ -217,6 +218,17 @@ public:
     QString getWordForCompletionSearch(const BufferCoord& pos,bool permitTilde);
     QStringList getExpressionAtPosition(
             const BufferCoord& pos);
+    /**
+     * @brief get the expression at the position of text not shown in an editor.
+     * It doesn't use any widget, so it can be called from worker threads.
+     * @param getRange highlighter state at the end of the line
+     */
+    static QStringList getExpressionAtPosition(
+            const PSynHighlighter& highlighter,
+            int lineCount,
+            const std::function<QString (int)>& getLine,
+            const std::function<SynRangeState (int)>& getRange,
+            const BufferCoord& pos);
 
     const PCppParser &parser();
 
@@ -229,8 +241,14 @@ private slots:
     void onTipEvalValueReady(const QString& value);
     void onLinesDeleted(int first,int count);
     void onLinesInserted(int first,int count);
+    void onLinesPutted(int index,int count);
+    void onLinesLoadProgress(int percent);
+    void onLinesLoaded(const QByteArray& realEncoding);
+    void onLinesLoadFailed(const QString& reason);
 
 private:
+    BackgroundJobPriority backgroundJobPriority();
+    void finishLoadFile();
     bool isBraceChar(QChar ch);
     void resetBookmarks();
     QChar getCurrentChar();
@@ -279,7 +297,14 @@ private:
     void popUserCodeInTabStops();
     void onExportedFormatToken(PSynHighlighter syntaxHighlighter, int Line, int column, const QString& token,
         PSynHighlighterAttribute &attr);
+    StatementKind getIdentifierKind(int line, int aChar);
+    void invalidateSemanticTokensOfEditedFunctions();
+    void markSemanticTokensEdited(int firstLine, int lastLine);
 private:
+    struct SemanticTokenLine {
+        QString text;
+        QHash<int,StatementKind> kinds; // start char -> kind of the identifier
+    };
     QByteArray mEncodingOption; // the encoding type set by the user
     QByteArray mFileEncoding; // the real encoding of the file (auto detected)
     QString mFilename;
@@ -314,6 +339,9 @@ private:
     QDateTime mHideTime;
 
     bool mSaving;
+    bool mLoading; // a large file is being loaded in background
+    bool mReadOnlyBeforeLoading;
+    BufferCoord mPendingCaretPos; // where to move the caret after loading
     bool mCurrentLineModified;
     int mXOffsetSince;
     int mTabStopBegin;
@@ -326,6 +354,14 @@ private:
     BufferCoord mHighlightCharPos1;
     BufferCoord mHighlightCharPos2;
     std::shared_ptr<QHash<StatementKind, std::shared_ptr<ColorSchemeItem> > > mStatementColors;
+    // kinds of the identifiers painted, valid for the parse result with the serial id
+    QHash<int,SemanticTokenLine> mSemanticTokens;
+    QString mSemanticTokensSerialId;
+    QString mSemanticTokensDeclarationSerialId;
+    // lines edited since the last reparse, and the ones edited before it, which may
+    // be reparsed by the next one
+    QSet<int> mSemanticTokensEditedLines;
+    QSet<int> mSemanticTokensLastEditedLines;
 
     // QWidget interface
 protected:
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "utils.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextCodec>
+#include <cstring>
+
+// File and path helpers (and the error classes) from utils.h that don't depend on the
+// IDE's settings or widgets, so headless tools (like the parser benchmark) can link them.
+
+QString includeTrailingPathDelimiter(const QString &path)
+{
+    if (path.endsWith('/') || path.endsWith(QDir::separator())) {
+        return path;
+    } else {
+        return path + "/";
+    }
+}
+
+bool isTextAllAscii(const char* data, qint64 size)
+{
+    // check 8 bytes a time, the compiler can vectorize this loop
+    const quint64 highBits = Q_UINT64_C(0x8080808080808080);
+    qint64 i=0;
+    quint64 acc = 0;
+    for (;i+8<=size;i+=8) {
+        quint64 v;
+        memcpy(&v,data+i,8);
+        acc |= v;
+    }
+    if (acc & highBits)
+        return false;
+    for (;i<size;i++) {
+        if (data[i] & 0x80)
+            return false;
+    }
+    return true;
+}
+
+static QString decodeText(const char* data, qint64 size)
+{
+    if (isTextAllAscii(data,size))
+        return QString::fromLatin1(data,size);
+    QTextCodec* codec = QTextCodec::codecForLocale();
+    QTextCodec::ConverterState state;
+    QString text = codec->toUnicode(data,size,&state);
+    if (state.invalidChars==0)
+        return text;
+    QTextCodec::ConverterState utf8State;
+    codec = QTextCodec::codecForName("UTF-8");
+    text = codec->toUnicode(data,size,&utf8State);
+    if (utf8State.invalidChars==0)
+        return text;
+    return QString();
+}
+
+QStringList readFileToLines(const QString &fileName)
+{
+    QFile file(fileName);
+    if (file.size()<=0)
+        return QStringList();
+    if (!file.open(QFile::ReadOnly))
+        return QStringList();
+    // decode the whole file at once, from the mapped file if possible
+    qint64 size = file.size();
+    QString text;
+    uchar* mapped = file.map(0,size);
+    if (mapped) {
+        text = decodeText(reinterpret_cast<const char*>(mapped),size);
+        file.unmap(mapped);
+    } else {
+        QByteArray contents = file.readAll();
+        text = decodeText(contents.constData(),contents.size());
+    }
+    file.close();
+
+    // lines keep their line breaks, like QFile::readLine()
+    QStringList result;
+    result.reserve(text.count('\n')+1);
+    int start = 0;
+    while (start < text.length()) {
+        int pos = text.indexOf('\n',start);
+        if (pos<0) {
+            result.append(text.mid(start));
+            break;
+        }
+        result.append(text.mid(start,pos-start+1));
+        start = pos+1;
+    }
+    return result;
+}
+
+QString extractFilePath(const QString &filePath)
+{
+    QFileInfo info(filePath);
+    return info.path();
+}
+
+QString extractFileDir(const QString &fileName)
+{
+    return extractFilePath(fileName);
+}
+
+BaseError::BaseError(const QString &reason):
+mReason(reason)
+{
+
+}
+
+QString BaseError::reason() const
+{
+    return mReason;
+}
+
+IndexOutOfRange::IndexOutOfRange(int Index):
+BaseError(QObject::tr("Index %1 out of range").arg(Index))
+{
+
+}
+
+FileError::FileError(const QString &reason): BaseError(reason)
+{
+
+}
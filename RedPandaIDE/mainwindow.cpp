@@ -51,6 +51,7 @@
 #include <QLineEdit>
 #include <QMessageBox>
 #include <QMimeData>
+#include <QPointer>
 #include <QTcpSocket>
 #include <QTemporaryFile>
 #include <QTextBlock>
@@ -200,6 +201,7 @@ MainWindow::MainWindow(QWidget *parent)
             this, &MainWindow::onDebugMemoryAddressInput);
 
     mTodoParser = std::make_shared<TodoParser>();
+    mRefacter = std::make_shared<CppRefacter>();
     mSymbolUsageManager = std::make_shared<SymbolUsageManager>();
     try {
         mSymbolUsageManager->load();
@@ -288,6 +290,13 @@ MainWindow::MainWindow(QWidget *parent)
     mCompletionPopup->setColors(mStatementColors);
     mHeaderCompletionPopup = std::make_shared<HeaderCompletionPopup>();
     mFunctionTip = std::make_shared<FunctionTooltipWidget>();
+    mSymbolQuickOpenPopup = std::make_shared<SymbolQuickOpenPopup>();
+    connect(mSymbolQuickOpenPopup.get(), &SymbolQuickOpenPopup::symbolChosen,
+            this, [this](const QString& fileName, int line) {
+        Editor* e = mEditorList->getEditorByFilename(fileName);
+        if (e)
+            e->setCaretPositionAndActivate(line,1);
+    });
 
     mClassBrowserModel.setColors(mStatementColors);
 
@@ -465,6 +474,7 @@ void MainWindow::updateProjectActions()
     ui->actionClose_Project->setEnabled(hasProject);
     ui->actionProject_Open_Folder_In_Explorer->setEnabled(hasProject);
     ui->actionProject_Open_In_Terminal->setEnabled(hasProject);
+    ui->actionGo_to_Symbol->setEnabled(hasProject);
     updateCompileActions();
 }
 
@@ -1309,27 +1319,28 @@ void MainWindow::updateActionIcons()
         ui->tabMessages->setTabIcon(idx,pIconsManager->getIcon(IconsManager::ACTION_PROBLEM_PROBLEM));
 }
 
-void MainWindow::checkSyntaxInBack(Editor *e)
+bool MainWindow::checkSyntaxInBack(Editor *e)
 {
     if (e==nullptr)
-        return;
+        return true;
 
     if (!pSettings->editor().syntaxCheck()) {
-        return;
+        return true;
     }
 //    if not devEditor.AutoCheckSyntax then
 //      Exit;
     //not c or cpp file
     if (!e->highlighter() || e->highlighter()->getName()!=SYN_HIGHLIGHTER_CPP)
-        return;
+        return true;
+    if (!pSettings->compilerSets().defaultSet())
+        return true;
+    // busy, try again later
     if (mCompilerManager->backgroundSyntaxChecking())
-        return;
+        return false;
     if (mCompilerManager->compiling())
-        return;
-    if (!pSettings->compilerSets().defaultSet())
-        return;
+        return false;
     if (mCheckSyntaxInBack)
-        return;
+        return false;
 
     mCheckSyntaxInBack=true;
     clearIssues();
@@ -1341,6 +1352,7 @@ void MainWindow::checkSyntaxInBack(Editor *e)
         mCompilerManager->checkSyntax(e->filename(),e->text(),
                                           e->fileEncoding() == ENCODING_ASCII, nullptr);
     }
+    return true;
 }
 
 bool MainWindow::compile(bool rebuild)
@@ -1885,9 +1897,13 @@ void MainWindow::scanActiveProject(bool parse)
         return;
     //UpdateClassBrowsing;
     if (parse) {
-        resetCppParser(mProject->cppParser());
-        mProject->resetParserProjectFiles();
-        parseFileList(mProject->cppParser());
+        std::shared_ptr<Project> project = mProject;
+        resetCppParser(mProject->cppParser(), [this,project]() {
+            if (project != mProject)
+                return;
+            mProject->resetParserProjectFiles();
+            parseFileList(mProject->cppParser());
+        });
     } else {
         mProject->resetParserProjectFiles();
     };
@@ -2020,6 +2036,15 @@ void MainWindow::updateTools()
 {
     ui->menuTools->clear();
     ui->menuTools->addAction(ui->actionOptions);
+#ifdef QT_DEBUG
+    QAction* dumpAction = new QAction(tr("Dump Interned Strings"),ui->menuTools);
+    connect(dumpAction, &QAction::triggered,
+            [] (){
+        dumpInternedStrings(includeTrailingPathDelimiter(pSettings->dirs().config())
+                            + "interned-strings.txt");
+    });
+    ui->menuTools->addAction(dumpAction);
+#endif
     if (!mToolsManager->tools().isEmpty()) {
         ui->menuTools->addSeparator();
         foreach (const PToolItem& item, mToolsManager->tools()) {
@@ -3254,9 +3279,9 @@ void MainWindow::onEditorContextMenu(const QPoint& pos)
         menu.addAction(ui->actionFile_Properties);
 
         //these actions needs parser
-        ui->actionGoto_Declaration->setEnabled(!editor->parser()->parsing());
-        ui->actionGoto_Definition->setEnabled(!editor->parser()->parsing());
-        ui->actionFind_references->setEnabled(!editor->parser()->parsing());
+        ui->actionGoto_Declaration->setEnabled(editor->parser()->readable());
+        ui->actionGoto_Definition->setEnabled(editor->parser()->readable());
+        ui->actionFind_references->setEnabled(editor->parser()->readable());
     } else {
         //mouse on gutter
 
@@ -3441,6 +3466,7 @@ void MainWindow::closeProject(bool refreshEditor)
                 auto action3 = finally([this]{
                     mEditorList->endUpdate();
                 });
+                mSymbolQuickOpenPopup->setSymbolIndex(PSymbolIndex());
                 mProject.reset();
 
                 if (!mQuitting && refreshEditor) {
@@ -4456,6 +4482,19 @@ void MainWindow::onEndParsing(int total, int)
         updateStatusbarMessage(tr("Done parsing %1 files in %2 seconds")
                                   .arg(total).arg(parseTime));
     }
+    CppParser* parser = qobject_cast<CppParser*>(sender());
+    if (parser) {
+        PreprocessStatistics statistics = parser->preprocessStatistics();
+        ui->statusbar->setToolTip(
+                    tr("%1 files (%2 lines) read, %3 of them unchanged since last read")
+                    .arg(statistics.filesRead).arg(statistics.linesRead).arg(statistics.filesShared)
+                    + "\n"
+                    + tr("%1 includes: %2 resolved from cache, %3 already included, %4 skipped by include guards")
+                    .arg(statistics.includes)
+                    .arg(statistics.includeLookupsCached)
+                    .arg(statistics.includesAlreadyIncluded)
+                    .arg(statistics.includesSkippedByGuard));
+    }
 }
 
 void MainWindow::onEvalValueReady(const QString& value)
@@ -4572,8 +4611,7 @@ void MainWindow::on_btnSearchAgain_clicked()
                                    results->scope,
                                    results->options);
     } else if (results->searchType == SearchType::FindOccurences) {
-        CppRefacter refactor;
-        refactor.findOccurence(results->statementFullname,results->scope);
+        mRefacter->findOccurence(results->statementFullname,results->scope);
     }
 }
 
@@ -4776,13 +4814,24 @@ void MainWindow::on_actionGoto_Definition_triggered()
 }
 
 
+void MainWindow::on_actionGo_to_Symbol_triggered()
+{
+    if (!mProject)
+        return;
+    mSymbolQuickOpenPopup->setSymbolIndex(mProject->symbolIndex());
+    mSymbolQuickOpenPopup->setBaseDir(mProject->directory());
+    int w = std::max(width()/2, 400);
+    int h = std::max(height()/2, 300);
+    QPoint pos = mapToGlobal(QPoint((width()-w)/2, height()/8));
+    mSymbolQuickOpenPopup->showAt(QRect(pos, QSize(w,h)));
+}
+
 void MainWindow::on_actionFind_references_triggered()
 {
     Editor * editor = mEditorList->getEditor();
     BufferCoord pos;
     if (editor && editor->pointToCharLine(mEditorContextMenuPos,pos)) {
-        CppRefacter refactor;
-        refactor.findOccurence(editor,pos);
+        mRefacter->findOccurence(editor,pos);
         showSearchPanel(true);
     }
 }
@@ -5156,6 +5205,11 @@ const PTodoParser &MainWindow::todoParser() const
     return mTodoParser;
 }
 
+BackgroundJobScheduler *MainWindow::backgroundJobScheduler()
+{
+    return &mBackgroundJobScheduler;
+}
+
 PCodeSnippetManager &MainWindow::codeSnippetManager()
 {
     return mCodeSnippetManager;
@@ -5175,14 +5229,17 @@ void MainWindow::updateEditorParser(QTabWidget* tabWidget) {
             Editor * e = (Editor*)(tabWidget->widget(i));
             if (!e->inProject()) {
                 if (e!=editor && e->parser() && !e->notParsed()) {
-                    e->parser()->reset();
+                    resetCppParser(e->parser());
                 }
             }
         }
     }
     if (editor && editor->parser() && editor->notParsed()) {
-        resetCppParser(editor->parser());
-        editor->reparse();
+        QPointer<Editor> e = editor;
+        resetCppParser(editor->parser(), [e]() {
+            if (e)
+                e->reparse();
+        });
     }
 }
 
@@ -5410,19 +5467,18 @@ void MainWindow::on_actionRename_Symbol_triggered()
         // definition of the symbol not found
         if (!oldStatement)
             return;
-        // found but not in this file
-        if (editor->filename() != oldStatement->fileName
-            || editor->filename() != oldStatement->definitionFileName) {
-            // it's defined in system header, dont rename
-            if (mProject->cppParser()->isSystemHeaderFile(oldStatement->fileName)) {
-                QMessageBox::critical(editor,
-                            tr("Rename Error"),
-                            tr("Symbol '%1' is defined in system header.")
-                                      .arg(oldStatement->fullName));
-                return;
-            }
-            CppRefacter refactor;
-            refactor.findOccurence(editor,oldCaretXY);
+        // it's defined in system header, dont rename
+        if (mProject->cppParser()->isSystemHeaderFile(oldStatement->fileName)) {
+            QMessageBox::critical(editor,
+                        tr("Rename Error"),
+                        tr("Symbol '%1' is defined in system header.")
+                                  .arg(oldStatement->fullName));
+            return;
+        }
+        // defined in files not in the project, only show its occurences
+        if (mProject->indexInUnits(oldStatement->fileName)<0
+                || mProject->indexInUnits(oldStatement->definitionFileName)<0) {
+            mRefacter->findOccurence(editor,oldCaretXY);
             showSearchPanel(true);
             return;
         }
@@ -5442,8 +5498,7 @@ void MainWindow::on_actionRename_Symbol_triggered()
     PCppParser parser = editor->parser();
     //here we must reparse the file in sync, or rename may fail
     parser->parseFile(editor->filename(), editor->inProject(), false, false);
-    CppRefacter refactor;
-    refactor.renameSymbol(editor,oldCaretXY,word,newWord);
+    mRefacter->renameSymbol(editor,oldCaretXY,word,newWord);
     editor->reparse();
 
 }
@@ -29,10 +29,12 @@
 #include "widgets/codecompletionpopup.h"
 #include "widgets/headercompletionpopup.h"
 #include "widgets/functiontooltipwidget.h"
+#include "widgets/symbolquickopenpopup.h"
 #include "caretlist.h"
 #include "symbolusagemanager.h"
 #include "codesnippetsmanager.h"
 #include "todoparser.h"
+#include "backgroundjobscheduler.h"
 #include "toolsmanager.h"
 #include "widgets/labelwithmenu.h"
 #include "widgets/bookmarkmodel.h"
@@ -64,6 +66,7 @@ class QPlainTextEdit;
 class SearchDialog;
 class Project;
 class ColorSchemeItem;
+class CppRefacter;
 
 class MainWindow : public QMainWindow
 {
@@ -107,7 +110,7 @@ public:
     void updateCompilerSet();
     void updateDebuggerSettings();
     void updateActionIcons();
-    void checkSyntaxInBack(Editor* e);
+    bool checkSyntaxInBack(Editor* e);
     bool compile(bool rebuild=false);
     void runExecutable(const QString& exeName, const QString& filename=QString(),RunType runType = RunType::Normal);
     void runExecutable(RunType runType = RunType::Normal);
@@ -168,6 +171,7 @@ public:
     PCodeSnippetManager &codeSnippetManager();
 
     const PTodoParser &todoParser() const;
+    BackgroundJobScheduler* backgroundJobScheduler();
 
     const PToolsManager &toolsManager() const;
 
@@ -414,6 +418,8 @@ private slots:
 
     void on_actionFind_references_triggered();
 
+    void on_actionGo_to_Symbol_triggered();
+
     void on_actionOpen_Containing_Folder_triggered();
 
     void on_actionOpen_Terminal_triggered();
@@ -581,6 +587,7 @@ private:
     std::shared_ptr<CodeCompletionPopup> mCompletionPopup;
     std::shared_ptr<HeaderCompletionPopup> mHeaderCompletionPopup;
     std::shared_ptr<FunctionTooltipWidget> mFunctionTip;
+    std::shared_ptr<SymbolQuickOpenPopup> mSymbolQuickOpenPopup;
 
     TodoModel mTodoModel;
     SearchResultModel mSearchResultModel;
@@ -593,6 +600,8 @@ private:
     PSymbolUsageManager mSymbolUsageManager;
     PCodeSnippetManager mCodeSnippetManager;
     PTodoParser mTodoParser;
+    std::shared_ptr<CppRefacter> mRefacter;
+    BackgroundJobScheduler mBackgroundJobScheduler;
     PToolsManager mToolsManager;
     QFileSystemModel mFileSystemModel;
     OJProblemSetModel mOJProblemSetModel;
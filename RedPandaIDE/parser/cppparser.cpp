@@ -19,22 +19,30 @@
 #include "../utils.h"
 #include "../qsynedit/highlighter/cpp.h"
 
-#include <QApplication>
 #include <QDate>
+#include <QFuture>
 #include <QHash>
 #include <QQueue>
+#include <QRegularExpression>
+#include <QCryptographicHash>
 #include <QThread>
+#include <QThreadPool>
 #include <QTime>
+#include <QtConcurrent>
 
 static QAtomicInt cppParserCount(0);
 CppParser::CppParser(QObject *parent) : QObject(parent),
-    mMutex(QMutex::Recursive)
+    mLock(QReadWriteLock::Recursive),
+    mCancelRequested(0)
 {
     mParserId = cppParserCount.fetchAndAddRelaxed(1);
     mSerialCount = 0;
     updateSerialId();
+    mDeclarationSerialId = mSerialId;
     mUniqId = 0;
     mParsing = false;
+    mParsingThread = nullptr;
+    mSnapshotWhileParsing = false;
     //mStatementList ; // owns the objects
     //mFilesToScan;
     //mIncludePaths;
@@ -45,6 +53,7 @@ CppParser::CppParser(QObject *parent) : QObject(parent),
     //mSkipList;
     mParseLocalHeaders = true;
     mParseGlobalHeaders = true;
+    mParserThreads = 0;
     mLockCount = 0;
     mIsSystemHeader = false;
     mIsHeader = false;
@@ -52,6 +61,10 @@ CppParser::CppParser(QObject *parent) : QObject(parent),
 
     mCppKeywords = CppKeywords;
     mCppTypeKeywords = CppTypeKeywords;
+    mSystemHeaderStoreSyncedCount = 0;
+    mPreprocessor.setOnOpenUnscannedHeader(
+                std::bind(&CppParser::onOpenUnscannedHeader,this,
+                          std::placeholders::_1));
     //mNamespaces;
     //mBlockBeginSkips;
     //mBlockEndSkips;
@@ -60,24 +73,13 @@ CppParser::CppParser(QObject *parent) : QObject(parent),
 
 CppParser::~CppParser()
 {
-    while (true) {
-        //wait for all methods finishes running
-        {
-            QMutexLocker locker(&mMutex);
-            if (!mParsing && (mLockCount == 0)) {
-              mParsing = true;
-              break;
-            }
-        }
-        QThread::msleep(50);
-        QCoreApplication* app = QApplication::instance();
-        app->processEvents();
-    }
+    // parse jobs and readers hold shared pointers to the parser,
+    // so no one is parsing or freezing it here
 }
 
 void CppParser::addHardDefineByLine(const QString &line)
 {
-    QMutexLocker  locker(&mMutex);
+    QWriteLocker locker(&mLock);
     if (line.startsWith('#')) {
         mPreprocessor.addHardDefineByLine(line.mid(1).trimmed());
     } else {
@@ -87,39 +89,39 @@ void CppParser::addHardDefineByLine(const QString &line)
 
 void CppParser::addIncludePath(const QString &value)
 {
-    QMutexLocker  locker(&mMutex);
+    QWriteLocker locker(&mLock);
     mPreprocessor.addIncludePath(includeTrailingPathDelimiter(value));
 }
 
 void CppParser::addProjectIncludePath(const QString &value)
 {
-    QMutexLocker  locker(&mMutex);
+    QWriteLocker locker(&mLock);
     mPreprocessor.addProjectIncludePath(includeTrailingPathDelimiter(value));
 }
 
 void CppParser::clearIncludePaths()
 {
-    QMutexLocker  locker(&mMutex);
+    QWriteLocker locker(&mLock);
     mPreprocessor.clearIncludePaths();
 }
 
 void CppParser::clearProjectIncludePaths()
 {
-    QMutexLocker  locker(&mMutex);
+    QWriteLocker locker(&mLock);
     mPreprocessor.clearProjectIncludePaths();
 }
 
 void CppParser::clearProjectFiles()
 {
-    QMutexLocker  locker(&mMutex);
+    QWriteLocker locker(&mLock);
     mProjectFiles.clear();
 }
 
 QList<PStatement> CppParser::getListOfFunctions(const QString &fileName, const QString &phrase, int line)
 {
-    QMutexLocker locker(&mMutex);
+    QReadLocker locker(&mLock);
     QList<PStatement> result;
-    if (mParsing)
+    if (!readable())
         return result;
 
     PStatement statement = findStatementOf(fileName,phrase, line);
@@ -143,11 +145,11 @@ QList<PStatement> CppParser::getListOfFunctions(const QString &fileName, const Q
 
 PStatement CppParser::findAndScanBlockAt(const QString &filename, int line)
 {
-    QMutexLocker locker(&mMutex);
-    if (mParsing) {
+    QReadLocker locker(&mLock);
+    if (!readable()) {
         return PStatement();
     }
-    PFileIncludes fileIncludes = mPreprocessor.includesList().value(filename);
+    PFileIncludes fileIncludes = fileIncludesList().value(filename);
     if (!fileIncludes)
         return PStatement();
 
@@ -157,7 +159,9 @@ PStatement CppParser::findAndScanBlockAt(const QString &filename, int line)
 
 PFileIncludes CppParser::findFileIncludes(const QString &filename, bool deleteIt)
 {
-    QMutexLocker locker(&mMutex);
+    QWriteLocker locker(&mLock);
+    if (!deleteIt)
+        return fileIncludesList().value(filename,PFileIncludes());
     PFileIncludes fileIncludes = mPreprocessor.includesList().value(filename,PFileIncludes());
     if (deleteIt && fileIncludes)
         mPreprocessor.includesList().remove(filename);
@@ -166,8 +170,8 @@ PFileIncludes CppParser::findFileIncludes(const QString &filename, bool deleteIt
 
 QString CppParser::findFirstTemplateParamOf(const QString &fileName, const QString &phrase, const PStatement& currentScope)
 {
-    QMutexLocker locker(&mMutex);
-    if (mParsing)
+    QReadLocker locker(&mLock);
+    if (!readable())
         return "";
     // Remove pointer stuff from type
     QString s = phrase; // 'Type' is a keyword
@@ -192,11 +196,11 @@ QString CppParser::findFirstTemplateParamOf(const QString &fileName, const QStri
 
 PStatement CppParser::findFunctionAt(const QString &fileName, int line)
 {
-    QMutexLocker locker(&mMutex);
-    PFileIncludes fileIncludes = mPreprocessor.includesList().value(fileName);
+    QReadLocker locker(&mLock);
+    PFileIncludes fileIncludes = fileIncludesList().value(fileName);
     if (!fileIncludes)
         return PStatement();
-    for (PStatement& statement : fileIncludes->statements) {
+    for (const PStatement& statement : fileIncludes->statements) {
         if (statement->kind != StatementKind::skFunction
                 && statement->kind != StatementKind::skConstructor
                 && statement->kind != StatementKind::skDestructor)
@@ -228,15 +232,19 @@ int CppParser::findLastOperator(const QString &phrase) const
 
 PStatementList CppParser::findNamespace(const QString &name)
 {
-    QMutexLocker locker(&mMutex);
-    return mNamespaces.value(name,PStatementList());
+    QReadLocker locker(&mLock);
+    return namespaces().value(name,PStatementList());
 }
 
 PStatement CppParser::findStatement(const QString &fullname)
 {
-    QMutexLocker locker(&mMutex);
+    QReadLocker locker(&mLock);
     if (fullname.isEmpty())
         return PStatement();
+    PStatement result = statements().findStatementByFullName(fullname);
+    if (result)
+        return result;
+    // statements of shared system headers are not indexed in our model
     QStringList phrases = fullname.split("::");
     if (phrases.isEmpty())
         return PStatement();
@@ -262,8 +270,8 @@ PStatement CppParser::findStatement(const QString &fullname)
 
 PStatement CppParser::findStatementOf(const QString &fileName, const QString &phrase, int line)
 {
-    QMutexLocker locker(&mMutex);
-    if (mParsing)
+    QReadLocker locker(&mLock);
+    if (!readable())
         return PStatement();
     return findStatementOf(fileName,phrase,findAndScanBlockAt(fileName,line));
 }
@@ -274,10 +282,10 @@ PStatement CppParser::findStatementOf(const QString &fileName,
                                       PStatement &parentScopeType,
                                       bool force)
 {
-    QMutexLocker locker(&mMutex);
+    QReadLocker locker(&mLock);
     PStatement result;
     parentScopeType = currentScope;
-    if (mParsing && !force)
+    if (!readable() && !force)
         return PStatement();
 
     //find the start scope statement
@@ -286,7 +294,7 @@ PStatement CppParser::findStatementOf(const QString &fileName,
     PStatement statement;
     getFullNamespace(phrase, namespaceName, remainder);
     if (!namespaceName.isEmpty()) {  // (namespace )qualified Name
-        PStatementList namespaceList = mNamespaces.value(namespaceName);
+        PStatementList namespaceList = namespaces().value(namespaceName);
 
         if (!namespaceList || namespaceList->isEmpty())
             return PStatement();
@@ -415,8 +423,8 @@ PEvalStatement CppParser::evalExpression(
         const QStringList &phraseExpression,
         const PStatement &currentScope)
 {
-    QMutexLocker locker(&mMutex);
-    if (mParsing)
+    QReadLocker locker(&mLock);
+    if (!readable())
         return PEvalStatement();
 //    qDebug()<<phraseExpression;
     int pos = 0;
@@ -436,8 +444,8 @@ PStatement CppParser::findStatementOf(const QString &fileName, const QString &ph
 
 PStatement CppParser::findStatementOf(const QString &fileName, const QStringList &expression, const PStatement &currentScope)
 {
-    QMutexLocker locker(&mMutex);
-    if (mParsing)
+    QReadLocker locker(&mLock);
+    if (!readable())
         return PStatement();
     QString memberOperator;
     QStringList memberExpression;
@@ -468,8 +476,8 @@ PStatement CppParser::findStatementOf(const QString &fileName, const QStringList
 
 PStatement CppParser::findStatementOf(const QString &fileName, const QStringList &expression, int line)
 {
-    QMutexLocker locker(&mMutex);
-    if (mParsing)
+    QReadLocker locker(&mLock);
+    if (!readable())
         return PStatement();
     return findStatementOf(fileName,expression,findAndScanBlockAt(fileName,line));
 }
@@ -513,9 +521,9 @@ PStatement CppParser::findStatementStartingFrom(const QString &fileName, const Q
 
 PStatement CppParser::findTypeDefinitionOf(const QString &fileName, const QString &aType, const PStatement& currentClass)
 {
-    QMutexLocker locker(&mMutex);
+    QReadLocker locker(&mLock);
 
-    if (mParsing)
+    if (!readable())
         return PStatement();
     // Remove pointer stuff from type
     QString s = aType; // 'Type' is a keyword
@@ -547,8 +555,8 @@ PStatement CppParser::findTypeDefinitionOf(const QString &fileName, const QStrin
 
 bool CppParser::freeze()
 {
-    QMutexLocker locker(&mMutex);
-    if (mParsing)
+    QWriteLocker locker(&mLock);
+    if (!readable())
         return false;
     mLockCount++;
     return true;
@@ -556,10 +564,12 @@ bool CppParser::freeze()
 
 bool CppParser::freeze(const QString &serialId)
 {
-    QMutexLocker locker(&mMutex);
-    if (mParsing)
+    QWriteLocker locker(&mLock);
+    if (!readable())
         return false;
-    if (mSerialId!=serialId)
+    // the snapshot has the results of the parse before the running one
+    const ParseSnapshot* snapshot = readingSnapshot();
+    if ((snapshot ? snapshot->serialId : mSerialId) != serialId)
         return false;
     mLockCount++;
     return true;
@@ -567,7 +577,7 @@ bool CppParser::freeze(const QString &serialId)
 
 QStringList CppParser::getClassesList()
 {
-    QMutexLocker locker(&mMutex);
+    QReadLocker locker(&mLock);
 
     QStringList list;
     return list;
@@ -576,7 +586,7 @@ QStringList CppParser::getClassesList()
     queue.enqueue(PStatement());
     while (!queue.isEmpty()) {
         PStatement statement = queue.dequeue();
-        StatementMap statementMap = mStatementList.childrenStatements(statement);
+        StatementMap statementMap = statements().childrenStatements(statement);
         for (PStatement& child:statementMap) {
             if (child->kind == StatementKind::skClass)
                 list.append(child->command);
@@ -589,13 +599,13 @@ QStringList CppParser::getClassesList()
 
 QSet<QString> CppParser::getFileDirectIncludes(const QString &filename)
 {
-    QMutexLocker locker(&mMutex);
+    QReadLocker locker(&mLock);
     QSet<QString> list;
-    if (mParsing)
+    if (!readable())
         return list;
     if (filename.isEmpty())
         return list;
-    PFileIncludes fileIncludes = mPreprocessor.includesList().value(filename,PFileIncludes());
+    PFileIncludes fileIncludes = fileIncludesList().value(filename,PFileIncludes());
 
     if (fileIncludes) {
         QMap<QString, bool>::const_iterator iter = fileIncludes->includeFiles.cbegin();
@@ -611,14 +621,14 @@ QSet<QString> CppParser::getFileDirectIncludes(const QString &filename)
 
 QSet<QString> CppParser::getFileIncludes(const QString &filename)
 {
-    QMutexLocker locker(&mMutex);
+    QReadLocker locker(&mLock);
     QSet<QString> list;
-    if (mParsing)
+    if (!readable())
         return list;
     if (filename.isEmpty())
         return list;
     list.insert(filename);
-    PFileIncludes fileIncludes = mPreprocessor.includesList().value(filename,PFileIncludes());
+    PFileIncludes fileIncludes = fileIncludesList().value(filename,PFileIncludes());
 
     if (fileIncludes) {
         foreach (const QString& file, fileIncludes->includeFiles.keys()) {
@@ -630,19 +640,20 @@ QSet<QString> CppParser::getFileIncludes(const QString &filename)
 
 QSet<QString> CppParser::getFileUsings(const QString &filename)
 {
-    QMutexLocker locker(&mMutex);
+    QReadLocker locker(&mLock);
     QSet<QString> result;
     if (filename.isEmpty())
         return result;
-    if (mParsing)
+    if (!readable())
         return result;
-    PFileIncludes fileIncludes= mPreprocessor.includesList().value(filename,PFileIncludes());
+    const QHash<QString,PFileIncludes>& includesList = fileIncludesList();
+    PFileIncludes fileIncludes= includesList.value(filename,PFileIncludes());
     if (fileIncludes) {
         foreach (const QString& usingName, fileIncludes->usings) {
             result.insert(usingName);
         }
         foreach (const QString& subFile,fileIncludes->includeFiles.keys()){
-            PFileIncludes subIncludes = mPreprocessor.includesList().value(subFile,PFileIncludes());
+            PFileIncludes subIncludes = includesList.value(subFile,PFileIncludes());
             if (subIncludes) {
                 foreach (const QString& usingName, subIncludes->usings) {
                     result.insert(usingName);
@@ -655,7 +666,7 @@ QSet<QString> CppParser::getFileUsings(const QString &filename)
 
 QString CppParser::getHeaderFileName(const QString &relativeTo, const QString &line)
 {
-    QMutexLocker locker(&mMutex);
+    QReadLocker locker(&mLock);
     return ::getHeaderFilename(relativeTo, line, mPreprocessor.includePathList(),
                              mPreprocessor.projectIncludePathList());
 }
@@ -679,15 +690,17 @@ StatementKind CppParser::getKindOfStatement(const PStatement& statement)
 void CppParser::invalidateFile(const QString &fileName)
 {
     {
-        QMutexLocker locker(&mMutex);
+        QWriteLocker locker(&mLock);
         if (mParsing || mLockCount>0)
             return;
+        startParsing();
         updateSerialId();
-        mParsing = true;
+        mDeclarationSerialId = mSerialId;
     }
     QSet<QString> files = calculateFilesToBeReparsed(fileName);
     internalInvalidateFiles(files);
-    mParsing = false;
+    updateSymbolIndex();
+    finishParsing();
 }
 
 bool CppParser::isIncludeLine(const QString &line)
@@ -703,33 +716,37 @@ bool CppParser::isIncludeLine(const QString &line)
 
 bool CppParser::isProjectHeaderFile(const QString &fileName)
 {
-    QMutexLocker locker(&mMutex);
+    QReadLocker locker(&mLock);
     return ::isSystemHeaderFile(fileName,mPreprocessor.projectIncludePaths());
 }
 
 bool CppParser::isSystemHeaderFile(const QString &fileName)
 {
-    QMutexLocker locker(&mMutex);
+    QReadLocker locker(&mLock);
     return ::isSystemHeaderFile(fileName,mPreprocessor.includePaths());
 }
 
-void CppParser::parseFile(const QString &fileName, bool inProject, bool onlyIfNotParsed, bool updateView)
+bool CppParser::parseFile(const QString &fileName, bool inProject, bool onlyIfNotParsed, bool updateView)
 {
     if (!mEnabled)
-        return;
+        return true;
     {
-        QMutexLocker locker(&mMutex);
+        QWriteLocker locker(&mLock);
         if (mParsing || mLockCount>0)
-            return;
+            return false;
+        startParsing();
         updateSerialId();
-        mParsing = true;
-        if (updateView)
-            emit onBusy();
-        emit onStartParsing();
+        mCancelRequested.storeRelease(0);
+        mPreprocessor.resetStatistics();
     }
+    // slots may call back into the parser, don't emit while holding the lock
+    if (updateView)
+        emit onBusy();
+    emit onStartParsing();
     {
         auto action = finally([&,this]{
-            mParsing = false;
+            updateSymbolIndex();
+            finishParsing();
 
             if (updateView)
                 emit onEndParsing(mFilesScannedCount,1);
@@ -738,10 +755,36 @@ void CppParser::parseFile(const QString &fileName, bool inProject, bool onlyIfNo
         });
         QString fName = fileName;
         if (onlyIfNotParsed && mPreprocessor.scannedFiles().contains(fName))
-            return;
+            return true;
+        // if only a function body is changed, don't reparse the whole file
+        if (!onlyIfNotParsed) {
+            mFilesToScanCount = 1;
+            mFilesScannedCount = 1;
+            if (isFileUnchanged(fileName,inProject))
+                return true;
+            if (reparseChangedFunctionBody(fileName,inProject))
+                return true;
+        }
+        mDeclarationSerialId = mSerialId;
 
         QSet<QString> files = calculateFilesToBeReparsed(fileName);
-        internalInvalidateFiles(files);
+        // reparse a header first, the files depending on it are only reparsed
+        // if its declarations are changed
+        QByteArray oldSignature;
+        QList<PStatement> oldDeclarations;
+        QSet<QString> dependedFiles;
+        PFileIncludes oldFileIncludes = mPreprocessor.includesList().value(fileName);
+        if (files.count()>1 && isHfile(fileName) && oldFileIncludes
+                && mPreprocessor.scannedFiles().contains(fileName)) {
+            oldSignature = signatureHashOf(oldFileIncludes);
+            oldDeclarations = declarationsOf(oldFileIncludes);
+            dependedFiles = oldFileIncludes->dependedFiles;
+            files.remove(fileName);
+            internalInvalidateFile(fileName);
+        } else {
+            internalInvalidateFiles(files);
+        }
+        oldFileIncludes.reset();
 
         if (inProject)
             mProjectFiles.insert(fileName);
@@ -749,12 +792,25 @@ void CppParser::parseFile(const QString &fileName, bool inProject, bool onlyIfNo
             mProjectFiles.remove(fileName);
         }
 
+        if (!oldSignature.isEmpty()) {
+            emit onProgress(fileName,mFilesToScanCount,mFilesScannedCount);
+            internalParse(fileName);
+            PFileIncludes fileIncludes = mPreprocessor.includesList().value(fileName);
+            if (fileIncludes && signatureHashOf(fileIncludes) == oldSignature
+                    && relinkDependents(fileName,oldDeclarations,dependedFiles))
+                return true;
+            oldDeclarations.clear();
+            internalInvalidateFiles(files);
+        }
+
         // Parse from disk or stream
         mFilesToScanCount = files.count();
         mFilesScannedCount = 0;
 
         // parse header files in the first parse
         foreach (const QString& file,files) {
+            if (cancelRequested())
+                return true;
             if (isHfile(file)) {
                 mFilesScannedCount++;
                 emit onProgress(file,mFilesToScanCount,mFilesScannedCount);
@@ -765,6 +821,8 @@ void CppParser::parseFile(const QString &fileName, bool inProject, bool onlyIfNo
         }
         //we only parse CFile in the second parse
         foreach (const QString& file,files) {
+            if (cancelRequested())
+                return true;
             if (isCfile(file)) {
                 mFilesScannedCount++;
                 emit onProgress(file,mFilesToScanCount,mFilesScannedCount);
@@ -774,6 +832,7 @@ void CppParser::parseFile(const QString &fileName, bool inProject, bool onlyIfNo
             }
         }
     }
+    return true;
 }
 
 void CppParser::parseFileList(bool updateView)
@@ -781,18 +840,23 @@ void CppParser::parseFileList(bool updateView)
     if (!mEnabled)
         return;
     {
-        QMutexLocker locker(&mMutex);
+        QWriteLocker locker(&mLock);
         if (mParsing || mLockCount>0)
             return;
+        startParsing();
         updateSerialId();
-        mParsing = true;
-        if (updateView)
-            emit onBusy();
-        emit onStartParsing();
-    }
+        mDeclarationSerialId = mSerialId;
+        mCancelRequested.storeRelease(0);
+        mPreprocessor.resetStatistics();
+    }
+    // slots may call back into the parser, don't emit while holding the lock
+    if (updateView)
+        emit onBusy();
+    emit onStartParsing();
     {
         auto action = finally([&,this]{
-            mParsing = false;
+            updateSymbolIndex();
+            finishParsing();
             if (updateView)
                 emit onEndParsing(mFilesScannedCount,1);
             else
@@ -801,41 +865,43 @@ void CppParser::parseFileList(bool updateView)
         // Support stopping of parsing when files closes unexpectedly
         mFilesScannedCount = 0;
         mFilesToScanCount = mFilesToScan.count();
+        // sort the files, so statements are always merged in the same order
+        QStringList files = mFilesToScan.values();
+        files.sort();
+        QStringList sortedFiles;
         // parse header files in the first parse
-        foreach (const QString& file, mFilesToScan) {
-            if (isHfile(file)) {
-                mFilesScannedCount++;
-                emit onProgress(mCurrentFile,mFilesToScanCount,mFilesScannedCount);
-                if (!mPreprocessor.scannedFiles().contains(file)) {
-                    internalParse(file);
-                }
-            }
+        foreach (const QString& file, files) {
+            if (isHfile(file))
+                sortedFiles.append(file);
         }
         //we only parse CFile in the second parse
-        foreach (const QString& file,mFilesToScan) {
-            if (isCfile(file)) {
-                mFilesScannedCount++;
-                emit onProgress(mCurrentFile,mFilesToScanCount,mFilesScannedCount);
-                if (!mPreprocessor.scannedFiles().contains(file)) {
-                    internalParse(file);
-                }
-            }
+        foreach (const QString& file, files) {
+            if (isCfile(file))
+                sortedFiles.append(file);
         }
+        parseFilesInParallel(sortedFiles);
         mFilesToScan.clear();
+        // drop symbols of the files that are not in the project anymore, or loaded
+        // from a saved index but not parsed in this session
+        if (mSymbolIndex && !cancelRequested()) {
+            updateSymbolIndex();
+            mSymbolIndex->retainFiles(mPreprocessor.scannedFiles());
+        }
     }
 }
 
 void CppParser::parseHardDefines()
 {
-    QMutexLocker locker(&mMutex);
+    QWriteLocker locker(&mLock);
     if (mParsing)
         return;
     int oldIsSystemHeader = mIsSystemHeader;
     mIsSystemHeader = true;
-    mParsing=true;
+    // readers wait for the lock, they don't need a snapshot
+    startParsing(false);
     {
         auto action = finally([&,this]{
-            mParsing = false;
+            finishParsing();
             mIsSystemHeader=oldIsSystemHeader;
         });
         for (const PDefine& define:mPreprocessor.hardDefines()) {
@@ -864,30 +930,53 @@ void CppParser::parseHardDefines()
     }
 }
 
+PreprocessStatistics CppParser::preprocessStatistics()
+{
+    QReadLocker locker(&mLock);
+    return mPreprocessor.statistics();
+}
+
 bool CppParser::parsing() const
 {
     return mParsing;
 }
 
-void CppParser::reset()
+bool CppParser::readable()
 {
-    while (true) {
-        {
-            QMutexLocker locker(&mMutex);
-            if (!mParsing && mLockCount ==0) {
-                mParsing = true;
-                break;
-            }
+    QReadLocker locker(&mLock);
+    return !mParsing || readingSnapshot();
+}
+
+bool CppParser::frozen()
+{
+    QReadLocker locker(&mLock);
+    return mLockCount>0;
+}
+
+bool CppParser::reset()
+{
+    {
+        QWriteLocker locker(&mLock);
+        if (mParsing || mLockCount>0) {
+            // Don't wait here: freezes are held by readers on the gui thread,
+            // which may be up this thread's stack. Stop the running parse,
+            // and let the caller try again later.
+            mCancelRequested.storeRelease(1);
+            return false;
         }
-        QThread::msleep(50);
-        QCoreApplication* app = QApplication::instance();
-        app->processEvents();
+        updateSerialId();
+        mDeclarationSerialId = mSerialId;
+        // the results are cleared, there's nothing to keep for the readers
+        startParsing(false);
+        mCancelRequested.storeRelease(0);
     }
+    emit onReset();
+    emit onBusy();
     {
         auto action = finally([this]{
-            mParsing = false;
+            finishParsing();
         });
-        emit  onBusy();
+        QWriteLocker locker(&mLock);
         mPreprocessor.clear();
         mUniqId = 0;
         mSkipList.clear();
@@ -904,6 +993,7 @@ void CppParser::reset()
         mCurrentClassScope.clear();
         mProjectFiles.clear();
         mFilesToScan.clear();
+        mParsedLineHashes.clear();
         mTokenizer.reset();
         // Remove all statements
         mStatementList.clear();
@@ -920,18 +1010,152 @@ void CppParser::reset()
         mPreprocessor.clearProjectIncludePaths();
         mPreprocessor.clearIncludePaths();
         mProjectFiles.clear();
+
+        // include paths are cleared, so the store doesn't match us anymore
+        mSystemHeaderStore.reset();
+        mSystemHeaderStoreSyncedCount = 0;
+        mSharedFiles.clear();
+        // the index keeps the symbols until the files are parsed again
+        mSymbolIndexDirtyFiles.clear();
     }
+    purgeInternedStrings();
+    return true;
 }
 
 void CppParser::unFreeze()
 {
-    QMutexLocker locker(&mMutex);
-    mLockCount--;
+    {
+        QWriteLocker locker(&mLock);
+        mLockCount--;
+        if (mLockCount>0 || mParsing)
+            return;
+        releaseSnapshot();
+    }
+    emit onIdle();
+}
+
+void CppParser::startParsing(bool withSnapshot)
+{
+    if (withSnapshot && mSnapshotWhileParsing && !mSnapshot)
+        mSnapshot = createSnapshot();
+    mParsing = true;
+    mParsingThread = QThread::currentThread();
+}
+
+void CppParser::finishParsing()
+{
+    {
+        QWriteLocker locker(&mLock);
+        mParsing = false;
+        mParsingThread = nullptr;
+        // frozen readers keep reading the snapshot until they are done
+        releaseSnapshot();
+        if (mLockCount>0)
+            return;
+    }
+    emit onIdle();
+}
+
+CppParser::PParseSnapshot CppParser::createSnapshot()
+{
+    PParseSnapshot snapshot = std::make_shared<ParseSnapshot>();
+    snapshot->serialId = mSerialId;
+    QHash<const Statement*,PStatement> copies;
+    QList<PStatement> newCopies;
+    auto copyOf = [this,&copies,&newCopies](const PStatement& statement) -> PStatement {
+        if (!statement || mSharedFiles.contains(statement->fileName))
+            return statement;
+        PStatement copy = copies.value(statement.get());
+        if (!copy) {
+            copy = std::make_shared<Statement>(*statement);
+            copies.insert(statement.get(),copy);
+            newCopies.append(copy);
+        }
+        return copy;
+    };
+    snapshot->statementList.copyFrom(mStatementList,copyOf);
+    for (auto it=mNamespaces.cbegin();it!=mNamespaces.cend();++it) {
+        PStatementList list = std::make_shared<StatementList>();
+        foreach (const PStatement& statement, *(it.value()))
+            list->append(copyOf(statement));
+        snapshot->namespaces.insert(it.key(),list);
+    }
+    const QHash<QString,PFileIncludes>& includesList = mPreprocessor.includesList();
+    for (auto it=includesList.begin();it!=includesList.end();++it) {
+        if (mSharedFiles.contains(it.key())) {
+            snapshot->includes.insert(it.key(),it.value());
+            continue;
+        }
+        PFileIncludes fileIncludes = std::make_shared<FileIncludes>(*(it.value()));
+        for (auto it2=fileIncludes->statements.begin();it2!=fileIncludes->statements.end();++it2)
+            it2.value() = copyOf(it2.value());
+        for (auto it2=fileIncludes->declaredStatements.begin();it2!=fileIncludes->declaredStatements.end();++it2)
+            it2.value() = copyOf(it2.value());
+        fileIncludes->scopes.clear();
+        foreach (const PCppScope& scope, it.value()->scopes.scopes())
+            fileIncludes->scopes.addScope(scope->startLine,copyOf(scope->statement));
+        snapshot->includes.insert(it.key(),fileIncludes);
+    }
+    // link the copies to each other, copying the statements they reach
+    while (!newCopies.isEmpty()) {
+        PStatement copy = newCopies.takeLast();
+        copy->parentScope = copyOf(copy->parentScope.lock());
+        for (int i=0;i<copy->inheritanceList.count();i++)
+            copy->inheritanceList[i] = copyOf(copy->inheritanceList[i].lock());
+        for (auto it=copy->children.begin();it!=copy->children.end();++it)
+            it.value() = copyOf(it.value());
+    }
+    snapshot->scannedFiles = mPreprocessor.scannedFiles();
+    return snapshot;
+}
+
+void CppParser::releaseSnapshot()
+{
+    if (!mSnapshot || mLockCount>0)
+        return;
+    PParseSnapshot snapshot = mSnapshot;
+    mSnapshot.reset();
+    QMetaObject::invokeMethod(this, [snapshot]() {}, Qt::QueuedConnection);
+}
+
+const CppParser::ParseSnapshot *CppParser::readingSnapshot() const
+{
+    if (!mSnapshot)
+        return nullptr;
+    // the parse reads its own data, and frozen readers keep the snapshot after it's done
+    if (mParsing && QThread::currentThread() == mParsingThread)
+        return nullptr;
+    return mSnapshot.get();
+}
+
+const StatementModel &CppParser::statements() const
+{
+    const ParseSnapshot* snapshot = readingSnapshot();
+    return snapshot ? snapshot->statementList : mStatementList;
+}
+
+const QHash<QString, PStatementList> &CppParser::namespaces() const
+{
+    const ParseSnapshot* snapshot = readingSnapshot();
+    return snapshot ? snapshot->namespaces : mNamespaces;
+}
+
+const QHash<QString, PFileIncludes> &CppParser::fileIncludesList()
+{
+    const ParseSnapshot* snapshot = readingSnapshot();
+    return snapshot ? snapshot->includes : mPreprocessor.includesList();
+}
+
+bool CppParser::cancelRequested() const
+{
+    return mCancelRequested.loadAcquire()!=0;
 }
 
 QSet<QString> CppParser::scannedFiles()
 {
-    return mPreprocessor.scannedFiles();
+    QReadLocker locker(&mLock);
+    const ParseSnapshot* snapshot = readingSnapshot();
+    return snapshot ? snapshot->scannedFiles : mPreprocessor.scannedFiles();
 }
 
 QString CppParser::getScopePrefix(const PStatement& statement){
@@ -1038,7 +1262,7 @@ int CppParser::getFirstTemplateParamEnd(const QString &s, int startAt)
 
 void CppParser::addFileToScan(const QString& value, bool inProject)
 {
-    QMutexLocker locker(&mMutex);
+    QWriteLocker locker(&mLock);
     //value.replace('/','\\'); // only accept full file names
 
     // Update project listing
@@ -1052,28 +1276,6 @@ void CppParser::addFileToScan(const QString& value, bool inProject)
 
 }
 
-PStatement CppParser::addInheritedStatement(const PStatement& derived, const PStatement& inherit, StatementClassScope access)
-{
-
-    PStatement statement = addStatement(
-      derived,
-      inherit->fileName,
-      inherit->hintText,
-      inherit->type, // "Type" is already in use
-      inherit->command,
-      inherit->args,
-      inherit->value,
-      inherit->line,
-      inherit->kind,
-      inherit->scope,
-      access,
-      true,
-      inherit->isStatic);
-    statement->inheritanceList.append(inherit->inheritanceList),
-    statement->isInherited = true;
-    return statement;
-}
-
 PStatement CppParser::addChildStatement(const PStatement& parent, const QString &fileName,
                                         const QString &hintText, const QString &aType,
                                         const QString &command, const QString &args,
@@ -1124,13 +1326,16 @@ PStatement CppParser::addStatement(const PStatement& parent,
         noNameArgs = removeArgNames(args);
         //find
         PStatement oldStatement = findStatementInScope(command,noNameArgs,kind,parent);
-        if (oldStatement && isDefinition && !oldStatement->hasDefinition) {
+        if (oldStatement && isDefinition && !oldStatement->hasDefinition
+                && !mSharedFiles.contains(oldStatement->fileName)) {
             oldStatement->hasDefinition = true;
             if (oldStatement->fileName!=fileName) {
                 PFileIncludes fileIncludes1=mPreprocessor.includesList().value(fileName);
                 if (fileIncludes1) {
                     fileIncludes1->statements.insert(oldStatement->fullName,
                                                      oldStatement);
+                    if (mSymbolIndex)
+                        mSymbolIndexDirtyFiles.insert(fileName);
                     fileIncludes1->dependingFiles.insert(oldStatement->fileName);
                     PFileIncludes fileIncludes2=mPreprocessor.includesList().value(oldStatement->fileName);
                     if (fileIncludes2) {
@@ -1139,22 +1344,22 @@ PStatement CppParser::addStatement(const PStatement& parent,
                 }
             }
             oldStatement->definitionLine = line;
-            oldStatement->definitionFileName = fileName;
+            oldStatement->definitionFileName = internString(fileName);
             return oldStatement;
         }
     }
     PStatement result = std::make_shared<Statement>();
     result->parentScope = parent;
     result->hintText = hintText;
-    result->type = newType;
+    result->type = internString(newType);
     if (!newCommand.isEmpty())
-        result->command = newCommand;
+        result->command = internString(newCommand);
     else {
         mUniqId++;
         result->command = QString("__STATEMENT__%1").arg(mUniqId);
     }
-    result->args = args;
-    result->noNameArgs = noNameArgs;
+    result->args = internString(args);
+    result->noNameArgs = internString(noNameArgs);
     result->value = value;
     result->kind = kind;
     //result->inheritanceList;
@@ -1163,8 +1368,8 @@ PStatement CppParser::addStatement(const PStatement& parent,
     result->hasDefinition = isDefinition;
     result->line = line;
     result->definitionLine = line;
-    result->fileName = fileName;
-    result->definitionFileName = fileName;
+    result->fileName = internString(fileName);
+    result->definitionFileName = result->fileName;
     if (!fileName.isEmpty())
         result->inProject = mIsProjectFile;
     else
@@ -1175,9 +1380,9 @@ PStatement CppParser::addStatement(const PStatement& parent,
     result->isStatic = isStatic;
     result->isInherited = false;
     if (scope == StatementScope::ssLocal)
-        result->fullName =  newCommand;
+        result->fullName =  result->command;
     else
-        result->fullName =  getFullStatementName(newCommand, parent);
+        result->fullName =  internString(getFullStatementName(newCommand, parent));
     result->usageCount = -1;
     result->freqTop = 0;
     mStatementList.add(result);
@@ -1195,6 +1400,8 @@ PStatement CppParser::addStatement(const PStatement& parent,
         if (fileIncludes) {
             fileIncludes->statements.insert(result->fullName,result);
             fileIncludes->declaredStatements.insert(result->fullName,result);
+            if (mSymbolIndex && scope != StatementScope::ssLocal)
+                mSymbolIndexDirtyFiles.insert(fileName);
         }
     }
     return result;
@@ -1204,6 +1411,8 @@ void CppParser::setInheritance(int index, const PStatement& classStatement, bool
 {
     // Clear it. Assume it is assigned
     classStatement->inheritanceList.clear();
+    classStatement->inheritanceAccessList.clear();
+    mStatementList.clearMemberViews();
     StatementClassScope lastInheritScopeType = StatementClassScope::scsNone;
     // Assemble a list of statements in text form we inherit from
     while (true) {
@@ -1223,7 +1432,6 @@ void CppParser::setInheritance(int index, const PStatement& classStatement, bool
                 PStatement statement = findStatementOf(mCurrentFile,basename,
                                                        classStatement->parentScope.lock(),true);
                 if (statement && statement->kind == StatementKind::skClass) {
-                    classStatement->inheritanceList.append(statement);
                     inheritClassStatement(classStatement,isStruct,statement,lastInheritScopeType);
                 }
             }
@@ -1727,7 +1935,7 @@ void CppParser::getFullNamespace(const QString &phrase, QString &sNamespace, QSt
     int i=0;
     while (i<strLen) {
         if ((i+1<strLen) && (phrase[i]==':') && (phrase[i+1]==':') ) {
-            if (!mNamespaces.contains(sNamespace)) {
+            if (!namespaces().contains(sNamespace)) {
                 break;
             } else {
                 lastI = i;
@@ -1737,7 +1945,7 @@ void CppParser::getFullNamespace(const QString &phrase, QString &sNamespace, QSt
         i++;
     }
     if (i>=strLen) {
-        if (mNamespaces.contains(sNamespace)) {
+        if (namespaces().contains(sNamespace)) {
             sNamespace = phrase;
             member = "";
             return;
@@ -3202,57 +3410,375 @@ void CppParser::internalParse(const QString &fileName)
     if (!isCfile(fileName) && !isHfile(fileName))  // support only known C/C++ files
         return;
 
+    QStringList preprocessResult = preprocessFile(fileName);
+    {
+        auto action = finally([this]{
+            mTokenizer.reset();
+        });
+        // Tokenize the preprocessed buffer file
+        mTokenizer.tokenize(preprocessResult);
+        //reduce memory usage
+        preprocessResult.clear();
+        handleTokens();
+    }
+}
+
+// two hashes with different seeds, so a changed line is not taken as unchanged
+static QVector<quint64> lineHashesOf(const QStringList& lines)
+{
+    QVector<quint64> hashes;
+    hashes.reserve(lines.count());
+    foreach (const QString& line, lines) {
+        hashes.append((quint64(qHash(line,0)) << 32) | qHash(line,0x9e3779b9));
+    }
+    return hashes;
+}
+
+QStringList CppParser::loadFileText(const QString &fileName)
+{
     QStringList buffer;
     if (mOnGetFileStream) {
         mOnGetFileStream(fileName,buffer);
     }
+    if (!buffer.isEmpty())
+        mParsedLineHashes.insert(fileName,lineHashesOf(buffer));
+    else
+        mParsedLineHashes.remove(fileName);
+    return buffer;
+}
+
+QStringList CppParser::preprocessFile(const QString &fileName)
+{
+    QStringList buffer = loadFileText(fileName);
 
     // Preprocess the file...
-    {
-        auto action = finally([this]{
-            mPreprocessor.reset();
-            mTokenizer.reset();
-        });
-        // Let the preprocessor augment the include records
+    auto action = finally([this]{
+        mPreprocessor.reset();
+    });
+    // Let the preprocessor augment the include records
 //        mPreprocessor.setIncludesList(mIncludesList);
 //        mPreprocessor.setScannedFileList(mScannedFiles);
 //        mPreprocessor.setIncludePaths(mIncludePaths);
 //        mPreprocessor.setProjectIncludePaths(mProjectIncludePaths);
-        mPreprocessor.setScanOptions(mParseGlobalHeaders, mParseLocalHeaders);
-        mPreprocessor.preprocess(fileName, buffer);
+    mPreprocessor.setScanOptions(mParseGlobalHeaders, mParseLocalHeaders);
+    mPreprocessor.preprocess(fileName, buffer);
 
-        QStringList preprocessResult = mPreprocessor.result();
-        //reduce memory usage
-        mPreprocessor.clearResult();
+    QStringList preprocessResult = mPreprocessor.result();
+    //reduce memory usage
+    mPreprocessor.clearResult();
 #ifdef QT_DEBUG
 //        StringsToFile(mPreprocessor.result(),"f:\\preprocess.txt");
 //        mPreprocessor.dumpDefinesTo("f:\\defines.txt");
 //        mPreprocessor.dumpIncludesListTo("f:\\includes.txt");
 #endif
+    return preprocessResult;
+}
 
-        // Tokenize the preprocessed buffer file
-        mTokenizer.tokenize(preprocessResult);
-        //reduce memory usage
-        preprocessResult.clear();
-        if (mTokenizer.tokenCount() == 0)
-            return;
+void CppParser::handleTokens()
+{
+    if (mTokenizer.tokenCount() == 0)
+        return;
 
-        // Process the token list
-        internalClear();
-        while(true) {
-            if (!handleStatement())
-                break;
-        }
-        //reduce memory usage
-        internalClear();
+    // Process the token list
+    internalClear();
+    while(true) {
+        if (!handleStatement())
+            break;
+    }
+    //reduce memory usage
+    internalClear();
+    updateSymbolIndex();
 #ifdef QT_DEBUG
 //        mTokenizer.dumpTokens("f:\\tokens.txt");
 //        mStatementList.dump("f:\\stats.txt");
 //        mStatementList.dumpAll("f:\\all-stats.txt");
 #endif
-        //reduce memory usage
+    //reduce memory usage
+    mTokenizer.reset();
+}
+
+void CppParser::parseFilesInParallel(const QStringList &files)
+{
+    // Each file is preprocessed and tokenized by a worker thread, with a copy of the
+    // include records of the files scanned when it's started. The results are merged
+    // in the order of the files, and the text of headers scanned by an earlier file
+    // meanwhile is removed, like they're skipped when the files are preprocessed one by one.
+    // Statements are added in the same order, too.
+    QThreadPool pool;
+    if (mParserThreads>0)
+        pool.setMaxThreadCount(mParserThreads);
+    struct PreprocessJob {
+        QString fileName;
+        std::shared_ptr<CppPreprocessor> preprocessor;
+        std::shared_ptr<CppTokenizer> tokenizer;
+    };
+    using PPreprocessJob = std::shared_ptr<PreprocessJob>;
+    QQueue<QFuture<PPreprocessJob>> pendingJobs;
+    // don't keep too many preprocessed files in memory
+    int maxPending = pool.maxThreadCount() * 2;
+    auto handleFirstPending = [this, &pendingJobs]() {
+        PPreprocessJob job = pendingJobs.dequeue().result();
+        // headers the worker got from the store are shared with us here
+        if (mSystemHeaderStore)
+            syncSystemHeaderStore();
+        QStringList preprocessResult = job->preprocessor->result();
+        int lineCount = preprocessResult.count();
+        if (!mPreprocessor.merge(job->fileName, *(job->preprocessor), preprocessResult))
+            return;
+        if (preprocessResult.count() == lineCount) {
+            mTokenizer = std::move(*(job->tokenizer));
+        } else {
+            mTokenizer.tokenize(preprocessResult);
+        }
+        handleTokens();
+    };
+    mPreprocessor.setScanOptions(mParseGlobalHeaders, mParseLocalHeaders);
+    foreach (const QString& file, files) {
+        mFilesScannedCount++;
+        emit onProgress(mCurrentFile,mFilesToScanCount,mFilesScannedCount);
+        if (mPreprocessor.scannedFiles().contains(file))
+            continue;
+        if (!mEnabled || cancelRequested()) {
+            pendingJobs.clear();
+            return;
+        }
+        if (!isCfile(file) && !isHfile(file))  // support only known C/C++ files
+            continue;
+        QStringList buffer = loadFileText(file);
+        std::shared_ptr<CppPreprocessor> preprocessor = mPreprocessor.createWorker();
+        PCppSystemHeaderStore store = mSystemHeaderStore;
+        if (store) {
+            // like onOpenUnscannedHeader(), but the files are only added to the worker
+            std::shared_ptr<int> syncedCount = std::make_shared<int>(mSystemHeaderStoreSyncedCount);
+            CppPreprocessor* worker = preprocessor.get();
+            preprocessor->setOnOpenUnscannedHeader([store, syncedCount, worker](const QString& fileName) {
+                if (!store->isSystemHeaderFile(fileName) || !store->ensureParsed(fileName))
+                    return;
+                foreach (const QString& sharedFile, store->publishedFilesSince(*syncedCount)) {
+                    if (worker->scannedFiles().contains(sharedFile))
+                        continue;
+                    worker->addSharedFile(sharedFile, store->fileIncludes(sharedFile),
+                                          store->fileDefines(sharedFile));
+                }
+            });
+        }
+        pendingJobs.enqueue(QtConcurrent::run(&pool, [file, buffer, preprocessor]() {
+            PPreprocessJob job = std::make_shared<PreprocessJob>();
+            job->fileName = file;
+            job->preprocessor = preprocessor;
+            preprocessor->preprocess(file, buffer);
+            job->tokenizer = std::make_shared<CppTokenizer>();
+            job->tokenizer->tokenize(preprocessor->result());
+            return job;
+        }));
+        while (pendingJobs.count() >= maxPending)
+            handleFirstPending();
+    }
+    while (!pendingJobs.isEmpty())
+        handleFirstPending();
+}
+
+static bool isInFunctionBody(PStatement statement, const PStatement& function)
+{
+    while (statement && statement->kind == StatementKind::skBlock)
+        statement = statement->parentScope.lock();
+    return statement == function;
+}
+
+bool CppParser::reparseChangedFunctionBody(const QString &fileName, bool inProject)
+{
+    // we need the text of the last parse to find out what's changed
+    if (!mOnGetFileStream || !mParsedLineHashes.contains(fileName)
+            || mProjectFiles.contains(fileName) != inProject
+            || !mPreprocessor.scannedFiles().contains(fileName))
+        return false;
+    PFileIncludes fileIncludes = mPreprocessor.includesList().value(fileName);
+    if (!fileIncludes)
+        return false;
+    const QVector<quint64> oldHashes = mParsedLineHashes.value(fileName);
+    QStringList newBuffer;
+    mOnGetFileStream(fileName,newBuffer);
+    if (newBuffer.isEmpty())
+        return false;
+    QVector<quint64> newHashes = lineHashesOf(newBuffer);
+
+    // find the changed lines
+    int minCount = std::min(oldHashes.count(),newHashes.count());
+    int prefix = 0;
+    while (prefix < minCount && oldHashes[prefix] == newHashes[prefix])
+        prefix++;
+    if (prefix == oldHashes.count() && prefix == newHashes.count())
+        return true; // nothing changed
+    int suffix = 0;
+    while (suffix < minCount - prefix
+           && oldHashes[oldHashes.count()-1-suffix] == newHashes[newHashes.count()-1-suffix])
+        suffix++;
+    // lines (prefix, oldLastChangedLine] are changed (1-based)
+    int firstChangedLine = prefix + 1;
+    int oldLastChangedLine = oldHashes.count() - suffix;
+    int lineDelta = newHashes.count() - oldHashes.count();
+
+    // the changes must be inside the body of one function
+    const QVector<PCppScope> oldScopes = fileIncludes->scopes.scopes();
+    int scopeIndex = -1;
+    for (int i=0;i<oldScopes.count() && oldScopes[i]->startLine <= firstChangedLine;i++) {
+        scopeIndex = i;
+    }
+    if (scopeIndex<0)
+        return false;
+    PStatement function = oldScopes[scopeIndex]->statement;
+    while (function && function->kind == StatementKind::skBlock)
+        function = function->parentScope.lock();
+    if (!function
+            || (function->kind != StatementKind::skFunction
+                && function->kind != StatementKind::skConstructor
+                && function->kind != StatementKind::skDestructor)
+            || !function->usingList.isEmpty())
+        return false;
+    int startIndex = scopeIndex;
+    while (startIndex > 0 && isInFunctionBody(oldScopes[startIndex-1]->statement,function))
+        startIndex--;
+    int endIndex = scopeIndex;
+    while (endIndex < oldScopes.count() && isInFunctionBody(oldScopes[endIndex]->statement,function))
+        endIndex++;
+    if (oldScopes[startIndex]->statement != function || endIndex >= oldScopes.count())
+        return false;
+    int scopeStartLine = oldScopes[startIndex]->startLine;
+    int oldScopeEndLine = oldScopes[endIndex]->startLine; // line of the closing '}'
+    if (firstChangedLine <= scopeStartLine || oldLastChangedLine >= oldScopeEndLine)
+        return false;
+    int newScopeEndLine = oldScopeEndLine + lineDelta;
+    if (newScopeEndLine > newBuffer.count())
+        return false;
+
+    QStringList lines = mPreprocessor.preprocessLines(
+                fileName,
+                newBuffer.mid(scopeStartLine-1, newScopeEndLine-scopeStartLine+1));
+    if (lines.isEmpty())
+        return false;
+    auto action = finally([this]{
+        internalClear();
         mTokenizer.reset();
+    });
+    mTokenizer.tokenize(lines);
+    for (int i=0;i<mTokenizer.tokenCount();i++) {
+        mTokenizer[i]->line += scopeStartLine - 1;
+    }
+    // find the body the same way as handleMethod()
+    int braceIndex = 0;
+    while (braceIndex < mTokenizer.tokenCount()
+           && !isblockChar(mTokenizer[braceIndex]->text.front()))
+        braceIndex++;
+    if (braceIndex >= mTokenizer.tokenCount()
+            || !mTokenizer[braceIndex]->text.startsWith('{')
+            || mTokenizer[braceIndex]->line >= firstChangedLine)
+        return false;
+    int closeIndex = skipBraces(braceIndex);
+    if (closeIndex == braceIndex || mTokenizer[closeIndex]->line != newScopeEndLine)
+        return false;
+    for (int i=braceIndex+1;i<closeIndex;i++) {
+        if (mTokenizer[i]->text == "using")
+            return false;
+    }
+
+    // remove statements declared in the old body
+    QList<PStatement> oldStatements;
+    QQueue<PStatement> queue;
+    foreach (const PStatement& statement, function->children) {
+        if (statement->kind == StatementKind::skParameter
+                || statement->command == "this"
+                || statement->command == "__func__")
+            continue;
+        queue.enqueue(statement);
+    }
+    while (!queue.isEmpty()) {
+        PStatement statement = queue.dequeue();
+        oldStatements.append(statement);
+        foreach (const PStatement& child, statement->children) {
+            queue.enqueue(child);
+        }
+    }
+    QSet<Statement*> removed;
+    for (int i=oldStatements.count()-1;i>=0;i--) {
+        removed.insert(oldStatements[i].get());
+        mStatementList.deleteStatement(oldStatements[i]);
+    }
+    for (auto it=fileIncludes->statements.begin();it!=fileIncludes->statements.end();) {
+        if (removed.contains(it.value().get()))
+            it = fileIncludes->statements.erase(it);
+        else
+            ++it;
+    }
+    for (auto it=fileIncludes->declaredStatements.begin();it!=fileIncludes->declaredStatements.end();) {
+        if (removed.contains(it.value().get()))
+            it = fileIncludes->declaredStatements.erase(it);
+        else
+            ++it;
+    }
+
+    // move statements after the changed lines
+    if (lineDelta != 0) {
+        if (mSymbolIndex)
+            mSymbolIndexDirtyFiles.insert(fileName);
+        QSet<Statement*> moved;
+        foreach (const PStatement& statement, fileIncludes->statements) {
+            queue.enqueue(statement);
+        }
+        while (!queue.isEmpty()) {
+            PStatement statement = queue.dequeue();
+            if (moved.contains(statement.get()))
+                continue;
+            moved.insert(statement.get());
+            if (statement->fileName == fileName) {
+                if (statement->line > oldLastChangedLine)
+                    statement->line += lineDelta;
+                // the function and the classes and namespaces around it end after the change
+                if (statement->endLine > oldLastChangedLine)
+                    statement->endLine += lineDelta;
+            }
+            if (statement->definitionFileName == fileName) {
+                if (statement->definitionLine > oldLastChangedLine)
+                    statement->definitionLine += lineDelta;
+                if (statement->definitionEndLine > oldLastChangedLine)
+                    statement->definitionEndLine += lineDelta;
+            }
+            foreach (const PStatement& child, statement->children) {
+                if (child->fileName == fileName)
+                    queue.enqueue(child);
+            }
+        }
     }
+
+    // parse the new body
+    mCurrentFile = fileName;
+    mIsSystemHeader = isSystemHeaderFile(mCurrentFile) || isProjectHeaderFile(mCurrentFile);
+    mIsProjectFile = mProjectFiles.contains(mCurrentFile);
+    mIsHeader = isHfile(mCurrentFile);
+    internalClear();
+    fileIncludes->scopes.clear();
+    addSoloScopeLevel(function,scopeStartLine);
+    mIndex = braceIndex + 1;
+    while (mIndex < closeIndex) {
+        if (!handleStatement())
+            break;
+    }
+    const QVector<PCppScope> bodyScopes = fileIncludes->scopes.scopes();
+
+    // splice the scopes of the new body
+    fileIncludes->scopes.clear();
+    for (int i=0;i<=startIndex;i++) {
+        fileIncludes->scopes.addScope(oldScopes[i]->startLine,oldScopes[i]->statement);
+    }
+    for (int i=1;i<bodyScopes.count();i++) {
+        if (bodyScopes[i]->startLine < newScopeEndLine)
+            fileIncludes->scopes.addScope(bodyScopes[i]->startLine,bodyScopes[i]->statement);
+    }
+    for (int i=endIndex;i<oldScopes.count();i++) {
+        fileIncludes->scopes.addScope(oldScopes[i]->startLine+lineDelta,oldScopes[i]->statement);
+    }
+    mParsedLineHashes.insert(fileName,newHashes);
+    fileIncludes->contentHash = mPreprocessor.calcContentHash(fileName,newBuffer);
+    return true;
 }
 
 void CppParser::inheritClassStatement(const PStatement& derived, bool isStruct,
@@ -3260,7 +3786,7 @@ void CppParser::inheritClassStatement(const PStatement& derived, bool isStruct,
 {
     PFileIncludes fileIncludes1=mPreprocessor.includesList().value(derived->fileName);
     PFileIncludes fileIncludes2=mPreprocessor.includesList().value(base->fileName);
-    if (fileIncludes1 && fileIncludes2) {
+    if (fileIncludes1 && fileIncludes2 && !mSharedFiles.contains(base->fileName)) {
         //derived class depeneds on base class
         fileIncludes1->dependingFiles.insert(base->fileName);
         fileIncludes2->dependedFiles.insert(derived->fileName);
@@ -3272,28 +3798,10 @@ void CppParser::inheritClassStatement(const PStatement& derived, bool isStruct,
         else
             access = StatementClassScope::scsPrivate;
     }
-    foreach (const PStatement& statement, base->children) {
-        if (statement->classScope == StatementClassScope::scsPrivate
-                || statement->kind == StatementKind::skConstructor
-                || statement->kind == StatementKind::skDestructor)
-            continue;
-        StatementClassScope m_acc;
-        switch(access) {
-        case StatementClassScope::scsPublic:
-            m_acc = statement->classScope;
-            break;
-        case StatementClassScope::scsProtected:
-            m_acc = StatementClassScope::scsProtected;
-            break;
-        case StatementClassScope::scsPrivate:
-            m_acc = StatementClassScope::scsPrivate;
-            break;
-        default:
-            m_acc = StatementClassScope::scsPrivate;
-        }
-        //inherit
-        addInheritedStatement(derived,statement,m_acc);
-    }
+    // the members aren't copied to the derived class,
+    // StatementModel looks them up in the base classes
+    derived->inheritanceList.append(base);
+    derived->inheritanceAccessList.append(access);
 }
 
 QString CppParser::expandMacroType(const QString &name)
@@ -3306,7 +3814,7 @@ void CppParser::fillListOfFunctions(const QString& fileName, int line,
                                     const PStatement& statement,
                                     const PStatement& scopeStatement, QStringList &list)
 {
-    StatementMap children = mStatementList.childrenStatements(scopeStatement);
+    StatementMap children = statements().childrenStatements(scopeStatement);
     for (const PStatement& child:children) {
         if ((statement->command == child->command)
 #ifdef Q_OS_WIN
@@ -3324,7 +3832,7 @@ void CppParser::fillListOfFunctions(const QString& fileName, int line,
 QList<PStatement> CppParser::getListOfFunctions(const QString &fileName, int line, const PStatement &statement, const PStatement &scopeStatement)
 {
     QList<PStatement> result;
-    StatementMap children = mStatementList.childrenStatements(scopeStatement);
+    StatementMap children = statements().childrenStatements(scopeStatement);
     for (const PStatement& child:children) {
         if ((statement->command == child->command)
 #ifdef Q_OS_WIN
@@ -3343,10 +3851,6 @@ QList<PStatement> CppParser::getListOfFunctions(const QString &fileName, int lin
 PStatement CppParser::findMemberOfStatement(const QString &phrase,
                                             const PStatement& scopeStatement)
 {
-    const StatementMap& statementMap =mStatementList.childrenStatements(scopeStatement);
-    if (statementMap.isEmpty())
-        return PStatement();
-
     QString s = phrase;
     //remove []
     int p = phrase.indexOf('[');
@@ -3362,7 +3866,7 @@ PStatement CppParser::findMemberOfStatement(const QString &phrase,
     if (p>=0)
         s.truncate(p);
 
-    return statementMap.value(s,PStatement());
+    return statements().findChild(scopeStatement,s);
 }
 
 PStatement CppParser::findStatementInScope(const QString &name, const QString &noNameArgs,
@@ -4203,9 +4707,7 @@ PStatement CppParser::doFindStatementInScope(const QString &name,
                                              StatementKind kind,
                                              const PStatement& scope)
 {
-    const StatementMap& statementMap =mStatementList.childrenStatements(scope);
-
-    foreach (const PStatement& statement, statementMap.values(name)) {
+    foreach (const PStatement& statement, statements().findChildren(scope,name)) {
         if (statement->kind == kind && statement->noNameArgs == noNameArgs) {
             return statement;
         }
@@ -4217,6 +4719,9 @@ void CppParser::internalInvalidateFile(const QString &fileName)
 {
     if (fileName.isEmpty())
         return;
+    // statements of shared system headers are never reparsed
+    if (mSharedFiles.contains(fileName))
+        return;
 
     //remove all statements in the file
     const QList<QString>& keys=mNamespaces.keys();
@@ -4235,6 +4740,9 @@ void CppParser::internalInvalidateFile(const QString &fileName)
     }
     // delete it from scannedfiles
     mPreprocessor.scannedFiles().remove(fileName);
+    mParsedLineHashes.remove(fileName);
+    if (mSymbolIndex)
+        mSymbolIndexDirtyFiles.insert(fileName);
 
     // remove its include files list
     PFileIncludes p = findFileIncludes(fileName, true);
@@ -4292,6 +4800,171 @@ QSet<QString> CppParser::calculateFilesToBeReparsed(const QString &fileName)
     return processed;
 }
 
+bool CppParser::isFileUnchanged(const QString &fileName, bool inProject)
+{
+    if (!mPreprocessor.scannedFiles().contains(fileName)
+            || mProjectFiles.contains(fileName) != inProject)
+        return false;
+    PFileIncludes fileIncludes = mPreprocessor.includesList().value(fileName);
+    if (!fileIncludes || fileIncludes->contentHash.isEmpty()
+            || fileIncludes->includesHash.isEmpty())
+        return false;
+    // the files it includes may be reparsed after it
+    if (fileIncludes->includesHash != mPreprocessor.calcIncludesHash(fileIncludes))
+        return false;
+    QStringList buffer;
+    if (mOnGetFileStream)
+        mOnGetFileStream(fileName,buffer);
+    return fileIncludes->contentHash == mPreprocessor.calcContentHash(fileName,buffer);
+}
+
+// name of anonymous structs/enums ("__STATEMENT__12") changes in each parse
+static QString normalizedFullName(const QString& fullName)
+{
+    if (!fullName.contains("__STATEMENT__"))
+        return fullName;
+    static QRegularExpression uniqIdRegex("__STATEMENT__\\d+");
+    QString result = fullName;
+    result.replace(uniqIdRegex,"__STATEMENT__");
+    return result;
+}
+
+QList<PStatement> CppParser::declarationsOf(const PFileIncludes &fileIncludes)
+{
+    QList<PStatement> result;
+    foreach (const PStatement& statement, fileIncludes->declaredStatements) {
+        if (statement->scope == StatementScope::ssLocal
+                || statement->kind == StatementKind::skParameter
+                || statement->fileName != fileIncludes->baseFile)
+            continue;
+        result.append(statement);
+    }
+    // the order of the declarations in the file doesn't change if only lines are
+    // inserted or removed between them
+    std::stable_sort(result.begin(),result.end(),
+                     [](const PStatement& s1, const PStatement& s2) {
+        if (s1->line != s2->line)
+            return s1->line < s2->line;
+        return normalizedFullName(s1->fullName) < normalizedFullName(s2->fullName);
+    });
+    return result;
+}
+
+QByteArray CppParser::signatureHashOf(const PFileIncludes &fileIncludes)
+{
+    if (!fileIncludes->signatureHash.isEmpty())
+        return fileIncludes->signatureHash;
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    auto addText = [&hash](const QString& text) {
+        hash.addData(reinterpret_cast<const char*>(text.constData()),text.length()*sizeof(QChar));
+        hash.addData("\0",1);
+    };
+    for (auto it=fileIncludes->includeFiles.cbegin();it!=fileIncludes->includeFiles.cend();++it) {
+        if (it.value())
+            addText(it.key());
+    }
+    QStringList usings = fileIncludes->usings.values();
+    usings.sort();
+    foreach (const QString& s, usings)
+        addText(s);
+    foreach (const PStatement& statement, declarationsOf(fileIncludes)) {
+        addText(QString::number((int)statement->kind));
+        addText(normalizedFullName(statement->fullName));
+        addText(statement->type);
+        addText(statement->args);
+        addText(statement->value);
+        addText(QString::number((int)statement->classScope));
+        addText(statement->isStatic?"static":"");
+        // where it's defined in other files is not a part of the declaration
+        addText((statement->hasDefinition
+                 && statement->definitionFileName == fileIncludes->baseFile)?"defined":"");
+        foreach (const std::weak_ptr<Statement>& weakBase, statement->inheritanceList) {
+            PStatement base = weakBase.lock();
+            if (base)
+                addText(normalizedFullName(base->fullName));
+        }
+        QStringList friends = statement->friends.values();
+        friends.sort();
+        foreach (const QString& s, friends)
+            addText(s);
+    }
+    fileIncludes->signatureHash = hash.result();
+    return fileIncludes->signatureHash;
+}
+
+bool CppParser::relinkDependents(const QString &fileName, const QList<PStatement> &oldDeclarations, const QSet<QString> &dependedFiles)
+{
+    PFileIncludes fileIncludes = mPreprocessor.includesList().value(fileName);
+    if (!fileIncludes)
+        return false;
+    QList<PStatement> newDeclarations = declarationsOf(fileIncludes);
+    if (newDeclarations.count() != oldDeclarations.count())
+        return false;
+    QHash<const Statement*,PStatement> replacements;
+    for (int i=0;i<newDeclarations.count();i++) {
+        const PStatement& oldStatement = oldDeclarations[i];
+        const PStatement& statement = newDeclarations[i];
+        replacements.insert(oldStatement.get(),statement);
+        // keep the definitions found in other files
+        if (oldStatement->hasDefinition && oldStatement->definitionFileName != fileName
+                && !statement->hasDefinition) {
+            statement->hasDefinition = true;
+            statement->definitionFileName = oldStatement->definitionFileName;
+            statement->definitionLine = oldStatement->definitionLine;
+            statement->definitionEndLine = oldStatement->definitionEndLine;
+        }
+    }
+    fileIncludes->dependedFiles = dependedFiles;
+    // walk the dependents transitively, a class may derive from a class
+    // that derives from a class in this file
+    QQueue<QString> queue;
+    QSet<QString> processed;
+    processed.insert(fileName);
+    foreach (const QString& file, dependedFiles) {
+        queue.enqueue(file);
+    }
+    while (!queue.isEmpty()) {
+        QString file = queue.dequeue();
+        if (processed.contains(file))
+            continue;
+        processed.insert(file);
+        PFileIncludes dependent = mPreprocessor.includesList().value(file);
+        if (!dependent)
+            continue;
+        foreach (const QString& s, dependent->dependedFiles) {
+            if (!processed.contains(s))
+                queue.enqueue(s);
+        }
+        for (auto it=dependent->statements.begin();it!=dependent->statements.end();++it) {
+            PStatement statement = replacements.value(it.value().get());
+            if (statement)
+                it.value() = statement;
+        }
+        foreach (const PCppScope& scope, dependent->scopes.scopes()) {
+            PStatement statement = replacements.value(scope->statement.get());
+            if (statement)
+                scope->statement = statement;
+        }
+        foreach (const PStatement& statement, dependent->declaredStatements) {
+            // locals of the function bodies in the dependent file
+            PStatement parent = replacements.value(statement->parentScope.lock().get());
+            if (parent) {
+                mStatementList.deleteStatement(statement);
+                statement->parentScope = parent;
+                mStatementList.add(statement);
+            }
+            for (int i=0;i<statement->inheritanceList.count();i++) {
+                PStatement base = replacements.value(statement->inheritanceList[i].lock().get());
+                if (base) {
+                    statement->inheritanceList[i] = base;
+                    mStatementList.clearMemberViews();
+                }
+            }
+        }
+    }
+    return true;
+}
+
 int CppParser::calcKeyLenForStruct(const QString &word)
 {
     if (word.startsWith("struct"))
@@ -4659,6 +5332,7 @@ bool CppParser::isTypeStatement(StatementKind kind) const
 
 void CppParser::updateSerialId()
 {
+    mSerialCount++;
     mSerialId = QString("%1 %2").arg(mParserId).arg(mSerialCount);
 }
 
@@ -4666,7 +5340,158 @@ void CppParser::updateSerialId()
 
 const StatementModel &CppParser::statementList() const
 {
-    return mStatementList;
+    QReadLocker locker(&mLock);
+    return statements();
+}
+
+const PCppSystemHeaderStore &CppParser::systemHeaderStore() const
+{
+    return mSystemHeaderStore;
+}
+
+void CppParser::setSystemHeaderStore(const PCppSystemHeaderStore &newSystemHeaderStore)
+{
+    QWriteLocker locker(&mLock);
+    if (mSystemHeaderStore == newSystemHeaderStore)
+        return;
+    mSystemHeaderStore = newSystemHeaderStore;
+    mSystemHeaderStoreSyncedCount = 0;
+}
+
+bool CppParser::snapshotWhileParsing() const
+{
+    return mSnapshotWhileParsing;
+}
+
+void CppParser::setSnapshotWhileParsing(bool newSnapshotWhileParsing)
+{
+    QWriteLocker locker(&mLock);
+    mSnapshotWhileParsing = newSnapshotWhileParsing;
+}
+
+bool CppParser::isSharedFile(const QString &fileName) const
+{
+    return mSharedFiles.contains(fileName);
+}
+
+void CppParser::onOpenUnscannedHeader(const QString &fileName)
+{
+    if (!mSystemHeaderStore)
+        return;
+    if (!mSystemHeaderStore->isSystemHeaderFile(fileName))
+        return;
+    if (mSystemHeaderStore->ensureParsed(fileName))
+        syncSystemHeaderStore();
+}
+
+void CppParser::syncSystemHeaderStore()
+{
+    QStringList files = mSystemHeaderStore->publishedFilesSince(mSystemHeaderStoreSyncedCount);
+    QSet<QString> linkedFiles;
+    foreach (const QString& file, files) {
+        // we have parsed it by ourself before the store does
+        if (mPreprocessor.scannedFiles().contains(file))
+            continue;
+        PFileIncludes fileIncludes = mSystemHeaderStore->fileIncludes(file);
+        if (!fileIncludes)
+            continue;
+        mPreprocessor.addSharedFile(file, fileIncludes, mSystemHeaderStore->fileDefines(file));
+        mSharedFiles.insert(file);
+        linkedFiles.insert(file);
+    }
+    // Link global statements and namespaces declared in the new files.
+    // Other members are reached through their parents, so they don't need to be linked.
+    foreach (const QString& file, linkedFiles) {
+        PFileIncludes fileIncludes = mPreprocessor.includesList().value(file);
+        foreach (const PStatement& statement, fileIncludes->declaredStatements) {
+            if (statement->kind == StatementKind::skBlock)
+                continue;
+            if (!statement->parentScope.lock())
+                mStatementList.add(statement);
+            if (statement->kind == StatementKind::skNamespace) {
+                PStatementList namespaceList = mNamespaces.value(statement->fullName,PStatementList());
+                if (!namespaceList) {
+                    namespaceList=std::make_shared<StatementList>();
+                    mNamespaces.insert(statement->fullName,namespaceList);
+                }
+                namespaceList->append(statement);
+            }
+        }
+    }
+}
+
+const PSymbolIndex &CppParser::symbolIndex() const
+{
+    return mSymbolIndex;
+}
+
+void CppParser::setSymbolIndex(const PSymbolIndex &newSymbolIndex)
+{
+    QWriteLocker locker(&mLock);
+    mSymbolIndex = newSymbolIndex;
+    mSymbolIndexDirtyFiles.clear();
+    if (!mSymbolIndex)
+        return;
+    // files parsed before the index is set
+    foreach (const QString& file, mPreprocessor.scannedFiles()) {
+        mSymbolIndexDirtyFiles.insert(file);
+    }
+}
+
+void CppParser::updateSymbolIndex()
+{
+    if (!mSymbolIndex || mSymbolIndexDirtyFiles.isEmpty())
+        return;
+    foreach (const QString& file, mSymbolIndexDirtyFiles) {
+        if (file.isEmpty() || mSharedFiles.contains(file)
+                || ::isSystemHeaderFile(file, mPreprocessor.includePaths()))
+            continue;
+        if (!mPreprocessor.scannedFiles().contains(file))
+            mSymbolIndex->removeFile(file);
+        else
+            mSymbolIndex->setFileSymbols(file, symbolIndexEntriesOf(file));
+    }
+    mSymbolIndexDirtyFiles.clear();
+}
+
+QVector<SymbolIndexEntry> CppParser::symbolIndexEntriesOf(const QString &fileName)
+{
+    QVector<SymbolIndexEntry> result;
+    PFileIncludes fileIncludes = mPreprocessor.includesList().value(fileName);
+    if (!fileIncludes)
+        return result;
+    // statements declared in the file, and definitions in the file of statements declared elsewhere
+    foreach (const PStatement& statement, fileIncludes->statements) {
+        if (statement->scope == StatementScope::ssLocal)
+            continue;
+        switch (statement->kind) {
+        case StatementKind::skParameter:
+        case StatementKind::skBlock:
+        case StatementKind::skUserCodeSnippet:
+        case StatementKind::skKeyword:
+        case StatementKind::skUnknown:
+            continue;
+        default:
+            break;
+        }
+        if (statement->command.startsWith("__STATEMENT__"))
+            continue;
+        SymbolIndexEntry entry;
+        if (statement->fileName == fileName) {
+            entry.line = statement->line;
+        } else if (statement->hasDefinition && statement->definitionFileName == fileName) {
+            entry.line = statement->definitionLine;
+        } else
+            continue;
+        entry.name = statement->command;
+        entry.fullName = statement->fullName;
+        entry.type = statement->type;
+        entry.args = statement->args;
+        entry.kind = statement->kind;
+        entry.fileName = fileName;
+        result.append(entry);
+    }
+    return result;
 }
 
 bool CppParser::parseGlobalHeaders() const
@@ -4679,6 +5504,16 @@ void CppParser::setParseGlobalHeaders(bool newParseGlobalHeaders)
     mParseGlobalHeaders = newParseGlobalHeaders;
 }
 
+int CppParser::parserThreads() const
+{
+    return mParserThreads;
+}
+
+void CppParser::setParserThreads(int newParserThreads)
+{
+    mParserThreads = newParserThreads;
+}
+
 const QSet<QString> &CppParser::includePaths()
 {
     return mPreprocessor.includePaths();
@@ -4704,6 +5539,11 @@ const QString &CppParser::serialId() const
     return mSerialId;
 }
 
+const QString &CppParser::declarationSerialId() const
+{
+    return mDeclarationSerialId;
+}
+
 int CppParser::parserId() const
 {
     return mParserId;
@@ -4734,29 +5574,6 @@ void CppParser::setEnabled(bool newEnabled)
     mEnabled = newEnabled;
 }
 
-CppFileParserThread::CppFileParserThread(
-        PCppParser parser,
-        QString fileName,
-        bool inProject,
-        bool onlyIfNotParsed,
-        bool updateView,
-        QObject *parent):QThread(parent),
-    mParser(parser),
-    mFileName(fileName),
-    mInProject(inProject),
-    mOnlyIfNotParsed(onlyIfNotParsed),
-    mUpdateView(updateView)
-{
-
-}
-
-void CppFileParserThread::run()
-{
-    if (mParser && !mParser->parsing()) {
-        mParser->parseFile(mFileName,mInProject,mOnlyIfNotParsed,mUpdateView);
-    }
-}
-
 CppFileListParserThread::CppFileListParserThread(PCppParser parser,
                                                  bool updateView, QObject *parent):
     QThread(parent),
@@ -4773,18 +5590,6 @@ void CppFileListParserThread::run()
     }
 }
 
-void parseFile(PCppParser parser, const QString& fileName, bool inProject, bool onlyIfNotParsed, bool updateView)
-{
-    if (!parser)
-        return;
-    CppFileParserThread* thread = new CppFileParserThread(parser,fileName,inProject,onlyIfNotParsed,updateView);
-    thread->connect(thread,
-                    &QThread::finished,
-                    thread,
-                    &QThread::deleteLater);
-    thread->start();
-}
-
 void parseFileList(PCppParser parser, bool updateView)
 {
     if (!parser)
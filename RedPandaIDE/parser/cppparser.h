@@ -17,13 +17,15 @@
 #ifndef CPPPARSER_H
 #define CPPPARSER_H
 
-#include <QMutex>
+#include <QReadWriteLock>
 #include <QObject>
 #include <QThread>
 #include <QVector>
 #include "statementmodel.h"
 #include "cpptokenizer.h"
 #include "cpppreprocessor.h"
+#include "cppsystemheaderstore.h"
+#include "symbolindex.h"
 
 class CppParser : public QObject
 {
@@ -87,7 +89,13 @@ public:
     PStatement findTypeDefinitionOf(const QString& fileName,
                                     const QString& aType,
                                     const PStatement& currentClass);
-    bool freeze();  // Freeze/Lock (stop reparse while searching)
+    /**
+     * @brief Freeze/Lock (stop reparse while searching). While a parse is running on
+     * another thread, the find/get methods read the results of the last parse until
+     * the parser is unfrozen.
+     * @return false if the results can't be read now (the parser is being reset)
+     */
+    bool freeze();
     bool freeze(const QString& serialId);  // Freeze/Lock (stop reparse while searching)
     QStringList getClassesList();
     QSet<QString> getFileDirectIncludes(const QString& filename);
@@ -100,12 +108,31 @@ public:
     bool isIncludeLine(const QString &line);
     bool isProjectHeaderFile(const QString& fileName);
     bool isSystemHeaderFile(const QString& fileName);
-    void parseFile(const QString& fileName, bool inProject,
+    /**
+     * @brief parse the file and the files depending on it
+     * @return false if the parser is busy or frozen and the file wasn't parsed
+     */
+    bool parseFile(const QString& fileName, bool inProject,
                    bool onlyIfNotParsed = false, bool updateView = true);
     void parseFileList(bool updateView = true);
     void parseHardDefines();
     bool parsing() const;
-    void reset();
+    /**
+     * @brief the find/get methods have results: the parser isn't parsing, or it's
+     * parsing on another thread and they read the results of the last parse
+     */
+    bool readable();
+    bool frozen();
+    /**
+     * @brief include/preprocessing counters of the last parse
+     */
+    PreprocessStatistics preprocessStatistics();
+    /**
+     * @brief clear all parsed results and settings. It doesn't wait: if the parser
+     * is parsing or frozen, the parse is asked to stop and false is returned.
+     * onIdle() is emitted when it can be done.
+     */
+    bool reset();
     void unFreeze(); // UnFree/UnLock (reparse while searching)
     QSet<QString> scannedFiles();
 
@@ -122,6 +149,11 @@ public:
     int parserId() const;
 
     const QString &serialId() const;
+    /**
+     * @brief serial id of the last parse that may change declarations. A parse that only
+     * rescans one function body or finds the file unchanged doesn't change it.
+     */
+    const QString &declarationSerialId() const;
 
     bool parseLocalHeaders() const;
     void setParseLocalHeaders(bool newParseLocalHeaders);
@@ -129,21 +161,61 @@ public:
     bool parseGlobalHeaders() const;
     void setParseGlobalHeaders(bool newParseGlobalHeaders);
 
+    int parserThreads() const;
+    /**
+     * @brief number of worker threads used to preprocess and tokenize files in parseFileList(), 0 for auto
+     */
+    void setParserThreads(int newParserThreads);
+
     const QSet<QString>& includePaths();
     const QSet<QString>& projectIncludePaths();
 
     const StatementModel &statementList() const;
 
+    const PCppSystemHeaderStore &systemHeaderStore() const;
+    /**
+     * @brief use statements of system headers from the store instead of parsing them again
+     */
+    void setSystemHeaderStore(const PCppSystemHeaderStore &newSystemHeaderStore);
+    bool isSharedFile(const QString& fileName) const;
+
+    bool snapshotWhileParsing() const;
+    /**
+     * @brief copy the results of the last parse when a parse starts, so readers on
+     * other threads (like the gui) can use them while the parse runs
+     */
+    void setSnapshotWhileParsing(bool newSnapshotWhileParsing);
+
+    const PSymbolIndex &symbolIndex() const;
+    /**
+     * @brief keep the symbols of the parsed files (except system headers) in the index
+     */
+    void setSymbolIndex(const PSymbolIndex &newSymbolIndex);
+
 signals:
     void onProgress(const QString& fileName, int total, int current);
     void onBusy();
     void onStartParsing();
     void onEndParsing(int total, int updateView);
+    /**
+     * @brief the parser is neither parsing nor frozen, so it can be reset
+     */
+    void onIdle();
+    /**
+     * @brief the parsed results are cleared by reset()
+     */
+    void onReset();
 private:
-    PStatement addInheritedStatement(
-            const PStatement& derived,
-            const PStatement& inherit,
-            StatementClassScope access);
+    // what readers on other threads see while the parser changes its statements
+    struct ParseSnapshot {
+        QString serialId;
+        StatementModel statementList;
+        QHash<QString,PStatementList> namespaces;
+        QHash<QString,PFileIncludes> includes;
+        QSet<QString> scannedFiles;
+    };
+    using PParseSnapshot = std::shared_ptr<ParseSnapshot>;
+
 
     PStatement addChildStatement(
             // support for multiple parents (only typedef struct/union use multiple parents)
@@ -355,6 +427,11 @@ private:
     void handleUsing();
     void handleVar();
     void internalParse(const QString& fileName);
+    QStringList loadFileText(const QString& fileName);
+    QStringList preprocessFile(const QString& fileName);
+    void handleTokens();
+    void parseFilesInParallel(const QStringList& files);
+    bool reparseChangedFunctionBody(const QString& fileName, bool inProject);
 //    function FindMacroDefine(const Command: AnsiString): PStatement;
     void inheritClassStatement(
             const PStatement& derived,
@@ -368,6 +445,26 @@ private:
     void internalInvalidateFile(const QString& fileName);
     void internalInvalidateFiles(const QSet<QString>& files);
     QSet<QString> calculateFilesToBeReparsed(const QString& fileName);
+    /**
+     * @brief the file and the files it includes are not changed since it's parsed
+     */
+    bool isFileUnchanged(const QString& fileName, bool inProject);
+    /**
+     * @brief non-local statements declared in the file, in a stable order
+     */
+    QList<PStatement> declarationsOf(const PFileIncludes& fileIncludes);
+    /**
+     * @brief hash of what other files can see of the file: its declarations (but not
+     * their lines), includes and usings
+     */
+    QByteArray signatureHashOf(const PFileIncludes& fileIncludes);
+    /**
+     * @brief make the files depending on the reparsed file use its new statements,
+     * instead of reparsing them. The declarations must be unchanged.
+     */
+    bool relinkDependents(const QString& fileName,
+                          const QList<PStatement>& oldDeclarations,
+                          const QSet<QString>& dependedFiles);
     int calcKeyLenForStruct(const QString& word);
 //    {
 //    function GetClass(const Phrase: AnsiString): AnsiString;
@@ -422,12 +519,43 @@ private:
     bool isTypeStatement(StatementKind kind) const;
 
     void updateSerialId();
-
+    /**
+     * @brief set mParsing, and copy the results for the readers. Called with mLock locked.
+     */
+    void startParsing(bool withSnapshot = true);
+    void finishParsing();
+    /**
+     * @brief copy the statements, namespaces and includes (except the ones of shared
+     * system headers, which are never changed by us)
+     */
+    PParseSnapshot createSnapshot();
+    /**
+     * @brief drop the snapshot unless it's frozen. It's released on the gui thread,
+     * so statements read from it stay valid until the gui is back to the event loop.
+     */
+    void releaseSnapshot();
+    /**
+     * @brief the snapshot this thread should read, or nullptr for the parser's own data
+     */
+    const ParseSnapshot* readingSnapshot() const;
+    const StatementModel& statements() const;
+    const QHash<QString,PStatementList>& namespaces() const;
+    const QHash<QString,PFileIncludes>& fileIncludesList();
+    bool cancelRequested() const;
+
+    void onOpenUnscannedHeader(const QString& fileName);
+    void syncSystemHeaderStore();
+    /**
+     * @brief send the statements of the files changed since the last call to the symbol index
+     */
+    void updateSymbolIndex();
+    QVector<SymbolIndexEntry> symbolIndexEntriesOf(const QString& fileName);
 
 private:
     int mParserId;
     int mSerialCount;
     QString mSerialId;
+    QString mDeclarationSerialId;
     int mUniqId;
     bool mEnabled;
     int mIndex;
@@ -458,6 +586,7 @@ private:
     int mFilesToScanCount; // count of files and files included in files that have to be scanned
     bool mParseLocalHeaders;
     bool mParseGlobalHeaders;
+    int mParserThreads;
     bool mIsProjectFile;
     //fMacroDefines : TList;
     int mLockCount; // lock(don't reparse) when we need to find statements in a batch
@@ -466,36 +595,31 @@ private:
     QSet<QString> mInlineNamespaces;
     //fRemovedStatements: THashedStringList; //THashedStringList<String,PRemovedStatements>
 
-    QMutex mMutex;
+    // readers (find/get methods) share it, changes to the parser's state are exclusive.
+    // Statements are changed by the parse without it, readers on other threads read
+    // mSnapshot instead while mParsing is set.
+    mutable QReadWriteLock mLock;
+    QThread* mParsingThread;
+    bool mSnapshotWhileParsing;
+    PParseSnapshot mSnapshot;
+    QAtomicInt mCancelRequested;
     GetFileStreamCallBack mOnGetFileStream;
+    // hash of each line of the last parsed text of files opened in editors,
+    // enough to find the lines changed since then
+    QHash<QString,QVector<quint64>> mParsedLineHashes;
     QMap<QString,SkipType> mCppKeywords;
     QSet<QString> mCppTypeKeywords;
-};
-using PCppParser = std::shared_ptr<CppParser>;
 
-class CppFileParserThread : public QThread {
-    Q_OBJECT
-public:
-    explicit CppFileParserThread(
-            PCppParser parser,
-            QString fileName,
-            bool inProject,
-            bool onlyIfNotParsed = false,
-            bool updateView = true,
-            QObject *parent = nullptr);
+    PCppSystemHeaderStore mSystemHeaderStore;
+    int mSystemHeaderStoreSyncedCount; // count of store's published files we have linked
+    QSet<QString> mSharedFiles; // files owned by the system header store, don't modify them
 
-private:
-    PCppParser mParser;
-    QString mFileName;
-    bool mInProject;
-    bool mOnlyIfNotParsed;
-    bool mUpdateView;
+    PSymbolIndex mSymbolIndex;
+    QSet<QString> mSymbolIndexDirtyFiles; // files whose statements are added or removed
 
-    // QThread interface
-protected:
-    void run() override;
+    friend class CppSystemHeaderStore;
 };
-using PCppParserThread = std::shared_ptr<CppFileParserThread>;
+using PCppParser = std::shared_ptr<CppParser>;
 
 class CppFileListParserThread: public QThread {
     Q_OBJECT
@@ -512,13 +636,6 @@ protected:
     void run() override;
 };
 
-void parseFile(
-    PCppParser parser,
-    const QString& fileName,
-    bool inProject,
-    bool onlyIfNotParsed = false,
-    bool updateView = true);
-
 void parseFileList(
         PCppParser parser,
         bool updateView = true);
@@ -20,10 +20,49 @@
 #include <QFile>
 #include <QTextCodec>
 #include <QDebug>
-#include <QMessageBox>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMutex>
+#include <QCryptographicHash>
+#include <limits>
+
+// Comment-free text of headers read from disk, shared by all parses (and kept
+// between them) until the file changes. Least recently used entries are dropped
+// above the size limit.
+struct SharedHeaderText {
+    QDateTime modified;
+    qint64 size;
+    QStringList lines;
+    QString includeGuard;
+    qint64 length;
+};
+
+#define HEADER_TEXT_CACHE_LIMIT (4*1024*1024) // QChars
+
+static QMutex headerTextCacheMutex;
+static QHash<QString,SharedHeaderText> headerTextCache;
+static QStringList headerTextCacheOrder;
+static qint64 headerTextCacheLength = 0;
+
+static QByteArray hashLines(const QStringList& lines)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    foreach (const QString& line, lines) {
+        // lines read from disk keep their line breaks, lines from the editor don't
+        int length = line.length();
+        while (length>0 && (line[length-1]=='\n' || line[length-1]=='\r'))
+            length--;
+        hash.addData(reinterpret_cast<const char*>(line.constData()),length*sizeof(QChar));
+        hash.addData("\n",1);
+    }
+    return hash.result();
+}
 
-CppPreprocessor::CppPreprocessor()
+CppPreprocessor::CppPreprocessor():
+    mDefineFilter(DEFINE_FILTER_BITS),
+    mHardDefineFilter(DEFINE_FILTER_BITS)
 {
+    resetStatistics();
 }
 
 void CppPreprocessor::clear()
@@ -31,11 +70,16 @@ void CppPreprocessor::clear()
     mIncludes.clear();
     mDefines.clear();
     mHardDefines.clear();
+    mDefineFilter.fill(false);
+    mHardDefineFilter.fill(false);
     mProcessed.clear();
     mFileDefines.clear();
     mBranchResults.clear();
     mResult.clear();
     mCurrentIncludes.reset();
+    mIncludeGuards.clear();
+    mIncludeFileCache.clear();
+    mIfCache.clear();
 }
 
 void CppPreprocessor::clearResult()
@@ -63,9 +107,10 @@ void CppPreprocessor::addDefineByParts(const QString &name, const QString &args,
     define->hardCoded = hardCoded;
     if (!args.isEmpty())
         parseArgs(define);
-    if (hardCoded)
+    if (hardCoded) {
         mHardDefines.insert(name,define);
-    else {
+        addToDefineFilter(mHardDefineFilter,name);
+    } else {
         PDefineMap defineMap = mFileDefines.value(mFileName,PDefineMap());
         if (!defineMap) {
             defineMap = std::make_shared<DefineMap>();
@@ -73,6 +118,7 @@ void CppPreprocessor::addDefineByParts(const QString &name, const QString &args,
         }
         defineMap->insert(define->name,define);
         mDefines.insert(name,define);
+        addToDefineFilter(mDefineFilter,name);
     }
 }
 
@@ -163,6 +209,7 @@ void CppPreprocessor::reset()
 void CppPreprocessor::resetDefines()
 {
     mDefines = mHardDefines;
+    mDefineFilter = mHardDefineFilter;
 //    mDefines.clear();
 
 //    mDefines.insert(mHardDefines);
@@ -181,10 +228,32 @@ void CppPreprocessor::preprocess(const QString &fileName, QStringList buffer)
     openInclude(fileName, buffer);
     //    StringsToFile(mBuffer,"f:\\buffer.txt");
     preprocessBuffer();
+    PFileIncludes fileIncludes = getFileIncludesEntry(fileName);
+    if (fileIncludes)
+        fileIncludes->includesHash = calcIncludesHash(fileIncludes);
     //    StringsToFile(mBuffer,"f:\\buffer.txt");
     //    StringsToFile(mResult,"f:\\log.txt");
 }
 
+QStringList CppPreprocessor::preprocessLines(const QString &fileName, const QStringList &lines)
+{
+    reset();
+    auto action = finally([this]{
+        reset();
+    });
+    QStringList text = removeComments(lines);
+    foreach (const QString& line, text) {
+        if (line.trimmed().startsWith('#'))
+            return QStringList();
+    }
+    addDefinesInFile(fileName);
+    QStringList result;
+    foreach (const QString& line, text) {
+        result.append(expandMacros(line,1));
+    }
+    return result;
+}
+
 void CppPreprocessor::invalidDefinesInFile(const QString &fileName)
 {
     PDefineMap defineMap = mFileDefines.value(fileName,PDefineMap());
@@ -252,6 +321,7 @@ void CppPreprocessor::addIncludePath(const QString &fileName)
     if (!mIncludePaths.contains(fileName)) {
         mIncludePaths.insert(fileName);
         mIncludePathList.append(fileName);
+        mIncludeFileCache.clear();
     }
 }
 
@@ -260,6 +330,7 @@ void CppPreprocessor::addProjectIncludePath(const QString &fileName)
     if (!mProjectIncludePaths.contains(fileName)) {
         mProjectIncludePaths.insert(fileName);
         mProjectIncludePathList.append(fileName);
+        mIncludeFileCache.clear();
     }
 }
 
@@ -267,12 +338,14 @@ void CppPreprocessor::clearIncludePaths()
 {
     mIncludePaths.clear();
     mIncludePathList.clear();
+    mIncludeFileCache.clear();
 }
 
 void CppPreprocessor::clearProjectIncludePaths()
 {
     mProjectIncludePaths.clear();
     mProjectIncludePathList.clear();
+    mIncludeFileCache.clear();
 }
 
 QString CppPreprocessor::getNextPreprocessor()
@@ -395,6 +468,55 @@ void CppPreprocessor::handleInclude(const QString &line, bool fromNext)
     QString fileName;
     // Get full header file name
     QString currentDir = includeTrailingPathDelimiter(extractFileDir(file->fileName));
+    mStatistics.includes++;
+    QString cacheKey = QString("%1%2\n%3").arg(fromNext?'1':'0').arg(currentDir,line);
+    auto cacheIt = mIncludeFileCache.constFind(cacheKey);
+    if (cacheIt != mIncludeFileCache.constEnd()) {
+        fileName = cacheIt.value();
+        mStatistics.includeLookupsCached++;
+    } else {
+        fileName = findIncludeFile(file->fileName, currentDir, line, fromNext);
+        if (!fileName.isEmpty())
+            mIncludeFileCache.insert(cacheKey,fileName);
+    }
+
+    if (fileName.isEmpty())
+        return;
+
+    // The header's include guard is defined, or it's a "#pragma once" header whose
+    // defines are already added, so its content would be skipped anyway.
+    // Only keep the include records and don't read or preprocess it again.
+    QString guard = mIncludeGuards.value(fileName);
+    bool included;
+    if (guard == "#pragma once")
+        included = mProcessed.contains(fileName);
+    else
+        included = !guard.isEmpty() && getDefine(guard);
+    if (included && !mIncludes.front()->fileIncludes->includeFiles.contains(fileName)) {
+        mStatistics.includesSkippedByGuard++;
+        PFileIncludes fileIncludes = getFileIncludesEntry(fileName);
+        for (PParsedFile& parsedFile:mIncludes) {
+            parsedFile->fileIncludes->includeFiles.insert(fileName,false);
+            if (fileIncludes)
+                parsedFile->fileIncludes->includeFiles =
+                        parsedFile->fileIncludes->includeFiles.unite(fileIncludes->includeFiles);
+        }
+        file->fileIncludes->includeFiles.insert(fileName,true);
+        return;
+    }
+
+    //mCurrentIncludes->includeFiles.insert(fileName,true);
+    // And open a new entry
+    bool scanned = mScannedFiles.contains(fileName);
+    openInclude(fileName);
+    // records of scanned files may be shared with other preprocessors, don't change them
+    if (!scanned)
+        mCurrentIncludes->includeFiles.insert(fileName,true);
+}
+
+QString CppPreprocessor::findIncludeFile(const QString& currentFile, const QString& currentDir,
+                                         const QString &line, bool fromNext)
+{
     QStringList includes;
     QStringList projectIncludes;
     bool found;
@@ -419,19 +541,11 @@ void CppPreprocessor::handleInclude(const QString &line, bool fromNext)
         if (s == currentDir)
             found = true;
     }
-    fileName = getHeaderFilename(
-                file->fileName,
+    return getHeaderFilename(
+                currentFile,
                 line,
                 includes,
                 projectIncludes);
-
-    if (fileName.isEmpty())
-        return;
-
-    //mCurrentIncludes->includeFiles.insert(fileName,true);
-    // And open a new entry
-    openInclude(fileName);
-    mCurrentIncludes->includeFiles.insert(fileName,true);
 }
 
 void CppPreprocessor::handlePreprocessor(const QString &value)
@@ -477,6 +591,8 @@ QString CppPreprocessor::expandMacros(const QString &line, int depth)
     //prevent infinit recursion
     if (depth > MAX_DEFINE_EXPAND_DEPTH)
         return line;
+    if (!mayContainMacro(line))
+        return line;
     QString word;
     QString newLine;
     int lenLine = line.length();
@@ -570,6 +686,50 @@ void CppPreprocessor::expandMacro(const QString &line, QString &newLine, QString
     }
 }
 
+bool CppPreprocessor::mayContainMacro(const QString &line)
+{
+    int lenLine = line.length();
+    const QChar* p = line.constData();
+    int i=0;
+    while (i<lenLine) {
+        if (!isWordChar(p[i])) {
+            i++;
+            continue;
+        }
+        int start = i;
+        while (i<lenLine && isWordChar(p[i]))
+            i++;
+        int len = i - start;
+        // words like __attribute__ are removed by expandMacro()
+        if (len>=2 && p[start]=='_' && p[start+1]=='_'
+                && p[i-1]=='_' && p[i-2]=='_')
+            return true;
+        uint hash = defineNameHash(p+start,len);
+        if (mDefineFilter.testBit(hash % DEFINE_FILTER_BITS)
+                && mDefineFilter.testBit((hash >> 16) % DEFINE_FILTER_BITS))
+            return true;
+    }
+    return false;
+}
+
+uint CppPreprocessor::defineNameHash(const QChar *name, int length)
+{
+    // FNV-1a
+    uint hash = 2166136261u;
+    for (int i=0;i<length;i++) {
+        hash ^= name[i].unicode();
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void CppPreprocessor::addToDefineFilter(QBitArray &filter, const QString &name)
+{
+    uint hash = defineNameHash(name.constData(),name.length());
+    filter.setBit(hash % DEFINE_FILTER_BITS);
+    filter.setBit((hash >> 16) % DEFINE_FILTER_BITS);
+}
+
 QString CppPreprocessor::removeGCCAttributes(const QString &line)
 {
     QString newLine = "";
@@ -631,6 +791,7 @@ void CppPreprocessor::openInclude(const QString &fileName, QStringList bufferedT
     if (mIncludes.size()>0) {
         PParsedFile topFile = mIncludes.front();
         if (topFile->fileIncludes->includeFiles.contains(fileName)) {
+            mStatistics.includesAlreadyIncluded++;
             return; //already included
         }
         for (PParsedFile& parsedFile:mIncludes) {
@@ -658,6 +819,12 @@ void CppPreprocessor::openInclude(const QString &fileName, QStringList bufferedT
 //          IncludeFiles := IncludeFiles + AnsiQuotedStr(FileName, '"') + ',';
 //    }
 
+    if (bufferedText.isEmpty() && !mScannedFiles.contains(fileName)
+            && mOnOpenUnscannedHeader) {
+        // give the owner a chance to provide the header parsed elsewhere
+        mOnOpenUnscannedHeader(fileName);
+    }
+
     // Create and add new buffer/position
     PParsedFile parsedFile = std::make_shared<ParsedFile>();
     parsedFile->index = 0;
@@ -695,10 +862,15 @@ void CppPreprocessor::openInclude(const QString &fileName, QStringList bufferedT
         bool isSystemFile = isSystemHeaderFile(fileName, mIncludePaths);
         if ((mParseSystem && isSystemFile) || (mParseLocal && !isSystemFile)) {
             if (!bufferedText.isEmpty()) {
-                parsedFile->buffer  = bufferedText;
+                parsedFile->buffer  = removeComments(bufferedText);
+                setIncludeGuard(fileName,findIncludeGuard(parsedFile->buffer));
             } else {
-                parsedFile->buffer = readFileToLines(fileName);
+                parsedFile->buffer = readHeaderText(fileName);
             }
+            if (!isSystemFile)
+                mCurrentIncludes->contentHash = hashLines(parsedFile->buffer);
+            mStatistics.filesRead++;
+            mStatistics.linesRead += parsedFile->buffer.count();
         }
     } else {
         //add defines of already parsed including headers;
@@ -715,7 +887,6 @@ void CppPreprocessor::openInclude(const QString &fileName, QStringList bufferedT
     // Process it
     mIndex = parsedFile->index;
     mFileName = parsedFile->fileName;
-    parsedFile->buffer = removeComments(parsedFile->buffer);
     mBuffer = parsedFile->buffer;
 
 //    for (int i=0;i<mBuffer.count();i++) {
@@ -732,6 +903,123 @@ void CppPreprocessor::openInclude(const QString &fileName, QStringList bufferedT
 }
 
 
+QStringList CppPreprocessor::readHeaderText(const QString &fileName)
+{
+    QFileInfo info(fileName);
+    QDateTime modified = info.lastModified();
+    qint64 size = info.size();
+    {
+        QMutexLocker locker(&headerTextCacheMutex);
+        auto it = headerTextCache.constFind(fileName);
+        if (it!=headerTextCache.constEnd()
+                && it->modified == modified
+                && it->size == size) {
+            mStatistics.filesShared++;
+            setIncludeGuard(fileName,it->includeGuard);
+            headerTextCacheOrder.removeOne(fileName);
+            headerTextCacheOrder.append(fileName);
+            return it->lines;
+        }
+    }
+    SharedHeaderText text;
+    text.modified = modified;
+    text.size = size;
+    text.lines = removeComments(readFileToLines(fileName));
+    text.includeGuard = findIncludeGuard(text.lines);
+    text.length = 0;
+    foreach (const QString& line, text.lines)
+        text.length += line.length();
+    setIncludeGuard(fileName,text.includeGuard);
+
+    QMutexLocker locker(&headerTextCacheMutex);
+    auto it = headerTextCache.find(fileName);
+    if (it!=headerTextCache.end()) {
+        headerTextCacheLength -= it->length;
+        headerTextCacheOrder.removeOne(fileName);
+    }
+    headerTextCache.insert(fileName,text);
+    headerTextCacheOrder.append(fileName);
+    headerTextCacheLength += text.length;
+    while (headerTextCacheLength > HEADER_TEXT_CACHE_LIMIT && headerTextCacheOrder.count()>1) {
+        QString oldest = headerTextCacheOrder.takeFirst();
+        headerTextCacheLength -= headerTextCache.value(oldest).length;
+        headerTextCache.remove(oldest);
+    }
+    return text.lines;
+}
+
+void CppPreprocessor::setIncludeGuard(const QString &fileName, const QString &guard)
+{
+    if (guard.isEmpty())
+        mIncludeGuards.remove(fileName);
+    else
+        mIncludeGuards.insert(fileName,guard);
+}
+
+QString CppPreprocessor::findIncludeGuard(const QStringList &buffer) const
+{
+    // look for "#pragma once" or
+    //   #ifndef X
+    //   #define X
+    //   ...
+    //   #endif
+    // with nothing outside of the #ifndef/#endif
+    QString guard;
+    int state = 0; // 0: before #ifndef, 1: before #define, 2: in the guard, 3: after #endif
+    int level = 0;
+    foreach (const QString& s, buffer) {
+        QString line = s.trimmed();
+        if (line.isEmpty())
+            continue;
+        if (!line.startsWith('#')) {
+            if (state==2)
+                continue;
+            if (state==0 || state==3)
+                return QString();
+            break;
+        }
+        line = line.mid(1).trimmed();
+        if (line.startsWith("pragma")
+                && line.mid(QString("pragma").length()).trimmed() == "once") {
+            return "#pragma once";
+        }
+        switch (state) {
+        case 0:
+            if (line.startsWith("ifndef")) {
+                guard = line.mid(QString("ifndef").length()).trimmed();
+                state = 1;
+                level = 1;
+            } else
+                return QString();
+            break;
+        case 1:
+            if (line.startsWith("define")
+                    && line.mid(QString("define").length()).trimmed() == guard) {
+                state = 2;
+            } else
+                return QString();
+            break;
+        case 2:
+            if (line.startsWith("if"))
+                level++;
+            else if (level==1 && (line.startsWith("else") || line.startsWith("elif")))
+                return QString(); // the content after #else is used when the macro is defined
+            else if (line.startsWith("endif")) {
+                level--;
+                if (level==0)
+                    state = 3;
+            }
+            break;
+        case 3:
+            // something after the guard's #endif
+            return QString();
+        }
+    }
+    if (state==3)
+        return guard;
+    return QString();
+}
+
 void CppPreprocessor::closeInclude()
 {
     if (mIncludes.isEmpty())
@@ -815,6 +1103,7 @@ void CppPreprocessor::addDefinesInFile(const QString &fileName)
     if (defineList) {
         foreach (const PDefine& define, defineList->values()) {
             mDefines.insert(define->name,define);
+            addToDefineFilter(mDefineFilter,define->name);
         }
     }
 }
@@ -833,6 +1122,8 @@ void CppPreprocessor::parseArgs(PDefine define)
     QList<PDefineArgToken> tokens = tokenizeValue(define->value);
 
     QString formatStr = "";
+    // formatStr split at the args, so expandFunction() doesn't need to search for them
+    QString formatPart = "";
     DefineArgTokenType lastTokenType=DefineArgTokenType::Other;
     int index;
     foreach (const PDefineArgToken& token, tokens) {
@@ -843,13 +1134,20 @@ void CppPreprocessor::parseArgs(PDefine define)
                 define->argUsed[index] = true;
                 if (lastTokenType == DefineArgTokenType::Sharp) {
                     formatStr+= "\"%"+QString("%1").arg(index+1)+"\"";
+                    define->formatParts.append(formatPart+'"');
+                    define->formatArgs.append(index);
+                    formatPart = "\"";
                     break;
                 } else {
                     formatStr+= "%"+QString("%1").arg(index+1);
+                    define->formatParts.append(formatPart);
+                    define->formatArgs.append(index);
+                    formatPart = "";
                     break;
                 }
             }
             formatStr += token->value;
+            formatPart += token->value;
             break;
         case DefineArgTokenType::DSharp:
         case DefineArgTokenType::Sharp:
@@ -857,6 +1155,7 @@ void CppPreprocessor::parseArgs(PDefine define)
         case DefineArgTokenType::Space:
         case DefineArgTokenType::Symbol:
             formatStr+=token->value;
+            formatPart+=token->value;
             break;
         default:
             break;
@@ -864,6 +1163,7 @@ void CppPreprocessor::parseArgs(PDefine define)
         lastTokenType = token->type;
     }
     define->formatValue = formatStr;
+    define->formatParts.append(formatPart);
 }
 
 QList<PDefineArgToken> CppPreprocessor::tokenizeValue(const QString &value)
@@ -1167,620 +1467,783 @@ bool CppPreprocessor::isDigit(const QChar &ch)
     return (ch>='0' && ch<='9');
 }
 
-bool CppPreprocessor::isNumberChar(const QChar &ch)
+QString CppPreprocessor::lineBreak()
 {
-    if (ch>='0' && ch<='9')
-        return true;
-    if (ch>='a' && ch<='f')
-        return true;
-    if (ch>='A' && ch<='F')
-        return true;
-    switch(ch.unicode()) {
-    case 'x':
-    case 'X':
-    case 'u':
-    case 'U':
-    case 'l':
-    case 'L':
-        return true;
-    default:
+    return "\n";
+}
+
+#define IF_CACHE_LIMIT 8192
+#define IF_MAX_EXPANSIONS 1024
+
+bool CppPreprocessor::evaluateIf(const QString &line)
+{
+    mStatistics.ifEvaluations++;
+    // libstdc++ tests the same conditions in many headers
+    auto it = mIfCache.constFind(line);
+    if (it != mIfCache.constEnd() && isIfCacheEntryValid(it.value())) {
+        mStatistics.ifCacheHits++;
+        return it->result;
+    }
+    IfTokens tokens;
+    if (!tokenizeIfExpression(line,tokens))
+        return false;
+    IfCacheEntry entry;
+    bool cacheable = true;
+    if (!expandIfTokens(tokens,entry,cacheable))
         return false;
+    int pos = 0;
+    IfValue value;
+    // a broken expression is false, like gcc skips the branch after the error
+    entry.result = evalIfExpr(tokens,pos,value,true)
+            && pos == tokens.count()
+            && value.value != 0;
+    if (cacheable) {
+        if (mIfCache.count() >= IF_CACHE_LIMIT)
+            mIfCache.clear();
+        mIfCache.insert(line,entry);
     }
+    return entry.result;
 }
 
-QString CppPreprocessor::lineBreak()
+bool CppPreprocessor::isIfCacheEntryValid(const IfCacheEntry &entry)
 {
-    return "\n";
+    foreach (const auto& macro, entry.macros) {
+        if (getDefine(macro.first) != macro.second)
+            return false;
+    }
+    return true;
 }
 
-bool CppPreprocessor::evaluateIf(const QString &line)
+static bool isIfIdentChar(const QChar& ch)
 {
-    QString newLine = expandDefines(line); // replace FOO by numerical value of FOO
-    return  evaluateExpression(newLine);
-}
-
-QString CppPreprocessor::expandDefines(QString line)
-{
-    int searchPos = 0;
-    while (searchPos < line.length()) {
-        // We have found an identifier. It is not a number suffix. Try to expand it
-        if (isMacroIdentChar(line[searchPos]) && (
-                    (searchPos == 0) || !isDigit(line[searchPos - 1]))) {
-            int head = searchPos;
-            int tail = searchPos;
-
-            // Get identifier name (numbers are allowed, but not at the start
-            while ((tail < line.length()) && (isMacroIdentChar(line[tail]) || isDigit(line[head])))
-                tail++;
-//            qDebug()<<"1 "<<head<<tail<<line;
-            QString name = line.mid(head,tail-head);
-            int nameStart = head;
-            int nameEnd = tail;
-
-            if (name == "defined") {
-                //expand define
-                //tail = searchPos + name.length();
-                while ((tail < line.length()) && isSpaceChar(line[tail]))
-                    tail++; // skip spaces
-                int defineStart;
-
-                // Skip over its arguments
-                if ((tail < line.length()) && (line[tail]=='(')) {
-                    //braced argument (next word)
-                    defineStart = tail+1;
-                    if (!skipBraces(line, tail)) {
-                        line = ""; // broken line
-                        break;
-                    }
-                } else {
-                    //none braced argument (next word)
-                    defineStart = tail;
-                    if ((tail>=line.length()) || !isMacroIdentChar(line[searchPos])) {
-                        line = ""; // broken line
-                        break;
+    return ch.isLetterOrNumber() || ch == '_';
+}
+
+bool CppPreprocessor::tokenizeIfExpression(const QString &expr, IfTokens &tokens)
+{
+    static const QStringList twoCharOperators {
+        "<<", ">>", "<=", ">=", "==", "!=", "&&", "||"
+    };
+    int i = 0;
+    int len = expr.length();
+    while (i < len) {
+        QChar ch = expr[i];
+        if (isSpaceChar(ch) || isLineChar(ch)) {
+            i++;
+        } else if (isDigit(ch)) {
+            // pp-number: digits, letters (hex digits and suffixes) and digit separators
+            int start = i;
+            while (i < len && (isIfIdentChar(expr[i]) || expr[i] == '\'' || expr[i] == '.'))
+                i++;
+            QString s = expr.mid(start,i-start);
+            s.remove('\'');
+            int suffixStart = s.length();
+            while (suffixStart > 0) {
+                QChar c = s[suffixStart-1].toLower();
+                if (c != 'u' && c != 'l')
+                    break;
+                suffixStart--;
+            }
+            QString suffix = s.mid(suffixStart).toLower();
+            s.truncate(suffixStart);
+            int base = 10;
+            if (s.startsWith("0x",Qt::CaseInsensitive)) {
+                base = 16;
+                s.remove(0,2);
+            } else if (s.startsWith("0b",Qt::CaseInsensitive)) {
+                base = 2;
+                s.remove(0,2);
+            } else if (s.length()>1 && s.startsWith('0')) {
+                base = 8;
+                s.remove(0,1);
+            }
+            bool ok;
+            quint64 value = s.toULongLong(&ok,base);
+            if (!ok) // floating point numbers are not allowed, too
+                return false;
+            IfToken token;
+            token.type = IfToken::Type::Number;
+            token.text = expr.mid(start,i-start);
+            token.value = (qint64)value;
+            // too big for intmax_t is unsigned, like gcc
+            token.isUnsigned = suffix.contains('u') || value > (quint64)std::numeric_limits<qint64>::max();
+            tokens.append(token);
+        } else if (isMacroIdentChar(ch)) {
+            int start = i;
+            while (i < len && isIfIdentChar(expr[i]))
+                i++;
+            IfToken token;
+            token.type = IfToken::Type::Identifier;
+            token.text = expr.mid(start,i-start);
+            token.value = 0;
+            token.isUnsigned = false;
+            tokens.append(token);
+            // __has_include(<xxx>), __has_include_next("xxx") or gcc's __has_include__(...)
+            if (token.text.startsWith("__has_include")) {
+                int j = i;
+                while (j < len && isSpaceChar(expr[j]))
+                    j++;
+                if (j < len && expr[j] == '(') {
+                    j++;
+                    while (j < len && isSpaceChar(expr[j]))
+                        j++;
+                    if (j < len && (expr[j] == '<' || expr[j] == '"')) {
+                        QChar closeChar = (expr[j] == '<')?'>':'"';
+                        int end = expr.indexOf(closeChar,j+1);
+                        if (end < 0)
+                            return false;
+                        IfToken parenToken;
+                        parenToken.type = IfToken::Type::Operator;
+                        parenToken.text = "(";
+                        parenToken.value = 0;
+                        parenToken.isUnsigned = false;
+                        tokens.append(parenToken);
+                        IfToken nameToken;
+                        nameToken.type = IfToken::Type::HeaderName;
+                        nameToken.text = expr.mid(j,end-j+1);
+                        nameToken.value = 0;
+                        nameToken.isUnsigned = false;
+                        tokens.append(nameToken);
+                        i = end+1;
                     }
-                    while ((tail < line.length()) && (isMacroIdentChar(line[tail]) || isDigit(line[tail])))
-                        tail++;
                 }
-//                qDebug()<<"2 "<<defineStart<<tail<<line;
-                name = line.mid(defineStart, tail - defineStart);
-                PDefine define = getDefine(name);
-                QString insertValue;
-                if (!define) {
-                    insertValue = "0";
-                } else {
-                    insertValue = "1";
+            }
+        } else if (ch == '\'') {
+            // character literal
+            int j = i+1;
+            if (j >= len)
+                return false;
+            qint64 value;
+            if (expr[j] == '\\') {
+                j++;
+                if (j >= len)
+                    return false;
+                switch(expr[j].unicode()) {
+                case 'n': value = '\n'; j++; break;
+                case 't': value = '\t'; j++; break;
+                case 'r': value = '\r'; j++; break;
+                case 'a': value = '\a'; j++; break;
+                case 'b': value = '\b'; j++; break;
+                case 'f': value = '\f'; j++; break;
+                case 'v': value = '\v'; j++; break;
+                case 'x': {
+                    j++;
+                    int start = j;
+                    while (j < len && isIfIdentChar(expr[j]))
+                        j++;
+                    bool ok;
+                    value = expr.mid(start,j-start).toLongLong(&ok,16);
+                    if (!ok)
+                        return false;
+                    break;
                 }
-                // Insert found value at place
-                line.remove(searchPos, tail-searchPos+1);
-                line.insert(searchPos,insertValue);
-            } else if ((name == "and") || (name == "or")) {
-                searchPos = tail; // Skip logical operators
-            }  else {
-                 // We have found a regular define. Replace it by its value
-                // Does it exist in the database?
-                PDefine define = getDefine(name);
-                QString insertValue;
-                if (!define) {
-                    insertValue = "0";
-                } else {
-                    while ((tail < line.length()) && isSpaceChar(line[tail]))
-                        tail++;// skip spaces
-                    // It is a function. Expand arguments
-                    if ((tail < line.length()) && (line[tail] == '(')) {
-                        head=tail;
-                        if (skipBraces(line, tail)) {
-//                            qDebug()<<"3 "<<line<<head<<tail;
-                            QString args = line.mid(head,tail-head+1);
-                            insertValue = expandFunction(define,args);
-                            nameEnd = tail+1;
-                        } else {
-                            line = "";// broken line
-                            break;
-                        }
-                        // Replace regular define
+                default:
+                    if (expr[j]>='0' && expr[j]<='7') {
+                        int start = j;
+                        while (j < len && j-start<3 && expr[j]>='0' && expr[j]<='7')
+                            j++;
+                        value = expr.mid(start,j-start).toLongLong(nullptr,8);
                     } else {
-                        if (!define->value.isEmpty())
-                            insertValue = define->value;
-                        else
-                            insertValue = "0";
+                        value = expr[j].unicode();
+                        j++;
                     }
                 }
-                // Insert found value at place
-                line.remove(nameStart, nameEnd - nameStart);
-                line.insert(searchPos,insertValue);
+            } else {
+                value = expr[j].unicode();
+                j++;
             }
+            if (j >= len || expr[j] != '\'')
+                return false;
+            IfToken token;
+            token.type = IfToken::Type::Number;
+            token.text = expr.mid(i,j-i+1);
+            token.value = value;
+            token.isUnsigned = false;
+            tokens.append(token);
+            i = j+1;
         } else {
-            searchPos ++ ;
+            IfToken token;
+            token.type = IfToken::Type::Operator;
+            token.value = 0;
+            token.isUnsigned = false;
+            if (i+1 < len && twoCharOperators.contains(expr.mid(i,2))) {
+                token.text = expr.mid(i,2);
+                i += 2;
+            } else {
+                switch(ch.unicode()) {
+                case '+': case '-': case '*': case '/': case '%':
+                case '<': case '>': case '!': case '~': case '&':
+                case '|': case '^': case '(': case ')': case '?':
+                case ':': case ',':
+                    token.text = ch;
+                    i++;
+                    break;
+                default:
+                    return false;
+                }
+            }
+            tokens.append(token);
         }
     }
-    return line;
+    return true;
 }
 
-bool CppPreprocessor::skipBraces(const QString &line, int &index, int step)
+bool CppPreprocessor::isIfOperator(const IfToken& token, const QString& op)
 {
-    int level = 0;
-    while ((index >= 0) && (index < line.length())) { // Find the corresponding opening brace
-        if (line[index] == '(') {
-            level++;
-        } else if (line[index] == ')') {
-            level--;
-        }
-        if (level == 0)
-            return true;
-        index+=step;
-    }
-    return false;
+    return token.type == IfToken::Type::Operator && token.text == op;
 }
 
-QString CppPreprocessor::expandFunction(PDefine define, QString args)
+CppPreprocessor::IfToken CppPreprocessor::ifNumberToken(qint64 value)
 {
-    // Replace function by this string
-    QString result = define->formatValue;
-    if (args.startsWith('(') && args.endsWith(')')) {
-        args = args.mid(1,args.length()-2);
-    }
-
-    QStringList argValues = args.split(",");
-    if (argValues.length() == define->argList.length()
-            && argValues.length()>0) {
-        for (int i=0;i<argValues.length();i++) {
-            if (define->argUsed[i]) {
-                QString argValue = argValues[i];
-                result=result.arg(argValue.trimmed());
-            }
-        }
-    }
-    result.replace("%%","%");
-
-    return result;
+    IfToken token;
+    token.type = IfToken::Type::Number;
+    token.text = QString::number(value);
+    token.value = value;
+    token.isUnsigned = false;
+    return token;
 }
 
-bool CppPreprocessor::skipSpaces(const QString &expr, int &pos)
+bool CppPreprocessor::expandIfTokens(IfTokens &tokens, IfCacheEntry &entry, bool& cacheable)
 {
-    while (pos<expr.length() && isSpaceChar(expr[pos]))
-        pos++;
-    return pos<expr.length();
+    QSet<QString> usedMacros;
+    int expansions = 0;
+    return expandIfTokens(tokens,entry,usedMacros,expansions,cacheable,false);
 }
 
-bool CppPreprocessor::evalNumber(const QString &expr, int &result, int &pos)
+PDefine CppPreprocessor::findIfMacro(const QString &name, IfCacheEntry &entry, QSet<QString> &usedMacros)
 {
-    if (!skipSpaces(expr,pos))
-        return false;
-    QString s;
-    while (pos<expr.length() && isNumberChar(expr[pos])) {
-        s+=expr[pos];
-        pos++;
-    }
-    bool ok;
-
-    if (s.endsWith("LL",Qt::CaseInsensitive)) {
-        s.remove(s.length()-2,2);
-        result = s.toLongLong(&ok);
-    } else if (s.endsWith("L",Qt::CaseInsensitive)) {
-        s.remove(s.length()-1,1);
-        result = s.toLong(&ok);
-    } else if (s.endsWith("ULL",Qt::CaseInsensitive)) {
-        s.remove(s.length()-3,3);
-        result = s.toULongLong(&ok);
-    } else if (s.endsWith("UL",Qt::CaseInsensitive)) {
-        s.remove(s.length()-2,2);
-        result = s.toULong(&ok);
-    } else if (s.endsWith("U",Qt::CaseInsensitive)) {
-        s.remove(s.length()-1,1);
-        result = s.toUInt(&ok);
-    } else {
-        result = s.toInt(&ok);
+    PDefine define = getDefine(name);
+    if (!usedMacros.contains(name)) {
+        usedMacros.insert(name);
+        entry.macros.append(QPair<QString,PDefine>(name,define));
     }
-    return ok;
+    return define;
 }
 
-bool CppPreprocessor::evalTerm(const QString &expr, int &result, int &pos)
+/*
+ * inArgument: the tokens are an argument of a function-like macro, only the
+ * macros in it are expanded, other identifiers are kept for the macro body
+ */
+bool CppPreprocessor::expandIfTokens(IfTokens &tokens, IfCacheEntry &entry, QSet<QString> &usedMacros,
+                                     int &expansions, bool &cacheable, bool inArgument)
 {
-    if (!skipSpaces(expr,pos))
-        return false;
-    if (expr[pos]=='(') {
-        pos++;
-        if (!evalExpr(expr,result,pos))
-            return false;
-        if (!skipSpaces(expr,pos))
-            return false;
-        if (expr[pos]!=')')
-            return false;
-        pos++;
-        return true;
-    } else {
-        return evalNumber(expr,result,pos);
+    int i = 0;
+    // expanded macros are put back in place of their names and scanned again
+    while (i < tokens.count()) {
+        if (tokens[i].type != IfToken::Type::Identifier) {
+            i++;
+            continue;
+        }
+        QString name = tokens[i].text;
+        if (name == "defined") {
+            int j = i+1;
+            bool braced = (j < tokens.count() && isIfOperator(tokens[j],"("));
+            if (braced)
+                j++;
+            if (j >= tokens.count() || tokens[j].type != IfToken::Type::Identifier)
+                return false;
+            bool isDefined = (findIfMacro(tokens[j].text,entry,usedMacros) != nullptr);
+            if (braced) {
+                j++;
+                if (j >= tokens.count() || !isIfOperator(tokens[j],")"))
+                    return false;
+            }
+            if (inArgument) {
+                // the operand of defined is not expanded
+                i = j+1;
+                continue;
+            }
+            tokens.remove(i,j-i+1);
+            tokens.insert(i,ifNumberToken(isDefined?1:0));
+            i++;
+            continue;
+        }
+        PDefine define = findIfMacro(name,entry,usedMacros);
+        // a macro is not expanded again in its own expansion (#define X (X+1)),
+        // the name is left as an identifier like gcc does
+        if (define && !tokens[i].hideSet.contains(name)) {
+            expansions++;
+            if (expansions > IF_MAX_EXPANSIONS) // recursive macros
+                return false;
+            QString value;
+            int end = i;
+            if (define->args.isEmpty()) {
+                value = define->value;
+            } else {
+                // a function-like macro not followed by '(' is not expanded
+                if (i+1 >= tokens.count() || !isIfOperator(tokens[i+1],"(")) {
+                    if (!inArgument)
+                        tokens[i] = ifNumberToken(0);
+                    i++;
+                    continue;
+                }
+                QVector<IfTokens> argTokens;
+                IfTokens arg;
+                int level = 0;
+                int j = i+2;
+                for (;j<tokens.count();j++) {
+                    if (isIfOperator(tokens[j],"(")) {
+                        level++;
+                    } else if (isIfOperator(tokens[j],")")) {
+                        if (level == 0)
+                            break;
+                        level--;
+                    } else if (level == 0 && isIfOperator(tokens[j],",")) {
+                        argTokens.append(arg);
+                        arg.clear();
+                        continue;
+                    }
+                    arg.append(tokens[j]);
+                }
+                if (j >= tokens.count())
+                    return false;
+                if (!arg.isEmpty() || !argTokens.isEmpty())
+                    argTokens.append(arg);
+                // arguments are expanded before they are put into the body
+                QStringList args;
+                for (IfTokens& argToken:argTokens) {
+                    if (!expandIfTokens(argToken,entry,usedMacros,expansions,cacheable,true))
+                        return false;
+                    QString argText;
+                    foreach (const IfToken& token, argToken) {
+                        if (!argText.isEmpty())
+                            argText += ' ';
+                        argText += token.text;
+                    }
+                    args.append(argText);
+                }
+                value = expandFunction(define,args);
+                end = j;
+            }
+            IfTokens valueTokens;
+            if (!tokenizeIfExpression(value,valueTokens))
+                return false;
+            QSet<QString> hideSet = tokens[i].hideSet;
+            hideSet.insert(name);
+            tokens.remove(i,end-i+1);
+            for (int k=valueTokens.count()-1;k>=0;k--) {
+                valueTokens[k].hideSet = hideSet;
+                tokens.insert(i,valueTokens[k]);
+            }
+            continue;
+        }
+        if (name.startsWith("__has_include")) {
+            // depends on the files on disk, don't cache
+            cacheable = false;
+            if (i+3 >= tokens.count()
+                    || !isIfOperator(tokens[i+1],"(")
+                    || tokens[i+2].type != IfToken::Type::HeaderName
+                    || !isIfOperator(tokens[i+3],")"))
+                return false;
+            bool found = false;
+            if (!mIncludes.isEmpty()) {
+                PParsedFile file = mIncludes.back();
+                QString currentDir = includeTrailingPathDelimiter(extractFileDir(file->fileName));
+                found = !findIncludeFile(file->fileName, currentDir, tokens[i+2].text,
+                                         name.startsWith("__has_include_next")).isEmpty();
+            }
+            tokens.remove(i,4);
+            tokens.insert(i,ifNumberToken(found?1:0));
+            i++;
+            continue;
+        }
+        if (name.startsWith("__has_")
+                && i+1 < tokens.count() && isIfOperator(tokens[i+1],"(")) {
+            // __has_builtin(), __has_attribute() ... are not supported
+            int level = 0;
+            int j = i+1;
+            for (;j<tokens.count();j++) {
+                if (isIfOperator(tokens[j],"("))
+                    level++;
+                else if (isIfOperator(tokens[j],")")) {
+                    level--;
+                    if (level == 0)
+                        break;
+                }
+            }
+            if (j >= tokens.count())
+                return false;
+            tokens.remove(i,j-i+1);
+            tokens.insert(i,ifNumberToken(0));
+            i++;
+            continue;
+        }
+        if (inArgument) {
+            // a hidden macro is never expanded, even after the argument is
+            // put into the body
+            if (define)
+                tokens[i] = ifNumberToken(0);
+            i++;
+            continue;
+        }
+        // other identifiers are 0
+        tokens[i] = ifNumberToken(name == "true"?1:0);
+        i++;
     }
+    return true;
 }
 
 /*
- * unary_expr = term
-     | '+' term
-     | '-' term
-     | '!' term
-     | '~' term
+ * conditional_expr = binary_expr
+ *      | binary_expr '?' expr ':' conditional_expr
  */
-bool CppPreprocessor::evalUnaryExpr(const QString &expr, int &result, int &pos)
+bool CppPreprocessor::evalIfExpr(const IfTokens &tokens, int &pos, IfValue &result, bool evaluated)
 {
-    if (!skipSpaces(expr,pos))
+    if (!evalIfBinaryExpr(tokens,pos,1,result,evaluated))
         return false;
-    if (expr[pos]=='+') {
-        pos++;
-        if (!evalTerm(expr,result,pos))
-            return false;
-    } else if (expr[pos]=='-') {
+    if (pos < tokens.count() && isIfOperator(tokens[pos],"?")) {
         pos++;
-        if (!evalTerm(expr,result,pos))
+        bool condition = (result.value != 0);
+        IfValue trueValue;
+        IfValue falseValue;
+        if (!evalIfExpr(tokens,pos,trueValue,evaluated && condition))
             return false;
-        result = -result;
-    } else if (expr[pos]=='~') {
-        pos++;
-        if (!evalTerm(expr,result,pos))
+        if (pos >= tokens.count() || !isIfOperator(tokens[pos],":"))
             return false;
-        result = ~result;
-    } else if (expr[pos]=='!') {
         pos++;
-        if (!evalTerm(expr,result,pos))
+        if (!evalIfExpr(tokens,pos,falseValue,evaluated && !condition))
             return false;
-        result = !result;
-    } else {
-        return evalTerm(expr,result,pos);
+        result.value = condition?trueValue.value:falseValue.value;
+        result.isUnsigned = trueValue.isUnsigned || falseValue.isUnsigned;
     }
     return true;
 }
 
-/*
- * mul_expr = unary_expr
-     | mul_expr '*' unary_expr
-     | mul_expr '/' unary_expr
-     | mul_expr '%' unary_expr
- */
-bool CppPreprocessor::evalMulExpr(const QString &expr, int &result, int &pos)
+int CppPreprocessor::ifOperatorPrecedence(const IfToken& token)
 {
-    if (!evalUnaryExpr(expr,result,pos))
-        return false;
-    while (true) {
-        if (!skipSpaces(expr,pos))
-            break;
-        int rightResult;
-        if (expr[pos]=='*') {
-            pos++;
-            if (!evalUnaryExpr(expr,rightResult,pos))
-                return false;
-            result *= rightResult;
-        } else if (expr[pos]=='/') {
-            pos++;
-            if (!evalUnaryExpr(expr,rightResult,pos))
-                return false;
-            result /= rightResult;
-        } else if (expr[pos]=='%') {
-            pos++;
-            if (!evalUnaryExpr(expr,rightResult,pos))
+    if (token.type != IfToken::Type::Operator)
+        return -1;
+    static const QHash<QString,int> precedences {
+        {"||",1},
+        {"&&",2},
+        {"|",3},
+        {"^",4},
+        {"&",5},
+        {"==",6}, {"!=",6},
+        {"<",7}, {"<=",7}, {">",7}, {">=",7},
+        {"<<",8}, {">>",8},
+        {"+",9}, {"-",9},
+        {"*",10}, {"/",10}, {"%",10}
+    };
+    return precedences.value(token.text,-1);
+}
+
+bool CppPreprocessor::applyIfOperator(const QString& op, IfValue& left,
+                                      const IfValue& right, bool evaluated)
+{
+    // the usual arithmetic conversions: signed is converted to unsigned
+    bool isUnsigned = left.isUnsigned || right.isUnsigned;
+    quint64 l = (quint64)left.value;
+    quint64 r = (quint64)right.value;
+    qint64 result;
+    if (op == "*") {
+        result = (qint64)(l*r);
+    } else if (op == "/" || op == "%") {
+        if (r == 0) {
+            if (evaluated)
                 return false;
-            result %= rightResult;
+            result = 0;
+        } else if (isUnsigned) {
+            result = (qint64)(op == "/" ? l/r : l%r);
+        } else if (left.value == std::numeric_limits<qint64>::min() && right.value == -1) {
+            result = (op == "/") ? left.value : 0;
         } else {
-            break;
+            result = (op == "/") ? left.value/right.value : left.value%right.value;
         }
+    } else if (op == "+") {
+        result = (qint64)(l+r);
+    } else if (op == "-") {
+        result = (qint64)(l-r);
+    } else if (op == "<<" || op == ">>") {
+        // the result has the type of the left operand
+        isUnsigned = left.isUnsigned;
+        if (right.value < 0 || right.value >= 64)
+            result = 0;
+        else if (op == "<<")
+            result = (qint64)(l << r);
+        else if (left.isUnsigned)
+            result = (qint64)(l >> r);
+        else
+            result = left.value >> r;
+    } else if (op == "<" || op == "<=" || op == ">" || op == ">=") {
+        bool less = isUnsigned ? l < r : left.value < right.value;
+        bool equal = (l == r);
+        if (op == "<")
+            result = less;
+        else if (op == "<=")
+            result = less || equal;
+        else if (op == ">")
+            result = !less && !equal;
+        else
+            result = !less;
+        isUnsigned = false;
+    } else if (op == "==" || op == "!=") {
+        result = (op == "==") ? (l == r) : (l != r);
+        isUnsigned = false;
+    } else if (op == "&") {
+        result = (qint64)(l & r);
+    } else if (op == "^") {
+        result = (qint64)(l ^ r);
+    } else if (op == "|") {
+        result = (qint64)(l | r);
+    } else if (op == "&&") {
+        result = (l != 0) && (r != 0);
+        isUnsigned = false;
+    } else if (op == "||") {
+        result = (l != 0) || (r != 0);
+        isUnsigned = false;
+    } else {
+        return false;
     }
+    left.value = result;
+    left.isUnsigned = isUnsigned;
     return true;
 }
 
 /*
- * add_expr = mul_expr
-     | add_expr '+' mul_expr
-     | add_expr '-' mul_expr
+ * binary_expr = unary_expr
+ *      | binary_expr op binary_expr
+ * operators with higher precedence are evaluated first (precedence climbing)
  */
-bool CppPreprocessor::evalAddExpr(const QString &expr, int &result, int &pos)
+bool CppPreprocessor::evalIfBinaryExpr(const IfTokens &tokens, int &pos, int minPrecedence, IfValue &result, bool evaluated)
 {
-    if (!evalMulExpr(expr,result,pos))
+    if (!evalIfUnaryExpr(tokens,pos,result,evaluated))
         return false;
-    while (true) {
-        if (!skipSpaces(expr,pos))
+    while (pos < tokens.count()) {
+        int precedence = ifOperatorPrecedence(tokens[pos]);
+        if (precedence < minPrecedence)
             break;
-        int rightResult;
-        if (expr[pos]=='+') {
-            pos++;
-            if (!evalMulExpr(expr,rightResult,pos))
-                return false;
-            result += rightResult;
-        } else if (expr[pos]=='-') {
-            pos++;
-            if (!evalMulExpr(expr,rightResult,pos))
-                return false;
-            result -= rightResult;
-        } else {
-            break;
-        }
+        QString op = tokens[pos].text;
+        pos++;
+        // short-circuit: no errors (division by zero) on the side not evaluated
+        bool rightEvaluated = evaluated;
+        if (op == "&&")
+            rightEvaluated = evaluated && result.value != 0;
+        else if (op == "||")
+            rightEvaluated = evaluated && result.value == 0;
+        IfValue right;
+        if (!evalIfBinaryExpr(tokens,pos,precedence+1,right,rightEvaluated))
+            return false;
+        if (!applyIfOperator(op,result,right,evaluated))
+            return false;
     }
     return true;
 }
 
 /*
- * shift_expr = add_expr
-     | shift_expr "<<" add_expr
-     | shift_expr ">>" add_expr
+ * unary_expr = number
+ *      | '(' expr ')'
+ *      | ('+' | '-' | '!' | '~') unary_expr
  */
-bool CppPreprocessor::evalShiftExpr(const QString &expr, int &result, int &pos)
+bool CppPreprocessor::evalIfUnaryExpr(const IfTokens &tokens, int &pos, IfValue &result, bool evaluated)
 {
-    if (!evalAddExpr(expr,result,pos))
+    if (pos >= tokens.count())
         return false;
-    while (true) {
-        if (!skipSpaces(expr,pos))
-            break;
-        int rightResult;
-        if (pos+1<expr.length() && expr[pos] == '<' && expr[pos+1]=='<') {
-            pos += 2;
-            if (!evalAddExpr(expr,rightResult,pos))
-                return false;
-            result = (result << rightResult);
-        } else if (pos+1<expr.length() && expr[pos] == '>' && expr[pos+1]=='>') {
-            pos += 2;
-            if (!evalAddExpr(expr,rightResult,pos))
-                return false;
-            result = (result >> rightResult);
-        } else {
-            break;
-        }
+    const IfToken& token = tokens[pos];
+    if (token.type == IfToken::Type::Number) {
+        result.value = token.value;
+        result.isUnsigned = token.isUnsigned;
+        pos++;
+        return true;
+    }
+    if (token.type != IfToken::Type::Operator)
+        return false;
+    if (token.text == "(") {
+        pos++;
+        if (!evalIfExpr(tokens,pos,result,evaluated))
+            return false;
+        if (pos >= tokens.count() || !isIfOperator(tokens[pos],")"))
+            return false;
+        pos++;
+        return true;
+    }
+    QString op = token.text;
+    if (op != "+" && op != "-" && op != "!" && op != "~")
+        return false;
+    pos++;
+    if (!evalIfUnaryExpr(tokens,pos,result,evaluated))
+        return false;
+    if (op == "-") {
+        result.value = (qint64)(0-(quint64)result.value);
+    } else if (op == "!") {
+        result.value = (result.value == 0);
+        result.isUnsigned = false;
+    } else if (op == "~") {
+        result.value = ~result.value;
     }
     return true;
 }
 
-/*
- * relation_expr = shift_expr
-     | relation_expr ">=" shift_expr
-     | relation_expr ">" shift_expr
-     | relation_expr "<=" shift_expr
-     | relation_expr "<" shift_expr
- */
-bool CppPreprocessor::evalRelationExpr(const QString &expr, int &result, int &pos)
+QString CppPreprocessor::expandFunction(PDefine define, QString args)
 {
-    if (!evalShiftExpr(expr,result,pos))
-        return false;
-    while (true) {
-        if (!skipSpaces(expr,pos))
-            break;
-        int rightResult;
-        if (expr[pos]=='<') {
-            if (pos+1<expr.length() && expr[pos+1]=='=') {
-                pos+=2;
-                if (!evalShiftExpr(expr,rightResult,pos))
-                    return false;
-                result = (result <= rightResult);
-            } else {
-                pos++;
-                if (!evalShiftExpr(expr,rightResult,pos))
-                    return false;
-                result = (result < rightResult);
-            }
-        } else if (expr[pos]=='>') {
-            if (pos+1<expr.length() && expr[pos+1]=='=') {
-                pos+=2;
-                if (!evalShiftExpr(expr,rightResult,pos))
-                    return false;
-                result = (result >= rightResult);
-            } else {
-                pos++;
-                if (!evalShiftExpr(expr,rightResult,pos))
-                    return false;
-                result = (result > rightResult);
-            }
-        } else {
-            break;
-        }
+    // Replace function by this string
+    if (args.startsWith('(') && args.endsWith(')')) {
+        args = args.mid(1,args.length()-2);
     }
-    return true;
+
+    return expandFunction(define,args.split(","));
 }
 
-/*
- * equal_expr = relation_expr
-     | equal_expr "==" relation_expr
-     | equal_expr "!=" relation_expr
- */
-bool CppPreprocessor::evalEqualExpr(const QString &expr, int &result, int &pos)
+QString CppPreprocessor::expandFunction(const PDefine &define, const QStringList &argValues)
 {
-    if (!evalRelationExpr(expr,result,pos))
-        return false;
-    while (true) {
-        if (!skipSpaces(expr,pos))
-            break;
-        if (pos+1<expr.length() && expr[pos]=='!' && expr[pos+1]=='=') {
-            pos+=2;
-            int rightResult;
-            if (!evalRelationExpr(expr,rightResult,pos))
-                return false;
-            result = (result != rightResult);
-        } else if (pos+1<expr.length() && expr[pos]=='=' && expr[pos+1]=='=') {
-            pos+=2;
-            int rightResult;
-            if (!evalRelationExpr(expr,rightResult,pos))
-                return false;
-            result = (result == rightResult);
-        } else {
-            break;
+    if (argValues.length() == define->argList.length()
+            && argValues.length()>0
+            && define->formatParts.length() == define->formatArgs.length()+1) {
+        QString result = define->formatParts[0];
+        for (int i=0;i<define->formatArgs.length();i++) {
+            result += argValues[define->formatArgs[i]].trimmed();
+            result += define->formatParts[i+1];
         }
+        return result;
     }
-    return true;
+    QString result = define->formatValue;
+    result.replace("%%","%");
+
+    return result;
 }
 
-/*
- * bit_and_expr = equal_expr
-     | bit_and_expr "&" equal_expr
- */
-bool CppPreprocessor::evalBitAndExpr(const QString &expr, int &result, int &pos)
+PDefineMap CppPreprocessor::fileDefines(const QString &fileName) const
 {
-    if (!evalEqualExpr(expr,result,pos))
-        return false;
-    while (true) {
-        if (!skipSpaces(expr,pos))
-            break;
-        if (expr[pos]=='&'
-                && (pos == expr.length()
-                || expr[pos+1]!='&')) {
-            pos++;
-            int rightResult;
-            if (!evalEqualExpr(expr,rightResult,pos))
-                return false;
-            result = result & rightResult;
-        } else {
-            break;
-        }
-    }
-    return true;
+    return mFileDefines.value(fileName,PDefineMap());
 }
 
-/*
- * bit_xor_expr = bit_and_expr
-     | bit_xor_expr "^" bit_and_expr
- */
-bool CppPreprocessor::evalBitXorExpr(const QString &expr, int &result, int &pos)
+void CppPreprocessor::addSharedFile(const QString &fileName, const PFileIncludes &fileIncludes, const PDefineMap &defines)
 {
-    if (!evalBitAndExpr(expr,result,pos))
-        return false;
-    while (true) {
-        if (!skipSpaces(expr,pos))
-            break;
-        if (expr[pos]=='^') {
-            pos++;
-            int rightResult;
-            if (!evalBitAndExpr(expr,rightResult,pos))
-                return false;
-            result = result ^ rightResult;
-        } else {
-            break;
-        }
+    if (!fileIncludes)
+        return;
+    mScannedFiles.insert(fileName);
+    mIncludesList.insert(fileName,fileIncludes);
+    if (defines)
+        mFileDefines.insert(fileName,defines);
+}
+
+std::shared_ptr<CppPreprocessor> CppPreprocessor::createWorker() const
+{
+    std::shared_ptr<CppPreprocessor> worker = std::make_shared<CppPreprocessor>();
+    worker->mHardDefines = mHardDefines;
+    worker->mHardDefineFilter = mHardDefineFilter;
+    worker->mIncludePaths = mIncludePaths;
+    worker->mProjectIncludePaths = mProjectIncludePaths;
+    worker->mIncludePathList = mIncludePathList;
+    worker->mProjectIncludePathList = mProjectIncludePathList;
+    worker->mParseSystem = mParseSystem;
+    worker->mParseLocal = mParseLocal;
+    worker->mIncludeGuards = mIncludeGuards;
+    worker->mIncludeFileCache = mIncludeFileCache;
+    worker->mIfCache = mIfCache;
+    // the containers are implicitly shared, only the worker's changes are copied
+    worker->mScannedFiles = mScannedFiles;
+    worker->mBaseScannedFiles = mScannedFiles;
+    worker->mFileDefines = mFileDefines;
+    // records of unscanned files would be changed by the worker
+    for (auto it=mIncludesList.cbegin();it!=mIncludesList.cend();++it) {
+        if (mScannedFiles.contains(it.key()))
+            worker->mIncludesList.insert(it.key(),it.value());
     }
-    return true;
+    return worker;
 }
 
-/*
- * bit_or_expr = bit_xor_expr
-     | bit_or_expr "|" bit_xor_expr
- */
-bool CppPreprocessor::evalBitOrExpr(const QString &expr, int &result, int &pos)
+bool CppPreprocessor::merge(const QString &fileName, const CppPreprocessor &worker, QStringList &result)
 {
-    if (!evalBitXorExpr(expr,result,pos))
+    // the file would be skipped if it's preprocessed here
+    if (mScannedFiles.contains(fileName))
         return false;
-    while (true) {
-        if (!skipSpaces(expr,pos))
-            break;
-        if (expr[pos] == '|'
-                && (pos == expr.length()
-                || expr[pos+1]!='|')) {
-            pos++;
-            int rightResult;
-            if (!evalBitXorExpr(expr,rightResult,pos))
-                return false;
-            result = result | rightResult;
-        } else {
-            break;
+    QSet<QString> skippedFiles;
+    foreach (const QString& file, worker.mScannedFiles) {
+        if (!worker.mBaseScannedFiles.contains(file) && mScannedFiles.contains(file))
+            skippedFiles.insert(file);
+    }
+
+    // Remove the text of the skipped files, but keep their #include lines,
+    // so the result looks like the files have been scanned before.
+    // A file's text is only in the result where it's included for the first time,
+    // so files first included by the skipped files are lost, too.
+    QSet<QString> lostFiles;
+    if (!skippedFiles.isEmpty()) {
+        QStringList text;
+        text.reserve(result.count());
+        QSet<QString> includedFiles;
+        QList<bool> skipping; // stack of files we've stepped into, if their text is removed
+        foreach (const QString& line, result) {
+            if (line.startsWith("#include ")) {
+                // format: #include fullfilename:line
+                int delimPos = line.lastIndexOf(':');
+                QString file = line.mid(QString("#include ").length(),
+                                        delimPos - QString("#include ").length());
+                bool parentSkipped = !skipping.isEmpty() && skipping.back();
+                if (line.midRef(delimPos+1).toInt() == 1) { // enter a file
+                    if (parentSkipped && !includedFiles.contains(file))
+                        lostFiles.insert(file);
+                    includedFiles.insert(file);
+                    skipping.append(parentSkipped || skippedFiles.contains(file));
+                } else { // back to the parent
+                    if (!skipping.isEmpty())
+                        skipping.pop_back();
+                    parentSkipped = !skipping.isEmpty() && skipping.back();
+                }
+                if (!parentSkipped)
+                    text.append(line);
+            } else if (skipping.isEmpty() || !skipping.back()) {
+                text.append(line);
+            }
         }
+        result = text;
     }
+
+    foreach (const QString& file, worker.mScannedFiles) {
+        if (worker.mBaseScannedFiles.contains(file) || skippedFiles.contains(file)
+                || lostFiles.contains(file))
+            continue;
+        mScannedFiles.insert(file);
+        PFileIncludes fileIncludes = worker.mIncludesList.value(file);
+        if (fileIncludes)
+            mIncludesList.insert(file,fileIncludes);
+        PDefineMap defines = worker.mFileDefines.value(file);
+        if (defines)
+            mFileDefines.insert(file,defines);
+        QString guard = worker.mIncludeGuards.value(file);
+        if (!guard.isEmpty())
+            mIncludeGuards.insert(file,guard);
+    }
+    for (auto it=worker.mIncludeFileCache.cbegin();it!=worker.mIncludeFileCache.cend();++it) {
+        mIncludeFileCache.insert(it.key(),it.value());
+    }
+
+    mStatistics.filesRead += worker.mStatistics.filesRead;
+    mStatistics.filesShared += worker.mStatistics.filesShared;
+    mStatistics.linesRead += worker.mStatistics.linesRead;
+    mStatistics.includes += worker.mStatistics.includes;
+    mStatistics.includeLookupsCached += worker.mStatistics.includeLookupsCached;
+    mStatistics.includesAlreadyIncluded += worker.mStatistics.includesAlreadyIncluded;
+    mStatistics.includesSkippedByGuard += worker.mStatistics.includesSkippedByGuard;
+    mStatistics.ifEvaluations += worker.mStatistics.ifEvaluations;
+    mStatistics.ifCacheHits += worker.mStatistics.ifCacheHits;
     return true;
 }
 
-/*
- * logic_and_expr = bit_or_expr
-    | logic_and_expr "&&" bit_or_expr
- */
-bool CppPreprocessor::evalLogicAndExpr(const QString &expr, int &result, int &pos)
+void CppPreprocessor::setOnOpenUnscannedHeader(const UnscannedHeaderCallBack &newOnOpenUnscannedHeader)
 {
-    if (!evalBitOrExpr(expr,result,pos))
-        return false;
-    while (true) {
-        if (!skipSpaces(expr,pos))
-            break;
-        if (pos+1<expr.length() && expr[pos]=='&' && expr[pos+1] =='&') {
-            pos+=2;
-            int rightResult;
-            if (!evalBitOrExpr(expr,rightResult,pos))
-                return false;
-            result = result && rightResult;
-        } else {
-            break;
-        }
-    }
-    return true;
+    mOnOpenUnscannedHeader = newOnOpenUnscannedHeader;
 }
 
-/*
- * logic_or_expr = logic_and_expr
-    | logic_or_expr "||" logic_and_expr
- */
-bool CppPreprocessor::evalLogicOrExpr(const QString &expr, int &result, int &pos)
+QByteArray CppPreprocessor::calcContentHash(const QString &fileName, const QStringList &buffer)
 {
-    if (!evalLogicAndExpr(expr,result,pos))
-        return false;
-    while (true) {
-        if (!skipSpaces(expr,pos))
-            break;
-        if (pos+1<expr.length() && expr[pos]=='|' && expr[pos+1] =='|') {
-            pos+=2;
-            int rightResult;
-            if (!evalLogicAndExpr(expr,rightResult,pos))
-                return false;
-            result = result || rightResult;
-        } else {
-            break;
-        }
-    }
-    return true;
+    if (!buffer.isEmpty())
+        return hashLines(removeComments(buffer));
+    return hashLines(readHeaderText(fileName));
 }
 
-bool CppPreprocessor::evalExpr(const QString &expr, int &result, int &pos)
-{
-    return evalLogicOrExpr(expr,result,pos);
-}
-
-/* BNF for C constant expression evaluation
- * term = number
-     | '(' expression ')'
-unary_expr = term
-     | '+' term
-     | '-' term
-     | '!' term
-     | '~' term
-mul_expr = term
-     | mul_expr '*' term
-     | mul_expr '/' term
-     | mul_expr '%' term
-add_expr = mul_expr
-     | add_expr '+' mul_expr
-     | add_expr '-' mul_expr
-shift_expr = add_expr
-     | shift_expr "<<" add_expr
-     | shift_expr ">>" add_expr
-relation_expr = shift_expr
-     | relation_expr ">=" shift_expr
-     | relation_expr ">" shift_expr
-     | relation_expr "<=" shift_expr
-     | relation_expr "<" shift_expr
-equal_expr = relation_expr
-     | equal_expr "==" relation_expr
-     | equal_expr "!=" relation_expr
-bit_and_expr = equal_expr
-     | bit_and_expr "&" equal_expr
-bit_xor_expr = bit_and_expr
-     | bit_xor_expr "^" bit_and_expr
-bit_or_expr = bit_xor_expr
-     | bit_or_expr "|" bit_xor_expr
-logic_and_expr = bit_or_expr
-    | logic_and_expr "&&" bit_or_expr
-logic_or_expr = logic_and_expr
-    | logic_or_expr "||" logic_and_expr
-    */
-
-int CppPreprocessor::evaluateExpression(QString line)
+QByteArray CppPreprocessor::calcIncludesHash(const PFileIncludes &fileIncludes) const
 {
-    int pos = 0;
-    int result;
-    bool ok = evalExpr(line,result,pos);
-    if (!ok)
-        return -1;
-    //expr not finished
-    if (skipSpaces(line,pos))
-        return -1;
-    return result;
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    for (auto it=fileIncludes->includeFiles.cbegin();it!=fileIncludes->includeFiles.cend();++it) {
+        hash.addData(it.key().toUtf8());
+        PFileIncludes included = mIncludesList.value(it.key());
+        if (included)
+            hash.addData(included->contentHash);
+        hash.addData("\n",1);
+    }
+    return hash.result();
 }
 
 const QList<QString> &CppPreprocessor::projectIncludePathList() const
@@ -1788,6 +2251,25 @@ const QList<QString> &CppPreprocessor::projectIncludePathList() const
     return mProjectIncludePathList;
 }
 
+const PreprocessStatistics &CppPreprocessor::statistics() const
+{
+    return mStatistics;
+}
+
+void CppPreprocessor::resetStatistics()
+{
+    mStatistics.filesRead = 0;
+    mStatistics.filesShared = 0;
+    mStatistics.linesRead = 0;
+    mStatistics.includes = 0;
+    mStatistics.includeLookupsCached = 0;
+    mStatistics.includesAlreadyIncluded = 0;
+    mStatistics.includesSkippedByGuard = 0;
+    mStatistics.ifEvaluations = 0;
+    mStatistics.ifCacheHits = 0;
+    mIncludeFileCache.clear();
+}
+
 const QList<QString> &CppPreprocessor::includePathList() const
 {
     return mIncludePathList;
@@ -17,11 +17,13 @@
 #ifndef CPPPREPROCESSOR_H
 #define CPPPREPROCESSOR_H
 
+#include <QBitArray>
 #include <QObject>
 #include <QTextStream>
 #include "parserutils.h"
 
 #define MAX_DEFINE_EXPAND_DEPTH 20
+#define DEFINE_FILTER_BITS 32768
 enum class DefineArgTokenType{
     Symbol,
     Identifier,
@@ -45,8 +47,21 @@ struct ParsedFile {
 };
 using PParsedFile = std::shared_ptr<ParsedFile>;
 
+struct PreprocessStatistics {
+    int filesRead; // files whose text is loaded and preprocessed
+    int filesShared; // files whose text is reused from an earlier read
+    int linesRead;
+    int includes; // #include lines in taken branches
+    int includeLookupsCached; // include file names resolved without searching the include dirs
+    int includesAlreadyIncluded; // skipped because already included in the same file
+    int includesSkippedByGuard; // skipped because the header's include guard is already defined
+    int ifEvaluations; // #if/#elif expressions evaluated
+    int ifCacheHits; // #if/#elif results reused from an earlier evaluation
+};
+
 class CppPreprocessor
 {
+    using UnscannedHeaderCallBack = std::function<void (const QString&)>;
     enum class ContentType {
         AnsiCComment,
         CppComment,
@@ -68,6 +83,12 @@ public:
     void reset(); //reset but don't clear generated defines
     void setScanOptions(bool parseSystem, bool parseLocal);
     void preprocess(const QString& fileName, QStringList buffer = QStringList());
+    /**
+     * @brief expand macros in some lines of an already scanned file, using the defines
+     * visible in that file
+     * @return the expanded lines, or an empty list if they contain preprocessor directives
+     */
+    QStringList preprocessLines(const QString& fileName, const QStringList& lines);
 
     void dumpDefinesTo(const QString& fileName) const;
     void dumpIncludesListTo(const QString& fileName) const;
@@ -90,6 +111,45 @@ public:
     const QList<QString> &includePathList() const;
 
     const QList<QString> &projectIncludePathList() const;
+
+    const PreprocessStatistics &statistics() const;
+    /**
+     * @brief clear the statistics and the include file name cache, called before each parse
+     */
+    void resetStatistics();
+
+    PDefineMap fileDefines(const QString& fileName) const;
+    /**
+     * @brief use a file parsed by someone else as if it has been scanned
+     */
+    void addSharedFile(const QString& fileName, const PFileIncludes& fileIncludes,
+                       const PDefineMap& defines);
+    /**
+     * @brief a preprocessor that starts with the files scanned by this one, so a file can
+     * be preprocessed in another thread. It doesn't change the records of these files.
+     */
+    std::shared_ptr<CppPreprocessor> createWorker() const;
+    /**
+     * @brief add the files scanned by a worker, as if they're scanned by this preprocessor
+     * @param result the worker's result. The text of files that are scanned by this
+     * preprocessor after the worker is created is removed from it
+     * @return false if the file itself is scanned meanwhile, and nothing is added
+     */
+    bool merge(const QString& fileName, const CppPreprocessor& worker, QStringList& result);
+    /**
+     * @brief called before an unscanned header is opened, so its content can be
+     * provided by addSharedFile()
+     */
+    void setOnOpenUnscannedHeader(const UnscannedHeaderCallBack &newOnOpenUnscannedHeader);
+    /**
+     * @brief hash of the file's text without comments, the same as FileIncludes::contentHash
+     * @param buffer text of the file, it's read from disk if empty
+     */
+    QByteArray calcContentHash(const QString& fileName, const QStringList& buffer);
+    /**
+     * @brief hash of the contentHash of all files included by the file
+     */
+    QByteArray calcIncludesHash(const PFileIncludes& fileIncludes) const;
 private:
     void preprocessBuffer();
     void skipToEndOfPreprocessor();
@@ -99,9 +159,14 @@ private:
     void handleBranch(const QString& line);
     void handleDefine(const QString& line);
     void handleInclude(const QString& line, bool fromNext=false);
+    QString findIncludeFile(const QString& currentFile, const QString& currentDir,
+                            const QString& line, bool fromNext);
     void handlePreprocessor(const QString& value);
     void handleUndefine(const QString& line);
     QString expandMacros(const QString& line, int depth);
+    bool mayContainMacro(const QString& line);
+    static uint defineNameHash(const QChar* name, int length);
+    static void addToDefineFilter(QBitArray& filter, const QString& name);
     void expandMacro(const QString& line, QString& newLine, QString& word, int& i, int depth);
     QString removeGCCAttributes(const QString& line);
     void removeGCCAttribute(const QString&line, QString& newLine, int &i, const QString& word);
@@ -110,6 +175,9 @@ private:
     PParsedFile getInclude(int index);
     void openInclude(const QString& fileName, QStringList bufferedText=QStringList());
     void closeInclude();
+    QStringList readHeaderText(const QString& fileName);
+    void setIncludeGuard(const QString& fileName, const QString& guard);
+    QString findIncludeGuard(const QStringList& buffer) const;
 
     // branch stuff
     bool getCurrentBranch();
@@ -160,34 +228,52 @@ private:
      */
     bool isDigit(const QChar& ch);
 
-    /*
-     * '0'..'9','x',X','a'..'f','A'..'F','u','U','l','L'
-     */
-    bool isNumberChar(const QChar& ch);
-
     QString lineBreak();
 
+    /*
+     * #if/#elif expressions are tokenized once, macros are expanded on the tokens,
+     * and then evaluated with intmax_t/uintmax_t like gcc does.
+     */
+    struct IfToken {
+        enum class Type {
+            Number,
+            Identifier,
+            Operator,
+            HeaderName // <xxx> or "xxx" in __has_include()
+        };
+        Type type;
+        QString text;
+        qint64 value;
+        bool isUnsigned;
+        QSet<QString> hideSet; // macros whose expansion produced this token
+    };
+    using IfTokens = QVector<IfToken>;
+    struct IfValue {
+        qint64 value;
+        bool isUnsigned;
+    };
+    // result of an expression, valid while the macros it used are unchanged
+    struct IfCacheEntry {
+        bool result;
+        QVector<QPair<QString,PDefine>> macros;
+    };
     bool evaluateIf(const QString& line);
-    QString expandDefines(QString line);
-    bool skipBraces(const QString&line, int& index, int step = 1);
+    bool isIfCacheEntryValid(const IfCacheEntry& entry);
+    bool tokenizeIfExpression(const QString& expr, IfTokens& tokens);
+    bool expandIfTokens(IfTokens& tokens, IfCacheEntry& entry, bool& cacheable);
+    bool expandIfTokens(IfTokens& tokens, IfCacheEntry& entry, QSet<QString>& usedMacros,
+                        int& expansions, bool& cacheable, bool inArgument);
+    PDefine findIfMacro(const QString& name, IfCacheEntry& entry, QSet<QString>& usedMacros);
+    bool evalIfExpr(const IfTokens& tokens, int& pos, IfValue& result, bool evaluated);
+    bool evalIfBinaryExpr(const IfTokens& tokens, int& pos, int minPrecedence,
+                          IfValue& result, bool evaluated);
+    bool evalIfUnaryExpr(const IfTokens& tokens, int& pos, IfValue& result, bool evaluated);
+    static bool isIfOperator(const IfToken& token, const QString& op);
+    static IfToken ifNumberToken(qint64 value);
+    static int ifOperatorPrecedence(const IfToken& token);
+    static bool applyIfOperator(const QString& op, IfValue& left, const IfValue& right, bool evaluated);
     QString expandFunction(PDefine define,QString args);
-    bool skipSpaces(const QString &expr, int& pos);
-    bool evalNumber(const QString &expr, int& result, int& pos);
-    bool evalTerm(const QString &expr, int& result, int& pos);
-    bool evalUnaryExpr(const QString &expr, int& result, int& pos);
-    bool evalMulExpr(const QString &expr, int& result, int& pos);
-    bool evalAddExpr(const QString &expr, int& result, int& pos);
-    bool evalShiftExpr(const QString &expr, int& result, int& pos);
-    bool evalRelationExpr(const QString &expr, int& result, int& pos);
-    bool evalEqualExpr(const QString &expr, int& result, int& pos);
-    bool evalBitAndExpr(const QString &expr, int& result, int& pos);
-    bool evalBitXorExpr(const QString &expr, int& result, int& pos);
-    bool evalBitOrExpr(const QString &expr, int& result, int& pos);
-    bool evalLogicAndExpr(const QString &expr, int& result, int& pos);
-    bool evalLogicOrExpr(const QString &expr, int& result, int& pos);
-    bool evalExpr(const QString &expr, int& result, int& pos);
-
-    int evaluateExpression(QString line);
+    QString expandFunction(const PDefine& define,const QStringList& argValues);
 private:
     int mIndex; // points to current file buffer. do not free
     QString mFileName; // idem
@@ -198,10 +284,14 @@ private:
     QList<PParsedFile> mIncludes; // stack of files we've stepped into. last one is current file, first one is source file
     QList<bool> mBranchResults;// stack of branch results (boolean). last one is current branch, first one is outermost branch
     DefineMap mDefines; // working set, editable
+    // bloom filter of the names in mDefines, to skip lines without macros quickly.
+    // undefined names are not removed from it
+    QBitArray mDefineFilter;
     QSet<QString> mProcessed; // dictionary to save filename already processed
 
     //used by parser even preprocess finished
     DefineMap mHardDefines; // set by "cpp -dM -E -xc NUL"
+    QBitArray mHardDefineFilter;
     QHash<QString,PFileIncludes> mIncludesList;
     QHash<QString, PDefineMap> mFileDefines; //dictionary to save defines for each headerfile;
     //{ List of current project's include path }
@@ -214,7 +304,16 @@ private:
 
     bool mParseSystem;
     bool mParseLocal;
+    // include guard macro of each scanned header, "#pragma once" if it uses that
+    QHash<QString,QString> mIncludeGuards;
+    // (from next, current dir, include line) -> header file name, cleared before each parse
+    QHash<QString,QString> mIncludeFileCache;
+    PreprocessStatistics mStatistics;
+    // #if/#elif expression -> its last result, shared by all files preprocessed
+    QHash<QString,IfCacheEntry> mIfCache;
     QSet<QString> mScannedFiles;
+    QSet<QString> mBaseScannedFiles; // files scanned when the worker is created
+    UnscannedHeaderCallBack mOnOpenUnscannedHeader;
 };
 
 #endif // CPPPREPROCESSOR_H
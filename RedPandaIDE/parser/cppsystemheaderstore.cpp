@@ -0,0 +1,508 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "cppsystemheaderstore.h"
+#include "cppparser.h"
+#include "../utils.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QQueue>
+
+#define PARSER_CACHE_MAGIC 0x52504843 // "RPHC"
+#define PARSER_CACHE_VERSION 3
+
+static QMutex storesMutex;
+static QHash<QString, std::weak_ptr<CppSystemHeaderStore>> stores;
+
+CppSystemHeaderStore::CppSystemHeaderStore(const QString &key,
+                                           const QStringList &includePaths,
+                                           const QStringList &defineLines,
+                                           const QString& cacheDir):
+    mKey(key),
+    mParser(new CppParser()),
+    mCacheDir(cacheDir),
+    mCacheLoaded(false),
+    mCacheDirty(false)
+{
+    mParser->setEnabled(true);
+    mParser->setParseGlobalHeaders(true);
+    mParser->setParseLocalHeaders(true);
+    foreach (const QString& path, includePaths) {
+        mParser->addIncludePath(path);
+    }
+    foreach (const QString& line, defineLines) {
+        mParser->addHardDefineByLine(line);
+    }
+    mIncludePaths = mParser->includePaths();
+}
+
+CppSystemHeaderStore::~CppSystemHeaderStore()
+{
+    saveCache();
+    QMutexLocker locker(&storesMutex);
+    std::weak_ptr<CppSystemHeaderStore> store = stores.value(mKey);
+    if (store.expired())
+        stores.remove(mKey);
+}
+
+std::shared_ptr<CppSystemHeaderStore> CppSystemHeaderStore::acquire(const QStringList &includePaths, const QStringList &defineLines, const QString& cacheDir)
+{
+    QString key = includePaths.join('\n') + "\n--\n" + defineLines.join('\n');
+    QMutexLocker locker(&storesMutex);
+    PCppSystemHeaderStore store = stores.value(key).lock();
+    if (!store) {
+        store = PCppSystemHeaderStore(new CppSystemHeaderStore(key, includePaths, defineLines, cacheDir));
+        stores.insert(key,store);
+    }
+    return store;
+}
+
+bool CppSystemHeaderStore::ensureParsed(const QString &fileName)
+{
+    QMutexLocker locker(&mMutex);
+    if (!mCacheLoaded) {
+        mCacheLoaded = true;
+        loadCache();
+    }
+    if (mPublished.contains(fileName))
+        return true;
+    if (!isHfile(fileName) || !isSystemHeaderFile(fileName))
+        return false;
+    mParser->parseFile(fileName, false, true, false);
+    publishNewFiles();
+    return mPublished.contains(fileName);
+}
+
+bool CppSystemHeaderStore::isSystemHeaderFile(const QString &fileName) const
+{
+    return ::isSystemHeaderFile(fileName, mIncludePaths);
+}
+
+bool CppSystemHeaderStore::isPublished(const QString &fileName)
+{
+    QMutexLocker locker(&mMutex);
+    return mPublished.contains(fileName);
+}
+
+QStringList CppSystemHeaderStore::publishedFilesSince(int &index)
+{
+    QMutexLocker locker(&mMutex);
+    QStringList result;
+    if (index < 0)
+        index = 0;
+    for (int i=index;i<mPublishedFiles.count();i++) {
+        result.append(mPublishedFiles[i]);
+    }
+    index = mPublishedFiles.count();
+    return result;
+}
+
+PFileIncludes CppSystemHeaderStore::fileIncludes(const QString &fileName)
+{
+    QMutexLocker locker(&mMutex);
+    if (!mPublished.contains(fileName))
+        return PFileIncludes();
+    PFileIncludes fileIncludes = mParser->mPreprocessor.includesList().value(fileName);
+    if (!fileIncludes)
+        return PFileIncludes();
+    // the containers are implicitly shared, so the copy is cheap
+    return std::make_shared<FileIncludes>(*fileIncludes);
+}
+
+PDefineMap CppSystemHeaderStore::fileDefines(const QString &fileName)
+{
+    QMutexLocker locker(&mMutex);
+    if (!mPublished.contains(fileName))
+        return PDefineMap();
+    PDefineMap defines = mParser->mPreprocessor.fileDefines(fileName);
+    if (!defines)
+        return PDefineMap();
+    return std::make_shared<DefineMap>(*defines);
+}
+
+const QString &CppSystemHeaderStore::key() const
+{
+    return mKey;
+}
+
+void CppSystemHeaderStore::publishNewFiles()
+{
+    foreach (const QString& file, mParser->scannedFiles()) {
+        if (!mPublished.contains(file)) {
+            mPublished.insert(file);
+            mPublishedFiles.append(file);
+            // published files are read by other parsers, our parser mustn't change them either
+            mParser->mSharedFiles.insert(file);
+            mCacheDirty = true;
+        }
+    }
+}
+
+
+QString CppSystemHeaderStore::cacheFileName() const
+{
+    QByteArray hash = QCryptographicHash::hash(mKey.toUtf8(),QCryptographicHash::Sha1).toHex();
+    return includeTrailingPathDelimiter(mCacheDir) + QString::fromLatin1(hash) + ".cache";
+}
+
+static void writeStatementMap(QDataStream& out, const StatementMap& map,
+                              const QHash<Statement*,qint32>& ids)
+{
+    QVector<QPair<QString,qint32>> items;
+    for (auto it=map.cbegin();it!=map.cend();++it) {
+        qint32 id = ids.value(it.value().get(),-1);
+        if (id>=0)
+            items.append(QPair<QString,qint32>(it.key(),id));
+    }
+    out<<items;
+}
+
+static void readStatementMap(const QVector<QPair<QString,qint32>>& items, StatementMap& map,
+                             const QVector<PStatement>& statements)
+{
+    // QMultiMap puts the last inserted one first, so insert in reversed order
+    for (int i=items.count()-1;i>=0;i--) {
+        qint32 id = items[i].second;
+        if (id>=0 && id<statements.count() && statements[id])
+            map.insert(items[i].first,statements[id]);
+    }
+}
+
+void CppSystemHeaderStore::saveCache()
+{
+    if (mCacheDir.isEmpty() || !mCacheDirty)
+        return;
+    QDir dir(mCacheDir);
+    if (!dir.exists() && !dir.mkpath(mCacheDir))
+        return;
+    QFile file(cacheFileName());
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+        return;
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_9);
+    out<<(quint32)PARSER_CACHE_MAGIC<<(qint32)PARSER_CACHE_VERSION<<mKey;
+
+    //number the statements, parents before children
+    QHash<Statement*,qint32> ids;
+    QVector<PStatement> statements;
+    QQueue<PStatement> queue;
+    const StatementMap& globalStatements = mParser->mStatementList.childrenStatements();
+    foreach (const PStatement& statement, globalStatements) {
+        queue.enqueue(statement);
+    }
+    while (!queue.isEmpty()) {
+        PStatement statement = queue.dequeue();
+        if (ids.contains(statement.get()))
+            continue;
+        ids.insert(statement.get(),statements.count());
+        statements.append(statement);
+        // inherited members are added again when they're used
+        foreach (const PStatement& child, statement->children) {
+            if (!child->isInherited)
+                queue.enqueue(child);
+        }
+    }
+
+    // files
+    out<<(qint32)mPublishedFiles.count();
+    foreach (const QString& fileName, mPublishedFiles) {
+        QFileInfo info(fileName);
+        PFileIncludes fileIncludes = mParser->mPreprocessor.includesList().value(fileName);
+        if (!fileIncludes)
+            fileIncludes = std::make_shared<FileIncludes>();
+        out<<fileName<<info.lastModified().toMSecsSinceEpoch()<<info.size();
+        out<<fileIncludes->baseFile<<fileIncludes->includeFiles<<fileIncludes->usings
+          <<fileIncludes->dependingFiles<<fileIncludes->dependedFiles;
+        writeStatementMap(out,fileIncludes->statements,ids);
+        writeStatementMap(out,fileIncludes->declaredStatements,ids);
+        QVector<QPair<qint32,qint32>> scopes;
+        foreach (const PCppScope& scope, fileIncludes->scopes.scopes()) {
+            qint32 id = scope->statement?ids.value(scope->statement.get(),-1):-1;
+            scopes.append(QPair<qint32,qint32>(scope->startLine,id));
+        }
+        out<<scopes;
+        PDefineMap defines = mParser->mPreprocessor.fileDefines(fileName);
+        out<<(qint32)(defines?defines->count():0);
+        if (defines) {
+            foreach (const PDefine& define, *defines) {
+                out<<define->name<<define->args<<define->value<<define->filename
+                  <<define->hardCoded<<define->argList<<define->argUsed<<define->formatValue
+                  <<define->formatParts<<define->formatArgs;
+            }
+        }
+    }
+
+    // statements
+    out<<(qint32)statements.count();
+    foreach (const PStatement& statement, statements) {
+        PStatement parent = statement->parentScope.lock();
+        out<<(qint32)(parent?ids.value(parent.get(),-1):-1);
+        out<<statement->hintText<<statement->type<<statement->command<<statement->args
+          <<statement->argList<<statement->value<<(qint32)statement->kind
+          <<(qint32)statement->scope<<(qint32)statement->classScope
+          <<statement->hasDefinition<<(qint32)statement->line<<(qint32)statement->endLine
+          <<(qint32)statement->definitionLine<<(qint32)statement->definitionEndLine
+          <<statement->fileName<<statement->definitionFileName
+          <<statement->inProject<<statement->inSystemHeader<<statement->friends
+          <<statement->isStatic<<statement->isInherited<<statement->fullName
+          <<statement->usingList<<statement->noNameArgs;
+        QVector<QPair<qint32,qint32>> inheritIds;
+        for (int i=0;i<statement->inheritanceList.count();i++) {
+            PStatement inheritStatement = statement->inheritanceList[i].lock();
+            if (inheritStatement && ids.contains(inheritStatement.get()))
+                inheritIds.append(QPair<qint32,qint32>(
+                                      ids.value(inheritStatement.get()),
+                                      (qint32)statement->inheritanceAccessList.value(
+                                          i,StatementClassScope::scsPrivate)));
+        }
+        out<<inheritIds;
+        QVector<qint32> childIds;
+        foreach (const PStatement& child, statement->children) {
+            if (!child->isInherited)
+                childIds.append(ids.value(child.get(),-1));
+        }
+        out<<childIds;
+    }
+    QVector<qint32> globalIds;
+    foreach (const PStatement& statement, globalStatements) {
+        globalIds.append(ids.value(statement.get(),-1));
+    }
+    out<<globalIds;
+
+    // namespaces
+    out<<(qint32)mParser->mNamespaces.count();
+    for (auto it=mParser->mNamespaces.cbegin();it!=mParser->mNamespaces.cend();++it) {
+        QVector<qint32> namespaceIds;
+        foreach (const PStatement& statement, *(it.value())) {
+            qint32 id = ids.value(statement.get(),-1);
+            if (id>=0)
+                namespaceIds.append(id);
+        }
+        out<<it.key()<<namespaceIds;
+    }
+    if (out.status()==QDataStream::Ok)
+        mCacheDirty = false;
+}
+
+bool CppSystemHeaderStore::loadCache()
+{
+    struct CachedFile {
+        QString fileName;
+        qint64 lastModified;
+        qint64 size;
+        PFileIncludes fileIncludes;
+        QVector<QPair<QString,qint32>> statements;
+        QVector<QPair<QString,qint32>> declaredStatements;
+        QVector<QPair<qint32,qint32>> scopes;
+        PDefineMap defines;
+    };
+    if (mCacheDir.isEmpty())
+        return false;
+    QFile file(cacheFileName());
+    if (!file.open(QFile::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_9);
+    quint32 magic;
+    qint32 version;
+    QString key;
+    in>>magic>>version;
+    if (magic!=PARSER_CACHE_MAGIC || version!=PARSER_CACHE_VERSION)
+        return false;
+    in>>key;
+    if (key!=mKey)
+        return false;
+
+    // files
+    qint32 fileCount;
+    in>>fileCount;
+    QVector<CachedFile> files;
+    for (int i=0;i<fileCount && in.status()==QDataStream::Ok;i++) {
+        CachedFile cachedFile;
+        cachedFile.fileIncludes = std::make_shared<FileIncludes>();
+        PFileIncludes& fileIncludes = cachedFile.fileIncludes;
+        in>>cachedFile.fileName>>cachedFile.lastModified>>cachedFile.size;
+        in>>fileIncludes->baseFile>>fileIncludes->includeFiles>>fileIncludes->usings
+          >>fileIncludes->dependingFiles>>fileIncludes->dependedFiles;
+        in>>cachedFile.statements>>cachedFile.declaredStatements>>cachedFile.scopes;
+        qint32 defineCount;
+        in>>defineCount;
+        cachedFile.defines = std::make_shared<DefineMap>();
+        for (int j=0;j<defineCount && in.status()==QDataStream::Ok;j++) {
+            PDefine define = std::make_shared<Define>();
+            in>>define->name>>define->args>>define->value>>define->filename
+              >>define->hardCoded>>define->argList>>define->argUsed>>define->formatValue
+              >>define->formatParts>>define->formatArgs;
+            cachedFile.defines->insert(define->name,define);
+        }
+        files.append(cachedFile);
+    }
+    if (in.status()!=QDataStream::Ok)
+        return false;
+
+    // a file is usable if it's unchanged and all files it includes are usable
+    QSet<QString> validFiles;
+    foreach (const CachedFile& cachedFile, files) {
+        QFileInfo info(cachedFile.fileName);
+        if (info.exists()
+                && info.lastModified().toMSecsSinceEpoch() == cachedFile.lastModified
+                && info.size() == cachedFile.size)
+            validFiles.insert(cachedFile.fileName);
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        foreach (const CachedFile& cachedFile, files) {
+            if (!validFiles.contains(cachedFile.fileName))
+                continue;
+            foreach (const QString& includeFile, cachedFile.fileIncludes->includeFiles.keys()) {
+                if (!validFiles.contains(includeFile)) {
+                    validFiles.remove(cachedFile.fileName);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+    if (validFiles.count()!=files.count())
+        mCacheDirty = true;
+
+    // statements
+    qint32 statementCount;
+    in>>statementCount;
+    QVector<PStatement> statements;
+    QVector<QVector<QPair<qint32,qint32>>> inheritIds;
+    QVector<QVector<qint32>> childIds;
+    for (int i=0;i<statementCount && in.status()==QDataStream::Ok;i++) {
+        PStatement statement = std::make_shared<Statement>();
+        qint32 parentId,kind,scope,classScope,line,endLine,definitionLine,definitionEndLine;
+        QVector<QPair<qint32,qint32>> inherits;
+        QVector<qint32> children;
+        in>>parentId;
+        in>>statement->hintText>>statement->type>>statement->command>>statement->args
+          >>statement->argList>>statement->value>>kind
+          >>scope>>classScope
+          >>statement->hasDefinition>>line>>endLine
+          >>definitionLine>>definitionEndLine
+          >>statement->fileName>>statement->definitionFileName
+          >>statement->inProject>>statement->inSystemHeader>>statement->friends
+          >>statement->isStatic>>statement->isInherited>>statement->fullName
+          >>statement->usingList>>statement->noNameArgs;
+        in>>inherits>>children;
+        statement->type = internString(statement->type);
+        statement->command = internString(statement->command);
+        statement->args = internString(statement->args);
+        statement->noNameArgs = internString(statement->noNameArgs);
+        statement->fullName = internString(statement->fullName);
+        statement->fileName = internString(statement->fileName);
+        statement->definitionFileName = internString(statement->definitionFileName);
+        statement->kind = (StatementKind)kind;
+        statement->scope = (StatementScope)scope;
+        statement->classScope = (StatementClassScope)classScope;
+        statement->line = line;
+        statement->endLine = endLine;
+        statement->definitionLine = definitionLine;
+        statement->definitionEndLine = definitionEndLine;
+        statement->usageCount = -1;
+        statement->freqTop = 0;
+        statement->caseMatch = false;
+        // parents are saved before their children
+        bool valid = validFiles.contains(statement->fileName);
+        if (valid && parentId>=0) {
+            if (parentId<statements.count() && statements[parentId])
+                statement->parentScope = statements[parentId];
+            else
+                valid = false;
+        }
+        statements.append(valid?statement:PStatement());
+        inheritIds.append(inherits);
+        childIds.append(children);
+    }
+    QVector<qint32> globalIds;
+    in>>globalIds;
+    qint32 namespaceCount;
+    in>>namespaceCount;
+    QHash<QString,QVector<qint32>> namespaces;
+    for (int i=0;i<namespaceCount && in.status()==QDataStream::Ok;i++) {
+        QString name;
+        QVector<qint32> namespaceIds;
+        in>>name>>namespaceIds;
+        namespaces.insert(name,namespaceIds);
+    }
+    if (in.status()!=QDataStream::Ok)
+        return false;
+
+    // everything is read, link them into the parser
+    for (int i=0;i<statements.count();i++) {
+        const PStatement& statement = statements[i];
+        if (!statement)
+            continue;
+        foreach (const QPair<qint32,qint32>& inherit, inheritIds[i]) {
+            qint32 id = inherit.first;
+            if (id>=0 && id<statements.count() && statements[id]) {
+                statement->inheritanceList.append(statements[id]);
+                statement->inheritanceAccessList.append((StatementClassScope)inherit.second);
+            }
+        }
+        const QVector<qint32>& children = childIds[i];
+        for (int j=children.count()-1;j>=0;j--) {
+            qint32 id = children[j];
+            if (id>=0 && id<statements.count() && statements[id])
+                mParser->mStatementList.add(statements[id]);
+        }
+    }
+    for (int i=globalIds.count()-1;i>=0;i--) {
+        qint32 id = globalIds[i];
+        if (id>=0 && id<statements.count() && statements[id])
+            mParser->mStatementList.add(statements[id]);
+    }
+    for (auto it=namespaces.cbegin();it!=namespaces.cend();++it) {
+        PStatementList namespaceList;
+        foreach (qint32 id, it.value()) {
+            if (id<0 || id>=statements.count() || !statements[id])
+                continue;
+            if (!namespaceList) {
+                namespaceList = std::make_shared<StatementList>();
+                mParser->mNamespaces.insert(it.key(),namespaceList);
+            }
+            namespaceList->append(statements[id]);
+        }
+    }
+    foreach (const CachedFile& cachedFile, files) {
+        if (!validFiles.contains(cachedFile.fileName))
+            continue;
+        PFileIncludes fileIncludes = cachedFile.fileIncludes;
+        readStatementMap(cachedFile.statements,fileIncludes->statements,statements);
+        readStatementMap(cachedFile.declaredStatements,fileIncludes->declaredStatements,statements);
+        foreach (const auto& scope, cachedFile.scopes) {
+            PStatement statement;
+            if (scope.second>=0 && scope.second<statements.count())
+                statement = statements[scope.second];
+            fileIncludes->scopes.addScope(scope.first,statement);
+        }
+        mParser->mPreprocessor.addSharedFile(cachedFile.fileName,fileIncludes,cachedFile.defines);
+        mPublished.insert(cachedFile.fileName);
+        mPublishedFiles.append(cachedFile.fileName);
+        mParser->mSharedFiles.insert(cachedFile.fileName);
+    }
+    return true;
+}
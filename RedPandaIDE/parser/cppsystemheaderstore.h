@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef CPPSYSTEMHEADERSTORE_H
+#define CPPSYSTEMHEADERSTORE_H
+
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+#include <memory>
+#include "parserutils.h"
+
+class CppParser;
+
+/**
+ * @brief Statements parsed from the compiler set's system headers, shared by all
+ * CppParsers that use the same include dirs and hard defines.
+ *
+ * Headers are parsed once on demand and then published. Published files are never
+ * reparsed, removed or changed (the store's own parser treats them as shared too),
+ * so parsers linked to the store can use their statements read-only without copying
+ * them. Each linked parser gets its own copy of the include records.
+ *
+ * If a cache dir is given, the published files are saved to disk when the store is
+ * destroyed, and loaded back on its first use. A cached file is only used if it's
+ * unchanged (modification time and size) and all files it includes are usable too.
+ */
+class CppSystemHeaderStore
+{
+public:
+    ~CppSystemHeaderStore();
+
+    /**
+     * @brief get the store for the given configuration, create it if there is none
+     * @param includePaths compiler set's include dirs, in search order
+     * @param defineLines hard defines ("#define XXX YYY")
+     * @param cacheDir where to save parse results between sessions, empty if not saved
+     */
+    static std::shared_ptr<CppSystemHeaderStore> acquire(const QStringList& includePaths,
+                                                         const QStringList& defineLines,
+                                                         const QString& cacheDir = QString());
+
+    /**
+     * @brief parse the header (and the headers it includes) if it's not published yet
+     * @return true if the header is published
+     */
+    bool ensureParsed(const QString& fileName);
+    bool isSystemHeaderFile(const QString& fileName) const;
+    bool isPublished(const QString& fileName);
+    /**
+     * @brief files published after the first "index" ones. index is updated to the new count.
+     */
+    QStringList publishedFilesSince(int& index);
+    /**
+     * @brief a copy of the file's include record for a linked parser. The statements
+     * in it are shared and must not be changed.
+     */
+    PFileIncludes fileIncludes(const QString& fileName);
+    PDefineMap fileDefines(const QString& fileName);
+    const QString& key() const;
+private:
+    explicit CppSystemHeaderStore(const QString& key,
+                                  const QStringList& includePaths,
+                                  const QStringList& defineLines,
+                                  const QString& cacheDir);
+    void publishNewFiles();
+    QString cacheFileName() const;
+    bool loadCache();
+    void saveCache();
+private:
+    QString mKey;
+    QSet<QString> mIncludePaths;
+    std::unique_ptr<CppParser> mParser;
+    QStringList mPublishedFiles; // append only
+    QSet<QString> mPublished;
+    QString mCacheDir;
+    bool mCacheLoaded;
+    bool mCacheDirty;
+    QMutex mMutex;
+};
+
+using PCppSystemHeaderStore = std::shared_ptr<CppSystemHeaderStore>;
+
+#endif // CPPSYSTEMHEADERSTORE_H
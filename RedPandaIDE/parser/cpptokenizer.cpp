@@ -27,6 +27,7 @@ CppTokenizer::CppTokenizer()
 void CppTokenizer::reset()
 {
     mTokenList.clear();
+    mTokenTexts.clear();
     mBuffer.clear();
     mBufferStr.clear();
 }
@@ -43,6 +44,8 @@ void CppTokenizer::tokenize(const QStringList &buffer)
         mBufferStr+='\n';
         mBufferStr+=mBuffer[i];
     }
+    // roughly one token per 8 chars, avoid growing the array too many times
+    mTokenList.reserve(mBufferStr.length() / 8);
     mStart = mBufferStr.data();
     mCurrent = mStart;
     mLineCount = mStart;
@@ -66,8 +69,8 @@ void CppTokenizer::dumpTokens(const QString &fileName)
 
     if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
         QTextStream stream(&file);
-        foreach (const PToken& token,mTokenList) {
-            stream<<QString("%1,%2").arg(token->line).arg(token->text)<<endl;
+        foreach (const Token& token,mTokenList) {
+            stream<<QString("%1,%2").arg(token.line).arg(token.text)<<endl;
         }
     }
 }
@@ -79,7 +82,7 @@ const CppTokenizer::TokenList &CppTokenizer::tokens()
 
 CppTokenizer::PToken CppTokenizer::operator[](int i)
 {
-    return mTokenList[i];
+    return &mTokenList[i];
 }
 
 int CppTokenizer::tokenCount()
@@ -89,9 +92,12 @@ int CppTokenizer::tokenCount()
 
 void CppTokenizer::addToken(const QString &sText, int iLine)
 {
-    PToken token = std::make_shared<Token>();
-    token->text = sText;
-    token->line = iLine;
+    auto it = mTokenTexts.constFind(sText);
+    if (it == mTokenTexts.constEnd())
+        it = mTokenTexts.insert(sText);
+    Token token;
+    token.text = *it;
+    token.line = iLine;
     mTokenList.append(token);
 }
 
@@ -597,7 +603,7 @@ void CppTokenizer::advance()
         break;
     case '=': {
         if (mTokenList.size()>2
-                && mTokenList[mTokenList.size()-2]->text == "using") {
+                && mTokenList[mTokenList.size()-2].text == "using") {
             addToken("=",mCurrentLine);
             mCurrent++;
         } else
@@ -18,6 +18,7 @@
 #define CPPTOKENIZER_H
 
 #include <QObject>
+#include <QSet>
 #include "parserutils.h"
 
 class CppTokenizer
@@ -27,8 +28,9 @@ public:
       QString text;
       int line;
     };
-    using PToken = std::shared_ptr<Token>;
-    using TokenList = QVector<PToken>;
+    // tokens are stored by value in one array, PToken is only valid until the next tokenize()/reset()
+    using PToken = Token*;
+    using TokenList = QVector<Token>;
     explicit CppTokenizer();
 
     void reset();
@@ -41,7 +43,6 @@ private:
     void addToken(const QString& sText, int iLine);
     void advance();
     void countLines();
-    PToken getToken(int index);
 
     QString getArguments();
     QString getForInit();
@@ -91,6 +92,7 @@ private:
     int mCurrentLine;
     QString mLastToken;
     TokenList mTokenList;
+    QSet<QString> mTokenTexts; // same token texts share one string buffer
 };
 
 #endif // CPPTOKENIZER_H
@@ -16,11 +16,14 @@
  */
 #include "parserutils.h"
 
+#include <algorithm>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
 #include <QDebug>
 #include <QGlobalStatic>
+#include <QMutex>
+#include <QTextStream>
 #include "../utils.h"
 
 QStringList CppDirectives;
@@ -36,6 +39,12 @@ QSet<QString> MemberOperators;
 Q_GLOBAL_STATIC(QSet<QString>,CppHeaderExts)
 Q_GLOBAL_STATIC(QSet<QString>,CppSourceExts)
 
+static QMutex internedStringsMutex;
+static QSet<QString> internedStrings;
+static qint64 internedStringsHits = 0; // times a string is shared instead of stored again
+static int internedStringsCountAfterPurge = 0;
+#define INTERNED_STRINGS_PURGE_MIN_COUNT 8192
+
 void initParser()
 {
     CppHeaderExts->insert("h");
@@ -493,6 +502,11 @@ void CppScopes::clear()
     mScopes.clear();
 }
 
+const QVector<PCppScope> &CppScopes::scopes() const
+{
+    return mScopes;
+}
+
 MemberOperatorType getOperatorType(const QString &phrase, int index)
 {
     if (index>=phrase.length())
@@ -598,3 +612,69 @@ bool isMemberOperator(QString token)
 {
     return MemberOperators.contains(token);
 }
+
+QString internString(const QString &str)
+{
+    if (str.isEmpty())
+        return str;
+    QMutexLocker locker(&internedStringsMutex);
+    auto it = internedStrings.constFind(str);
+    if (it == internedStrings.constEnd()) {
+        it = internedStrings.insert(str);
+    } else if (it->constData() != str.constData()) {
+        internedStringsHits++;
+    }
+    return *it;
+}
+
+void purgeInternedStrings()
+{
+    QMutexLocker locker(&internedStringsMutex);
+    // walking the pool is only worth it after it has grown a lot
+    if (internedStrings.count() < std::max(internedStringsCountAfterPurge*2,
+                                           INTERNED_STRINGS_PURGE_MIN_COUNT))
+        return;
+    for (auto it=internedStrings.begin();it!=internedStrings.end();) {
+        // only referenced by the pool itself
+        if (it->isDetached())
+            it = internedStrings.erase(it);
+        else
+            ++it;
+    }
+    internedStringsCountAfterPurge = internedStrings.count();
+}
+
+void dumpInternedStrings(const QString &logFile)
+{
+    // count under the lock, but don't block the parsers while writing the file
+    QSet<QString> strings;
+    qint64 hits;
+    qint64 bytes = 0;
+    qint64 references = 0;
+    qint64 unsharedBytes = 0;
+    {
+        QMutexLocker locker(&internedStringsMutex);
+        foreach (const QString& str, internedStrings) {
+            bytes += str.length() * sizeof(QChar);
+            // not counting the pool itself
+            int refCount = str.data_ptr()->ref.atomic.load() - 1;
+            if (refCount > 0) {
+                references += refCount;
+                unsharedBytes += refCount * str.length() * sizeof(QChar);
+            }
+        }
+        strings = internedStrings;
+        hits = internedStringsHits;
+    }
+    QFile file(logFile);
+    if (file.open(QFile::WriteOnly | QFile::Truncate)) {
+        QTextStream out(&file);
+        out<<QString("interned strings: %1, %2 bytes").arg(strings.count()).arg(bytes)<<endl;
+        out<<QString("referenced %1 times, %2 bytes if every reference has its own copy")
+             .arg(references).arg(unsharedBytes)<<endl;
+        out<<QString("shared instead of stored again: %1 times").arg(hits)<<endl;
+        foreach (const QString& str, strings) {
+            out<<str<<endl;
+        }
+    }
+}
@@ -42,6 +42,8 @@ struct Define {
     QStringList argList; // args list to format values
     QList<bool> argUsed;
     QString formatValue; // format template to format values
+    QStringList formatParts; // value split at the args, formatParts.count() == formatArgs.count()+1
+    QList<int> formatArgs; // index of the arg between formatParts[i] and formatParts[i+1]
 };
 
 using PDefine = std::shared_ptr<Define>;
@@ -140,6 +142,7 @@ struct Statement {
     QString value; // Used for macro defines/typedef, "100" in "#defin COUNT 100"
     StatementKind kind; // kind of statement class/variable/function/etc
     QList<std::weak_ptr<Statement>> inheritanceList; // list of statements this one inherits from, can be nil
+    QList<StatementClassScope> inheritanceAccessList; // access of the members inherited from each inheritanceList entry
     StatementScope scope; // global/local/classlocal
     StatementClassScope classScope; // protected/private/public
     bool hasDefinition; // definiton line/filename is valid
@@ -217,6 +220,7 @@ public:
     PStatement lastScope();
     void removeLastScope();
     void clear();
+    const QVector<PCppScope>& scopes() const;
 private:
     QVector<PCppScope> mScopes;
 };
@@ -230,6 +234,9 @@ struct FileIncludes {
     CppScopes scopes; // int is start line of the statement scope
     QSet<QString> dependingFiles; // The files I depeneds on
     QSet<QString> dependedFiles; // the files depends on me
+    QByteArray contentHash; // hash of the text without comments, empty for system headers
+    QByteArray includesHash; // hash of the included files' contentHash, when it's parsed
+    QByteArray signatureHash; // hash of the declarations (but not their lines), calculated on demand
 };
 using PFileIncludes = std::shared_ptr<FileIncludes>;
 using ColorCallback = std::function<QColor (PStatement)>;
@@ -264,4 +271,21 @@ QStringList getOwnerExpressionAndMember(
         QStringList& memberExpression);
 bool isMemberOperator(QString token);
 
+/**
+ * @brief get a copy of the string sharing its buffer with all other interned copies,
+ * so names, types and file names repeated in many statements (and parsers) are
+ * stored only once. Equal interned strings compare by pointer.
+ */
+QString internString(const QString& str);
+/**
+ * @brief remove interned strings that are not used anymore. Does nothing until the
+ * pool has doubled since the last purge, so calling it often is cheap.
+ */
+void purgeInternedStrings();
+/**
+ * @brief write count and memory usage of the interned strings to the log file:
+ * the pool's size, and the size if every reference had its own copy
+ */
+void dumpInternedStrings(const QString& logFile);
+
 #endif // PARSER_UTILS_H
@@ -35,6 +35,8 @@ void StatementModel::add(const PStatement& statement)
     } else {
         addMember(mGlobalStatements,statement);
     }
+    addToIndex(parent,statement);
+    clearMemberViews();
     mCount++;
 #ifdef QT_DEBUG
     mAllStatements.append(statement);
@@ -54,6 +56,9 @@ void StatementModel::deleteStatement(const PStatement& statement)
     } else {
         count = deleteMember(mGlobalStatements,statement);
     }
+    if (count>0)
+        removeFromIndex(parent,statement);
+    clearMemberViews();
     mCount -= count;
 #ifdef QT_DEBUG
     mAllStatements.removeOne(statement);
@@ -63,11 +68,36 @@ void StatementModel::deleteStatement(const PStatement& statement)
 
 const StatementMap &StatementModel::childrenStatements(const PStatement& statement) const
 {
-    if (!statement) {
+    if (!statement)
         return mGlobalStatements;
-    } else {
+    if (statement->kind != StatementKind::skClass
+            || statement->inheritanceList.isEmpty())
         return statement->children;
+    QMutexLocker locker(&mMemberViewsMutex);
+    std::shared_ptr<MemberView> view = mMemberViews.value(statement.get());
+    if (view)
+        return view->members;
+    view = std::make_shared<MemberView>();
+    view->statement = statement;
+    QList<PStatement> inheritedMembers;
+    QSet<const Statement*> visited;
+    forEachInheritedMember(statement, QString(),
+                           [&statement,&inheritedMembers](const PStatement& member, StatementClassScope access) {
+        if (access == member->classScope)
+            inheritedMembers.append(member);
+        else
+            inheritedMembers.append(createInheritedMember(statement,member,access));
+    }, visited);
+    // the class's own members hide the inherited ones, keep them first
+    for (int i=inheritedMembers.count()-1;i>=0;i--)
+        view->members.insert(inheritedMembers[i]->command,inheritedMembers[i]);
+    auto it = statement->children.constEnd();
+    while (it != statement->children.constBegin()) {
+        --it;
+        view->members.insert(it.key(),it.value());
     }
+    mMemberViews.insert(statement.get(),view);
+    return view->members;
 }
 
 const StatementMap &StatementModel::childrenStatements(std::weak_ptr<Statement> statement) const
@@ -76,9 +106,170 @@ const StatementMap &StatementModel::childrenStatements(std::weak_ptr<Statement>
     return childrenStatements(s);
 }
 
+PStatement StatementModel::findChild(const PStatement &scope, const QString &name) const
+{
+    PStatement statement;
+    if (isIndexed(scope))
+        statement = mScopeMemberIndex.value(ScopeMemberKey(scope.get(),name),PStatement());
+    else
+        statement = scope->children.value(name,PStatement());
+    if (statement || !scope || scope->inheritanceList.isEmpty())
+        return statement;
+    QSet<const Statement*> visited;
+    forEachInheritedMember(scope, name,
+                           [&statement](const PStatement& member, StatementClassScope) {
+        if (!statement)
+            statement = member;
+    }, visited);
+    return statement;
+}
+
+QList<PStatement> StatementModel::findChildren(const PStatement &scope, const QString &name) const
+{
+    QList<PStatement> result = findOwnChildren(scope,name);
+    if (!scope || scope->inheritanceList.isEmpty())
+        return result;
+    QSet<const Statement*> visited;
+    forEachInheritedMember(scope, name,
+                           [&result](const PStatement& member, StatementClassScope) {
+        result.append(member);
+    }, visited);
+    return result;
+}
+
+PStatement StatementModel::findStatementByFullName(const QString &fullName) const
+{
+    return mFullNameIndex.value(fullName,PStatement());
+}
+
+int StatementModel::count() const
+{
+    return mCount;
+}
+
 void StatementModel::clear() {
     mCount=0;
     mGlobalStatements.clear();
+    mScopeMemberIndex.clear();
+    mIndexedChildCount.clear();
+    mFullNameIndex.clear();
+    clearMemberViews();
+}
+
+void StatementModel::clearMemberViews()
+{
+    QMutexLocker locker(&mMemberViewsMutex);
+    mMemberViews.clear();
+}
+
+void StatementModel::copyFrom(const StatementModel &other,
+                              const std::function<PStatement (const PStatement &)> &copyOf)
+{
+    clear();
+    mCount = other.mCount;
+    mGlobalStatements = other.mGlobalStatements;
+    for (auto it=mGlobalStatements.begin();it!=mGlobalStatements.end();++it)
+        it.value() = copyOf(it.value());
+    // QMultiHash keeps the values inserted last first, insert them in reverse
+    foreach (const ScopeMemberKey& key, other.mScopeMemberIndex.uniqueKeys()) {
+        QList<PStatement> statements = other.mScopeMemberIndex.values(key);
+        for (int i=statements.count()-1;i>=0;i--) {
+            PStatement statement = copyOf(statements[i]);
+            PStatement parent = statement->parentScope.lock();
+            mScopeMemberIndex.insert(ScopeMemberKey(parent.get(),key.second),statement);
+            if (parent)
+                mIndexedChildCount[parent.get()]++;
+        }
+    }
+    foreach (const QString& fullName, other.mFullNameIndex.uniqueKeys()) {
+        QList<PStatement> statements = other.mFullNameIndex.values(fullName);
+        for (int i=statements.count()-1;i>=0;i--)
+            mFullNameIndex.insert(fullName,copyOf(statements[i]));
+    }
+#ifdef QT_DEBUG
+    foreach (const PStatement& statement, other.mAllStatements)
+        mAllStatements.append(copyOf(statement));
+#endif
+}
+
+QList<PStatement> StatementModel::findOwnChildren(const PStatement &scope, const QString &name) const
+{
+    if (!isIndexed(scope))
+        return scope->children.values(name);
+    return mScopeMemberIndex.values(ScopeMemberKey(scope.get(),name));
+}
+
+void StatementModel::forEachInheritedMember(const PStatement &statement, const QString &name,
+                                            const std::function<void (const PStatement &, StatementClassScope)> &onMember,
+                                            QSet<const Statement*>& visited) const
+{
+    // inheritanceList of a class is only changed while parsing it
+    if (statement->kind != StatementKind::skClass
+            || visited.contains(statement.get()))
+        return;
+    // bad code may inherit circularly
+    visited.insert(statement.get());
+    for (int i=0;i<statement->inheritanceList.count();i++) {
+        PStatement base = statement->inheritanceList[i].lock();
+        if (!base)
+            continue;
+        StatementClassScope access = statement->inheritanceAccessList.value(
+                    i,StatementClassScope::scsPrivate);
+        auto inherit = [&onMember,access](const PStatement& member, StatementClassScope memberAccess) {
+            if (memberAccess == StatementClassScope::scsPrivate
+                    || member->kind == StatementKind::skConstructor
+                    || member->kind == StatementKind::skDestructor)
+                return;
+            switch(access) {
+            case StatementClassScope::scsPublic:
+                break;
+            case StatementClassScope::scsProtected:
+                memberAccess = StatementClassScope::scsProtected;
+                break;
+            default:
+                memberAccess = StatementClassScope::scsPrivate;
+            }
+            onMember(member,memberAccess);
+        };
+        if (name.isEmpty()) {
+            foreach (const PStatement& member, base->children)
+                inherit(member,member->classScope);
+        } else {
+            foreach (const PStatement& member, findOwnChildren(base,name))
+                inherit(member,member->classScope);
+        }
+        forEachInheritedMember(base,name,inherit,visited);
+    }
+}
+
+PStatement StatementModel::createInheritedMember(const PStatement &derived, const PStatement &inherit, StatementClassScope access)
+{
+    PStatement statement = std::make_shared<Statement>();
+    statement->parentScope = derived;
+    statement->hintText = inherit->hintText;
+    statement->type = inherit->type;
+    statement->command = inherit->command;
+    statement->args = inherit->args;
+    statement->noNameArgs = inherit->noNameArgs;
+    statement->value = inherit->value;
+    statement->kind = inherit->kind;
+    statement->inheritanceList = inherit->inheritanceList;
+    statement->inheritanceAccessList = inherit->inheritanceAccessList;
+    statement->scope = inherit->scope;
+    statement->classScope = access;
+    statement->hasDefinition = true;
+    statement->line = inherit->line;
+    statement->definitionLine = inherit->line;
+    statement->fileName = inherit->fileName;
+    statement->definitionFileName = inherit->fileName;
+    statement->inProject = derived->inProject;
+    statement->inSystemHeader = derived->inSystemHeader;
+    statement->isStatic = inherit->isStatic;
+    statement->isInherited = true;
+    statement->fullName = internString(derived->fullName + "::" + inherit->command);
+    statement->usageCount = -1;
+    statement->freqTop = 0;
+    return statement;
 }
 
 void StatementModel::dump(const QString &logFile)
@@ -133,6 +324,42 @@ int StatementModel::deleteMember(StatementMap &map, const PStatement& statement)
     return map.remove(statement->command,statement);
 }
 
+bool StatementModel::isIndexed(const PStatement &scope) const
+{
+    if (!scope)
+        return true;
+    return mIndexedChildCount.value(scope.get(),0) == scope->children.count();
+}
+
+void StatementModel::addToIndex(const PStatement &parent, const PStatement &statement)
+{
+    mScopeMemberIndex.insert(ScopeMemberKey(parent.get(),statement->command),statement);
+    if (parent)
+        mIndexedChildCount[parent.get()]++;
+    if (statement->scope != StatementScope::ssLocal
+            && statement->kind != StatementKind::skBlock)
+        mFullNameIndex.insert(statement->fullName,statement);
+}
+
+void StatementModel::removeFromIndex(const PStatement &parent, const PStatement &statement)
+{
+    mScopeMemberIndex.remove(ScopeMemberKey(parent.get(),statement->command),statement);
+    if (parent) {
+        auto it = mIndexedChildCount.find(parent.get());
+        if (it != mIndexedChildCount.end() && --it.value() <= 0)
+            mIndexedChildCount.erase(it);
+    }
+    if (statement->scope != StatementScope::ssLocal
+            && statement->kind != StatementKind::skBlock)
+        mFullNameIndex.remove(statement->fullName,statement);
+    // the statement may be reused at the same address, don't keep its children indexed
+    if (mIndexedChildCount.remove(statement.get())>0) {
+        foreach (const PStatement& child, statement->children) {
+            mScopeMemberIndex.remove(ScopeMemberKey(statement.get(),child->command),child);
+        }
+    }
+}
+
 void StatementModel::dumpStatementMap(StatementMap &map, QTextStream &out, int level)
 {
     QString indent(level,'\t');
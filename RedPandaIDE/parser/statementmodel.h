@@ -17,8 +17,11 @@
 #ifndef STATEMENTMODEL_H
 #define STATEMENTMODEL_H
 
+#include <QHash>
+#include <QMutex>
 #include <QObject>
 #include <QTextStream>
+#include <functional>
 #include "parserutils.h"
 
 class StatementModel : public QObject
@@ -31,10 +34,45 @@ public:
 //    function DeleteFirst: Integer;
 //    function DeleteLast: Integer;
     void deleteStatement(const PStatement& statement);
+    /**
+     * @brief children of the statement, with the members a class inherits.
+     * Inherited members are the base classes' own statements, or copies when the
+     * inheritance narrows their access. The map of a derived class is built on first
+     * use and kept until the model is changed, which is only done while parsing.
+     */
     const StatementMap& childrenStatements(const PStatement& statement = PStatement()) const;
     const StatementMap& childrenStatements(std::weak_ptr<Statement> statement) const;
+    /**
+     * @brief same as childrenStatements(scope).value(name), but uses the hash index
+     * and looks the name up in the base classes
+     */
+    PStatement findChild(const PStatement& scope, const QString& name) const;
+    /**
+     * @brief same as childrenStatements(scope).values(name), but uses the hash index
+     * and looks the name up in the base classes
+     */
+    QList<PStatement> findChildren(const PStatement& scope, const QString& name) const;
+    /**
+     * @brief find a (non-local) statement added to this model by its full name
+     */
+    PStatement findStatementByFullName(const QString& fullName) const;
+    /**
+     * @brief number of statements in the model
+     */
+    int count() const;
     void clear();
     void dump(const QString& logFile);
+    /**
+     * @brief drop the member maps of derived classes, they're built again on next use.
+     * Used when base classes are changed without adding or deleting statements.
+     */
+    void clearMemberViews();
+    /**
+     * @brief make this model a copy of other. copyOf maps each statement of other
+     * to the one used in this model, the model is indexed by the mapped statements.
+     */
+    void copyFrom(const StatementModel& other,
+                  const std::function<PStatement (const PStatement&)>& copyOf);
 #ifdef QT_DEBUG
     void dumpAll(const QString& logFile);
 #endif
@@ -42,9 +80,38 @@ private:
     void addMember(StatementMap& map, const PStatement& statement);
     int deleteMember(StatementMap& map, const PStatement& statement);
     void dumpStatementMap(StatementMap& map, QTextStream& out, int level);
+    static PStatement createInheritedMember(const PStatement& derived,
+                                            const PStatement& inherit,
+                                            StatementClassScope access);
+    QList<PStatement> findOwnChildren(const PStatement& scope, const QString& name) const;
+    /**
+     * @brief call onMember for each member the class inherits (named name, or all
+     * if name is empty), with the access it has in the class
+     */
+    void forEachInheritedMember(const PStatement& statement, const QString& name,
+                                const std::function<void (const PStatement&, StatementClassScope)>& onMember,
+                                QSet<const Statement*>& visited) const;
+    bool isIndexed(const PStatement& scope) const;
+    void addToIndex(const PStatement& parent, const PStatement& statement);
+    void removeFromIndex(const PStatement& parent, const PStatement& statement);
 private:
+    using ScopeMemberKey = QPair<const Statement*,QString>;
     int mCount;
     StatementMap mGlobalStatements;  //may have overloaded functions, so use PStatementList to store
+    // (scope, name) -> statements, newest first like StatementMap
+    QMultiHash<ScopeMemberKey,PStatement> mScopeMemberIndex;
+    // count of children indexed for each scope; children of statements added by another
+    // model (like the shared system header store) are not indexed here
+    QHash<const Statement*,int> mIndexedChildCount;
+    QMultiHash<QString,PStatement> mFullNameIndex;
+    // members of derived classes, including inherited ones. Readers on different
+    // threads may build them; the maps are never changed after they're built
+    struct MemberView {
+        PStatement statement; // keeps the key's address from being reused
+        StatementMap members;
+    };
+    mutable QHash<const Statement*,std::shared_ptr<MemberView>> mMemberViews;
+    mutable QMutex mMemberViewsMutex;
 #ifdef QT_DEBUG
     StatementList mAllStatements;
 #endif
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "symbolindex.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+
+#define SYMBOL_INDEX_MAGIC 0x52505349 // "RPSI"
+#define SYMBOL_INDEX_VERSION 1
+
+static qint64 fileLastModified(const QString& fileName)
+{
+    QFileInfo info(fileName);
+    if (!info.exists())
+        return -1;
+    return info.lastModified().toMSecsSinceEpoch();
+}
+
+static bool isWordStart(const QString& text, int i)
+{
+    if (i == 0)
+        return true;
+    QChar prev = text[i-1];
+    if (prev == '_' || prev == ':')
+        return true;
+    return text[i].isUpper() && prev.isLower();
+}
+
+SymbolIndex::SymbolIndex():
+    mModified(false),
+    mChangeCount(0)
+{
+
+}
+
+void SymbolIndex::setFileSymbols(const QString &fileName, const QVector<SymbolIndexEntry> &symbols)
+{
+    FileSymbols fileSymbols;
+    fileSymbols.lastModified = fileLastModified(fileName);
+    fileSymbols.symbols = symbols;
+    fillLowerNames(fileSymbols);
+    QWriteLocker locker(&mLock);
+    if (symbols.isEmpty())
+        mFiles.remove(fileName);
+    else
+        mFiles.insert(fileName,fileSymbols);
+    mModified = true;
+    mChangeCount++;
+}
+
+void SymbolIndex::removeFile(const QString &fileName)
+{
+    QWriteLocker locker(&mLock);
+    if (mFiles.remove(fileName)>0) {
+        mModified = true;
+        mChangeCount++;
+    }
+}
+
+void SymbolIndex::retainFiles(const QSet<QString> &fileNames)
+{
+    QWriteLocker locker(&mLock);
+    for (auto it=mFiles.begin();it!=mFiles.end();) {
+        if (!fileNames.contains(it.key())) {
+            it = mFiles.erase(it);
+            mModified = true;
+            mChangeCount++;
+        } else
+            ++it;
+    }
+}
+
+void SymbolIndex::clear()
+{
+    QWriteLocker locker(&mLock);
+    mFiles.clear();
+    mModified = true;
+    mChangeCount++;
+}
+
+int SymbolIndex::count()
+{
+    QReadLocker locker(&mLock);
+    int result = 0;
+    foreach (const FileSymbols& fileSymbols, mFiles) {
+        result += fileSymbols.symbols.count();
+    }
+    return result;
+}
+
+QList<SymbolSearchResult> SymbolIndex::search(const QString &pattern, int maxCount)
+{
+    struct Match {
+        int score;
+        const FileSymbols* fileSymbols;
+        int index;
+    };
+    QList<SymbolSearchResult> result;
+    QString trimmedPattern = pattern.trimmed();
+    if (trimmedPattern.isEmpty() || maxCount<=0)
+        return result;
+    QString lowerPattern = trimmedPattern.toLower();
+    bool matchFullName = trimmedPattern.contains("::");
+
+    QReadLocker locker(&mLock);
+    QVector<Match> matches;
+    foreach (const FileSymbols& fileSymbols, mFiles) {
+        const QVector<QString>& texts = matchFullName ? fileSymbols.lowerFullNames : fileSymbols.lowerNames;
+        for (int i=0;i<fileSymbols.symbols.count();i++) {
+            const SymbolIndexEntry& entry = fileSymbols.symbols[i];
+            int score = matchScore(trimmedPattern, lowerPattern,
+                                   matchFullName ? entry.fullName : entry.name, texts[i]);
+            if (score >= 0)
+                matches.append(Match{score, &fileSymbols, i});
+        }
+    }
+    auto isBetter = [](const Match& m1, const Match& m2) {
+        if (m1.score != m2.score)
+            return m1.score > m2.score;
+        const SymbolIndexEntry& e1 = m1.fileSymbols->symbols[m1.index];
+        const SymbolIndexEntry& e2 = m2.fileSymbols->symbols[m2.index];
+        if (e1.fullName != e2.fullName)
+            return e1.fullName < e2.fullName;
+        if (e1.fileName != e2.fileName)
+            return e1.fileName < e2.fileName;
+        return e1.line < e2.line;
+    };
+    int count = std::min(maxCount, matches.count());
+    std::partial_sort(matches.begin(), matches.begin()+count, matches.end(), isBetter);
+    for (int i=0;i<count;i++) {
+        const Match& match = matches[i];
+        result.append(SymbolSearchResult{match.fileSymbols->symbols[match.index], match.score});
+    }
+    return result;
+}
+
+bool SymbolIndex::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_9);
+    quint32 magic;
+    qint32 version;
+    in>>magic>>version;
+    if (magic!=SYMBOL_INDEX_MAGIC || version!=SYMBOL_INDEX_VERSION)
+        return false;
+    qint32 fileCount;
+    in>>fileCount;
+    QHash<QString,FileSymbols> files;
+    for (int i=0;i<fileCount && in.status()==QDataStream::Ok;i++) {
+        QString symbolFileName;
+        FileSymbols fileSymbols;
+        qint32 symbolCount;
+        in>>symbolFileName>>fileSymbols.lastModified>>symbolCount;
+        fileSymbols.symbols.reserve(symbolCount);
+        for (int j=0;j<symbolCount && in.status()==QDataStream::Ok;j++) {
+            SymbolIndexEntry entry;
+            qint32 kind;
+            qint32 line;
+            in>>entry.name>>entry.fullName>>entry.type>>entry.args>>kind>>line;
+            entry.kind = static_cast<StatementKind>(kind);
+            entry.line = line;
+            entry.fileName = symbolFileName;
+            fileSymbols.symbols.append(entry);
+        }
+        // the file is changed since it's saved
+        if (fileSymbols.lastModified != fileLastModified(symbolFileName))
+            continue;
+        fillLowerNames(fileSymbols);
+        files.insert(symbolFileName,fileSymbols);
+    }
+    if (in.status()!=QDataStream::Ok)
+        return false;
+    QWriteLocker locker(&mLock);
+    for (auto it=files.begin();it!=files.end();++it) {
+        // files already parsed in this session are newer
+        if (!mFiles.contains(it.key()))
+            mFiles.insert(it.key(),it.value());
+    }
+    return true;
+}
+
+bool SymbolIndex::save(const QString &fileName)
+{
+    // write a copy, so the parser and searches don't wait for the disk
+    QHash<QString,FileSymbols> files;
+    int changeCount;
+    {
+        QReadLocker locker(&mLock);
+        files = mFiles;
+        changeCount = mChangeCount;
+    }
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+        return false;
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_9);
+    out<<(quint32)SYMBOL_INDEX_MAGIC<<(qint32)SYMBOL_INDEX_VERSION;
+    out<<(qint32)files.count();
+    for (auto it=files.cbegin();it!=files.cend();++it) {
+        const FileSymbols& fileSymbols = it.value();
+        out<<it.key()<<fileSymbols.lastModified<<(qint32)fileSymbols.symbols.count();
+        foreach (const SymbolIndexEntry& entry, fileSymbols.symbols) {
+            out<<entry.name<<entry.fullName<<entry.type<<entry.args
+              <<(qint32)entry.kind<<(qint32)entry.line;
+        }
+    }
+    if (out.status()!=QDataStream::Ok)
+        return false;
+    QWriteLocker locker(&mLock);
+    // not modified again while writing
+    if (mChangeCount == changeCount)
+        mModified = false;
+    return true;
+}
+
+bool SymbolIndex::modified()
+{
+    QReadLocker locker(&mLock);
+    return mModified;
+}
+
+void SymbolIndex::fillLowerNames(FileSymbols &fileSymbols)
+{
+    fileSymbols.lowerNames.clear();
+    fileSymbols.lowerFullNames.clear();
+    fileSymbols.lowerNames.reserve(fileSymbols.symbols.count());
+    fileSymbols.lowerFullNames.reserve(fileSymbols.symbols.count());
+    foreach (const SymbolIndexEntry& entry, fileSymbols.symbols) {
+        fileSymbols.lowerNames.append(entry.name.toLower());
+        fileSymbols.lowerFullNames.append(entry.fullName.toLower());
+    }
+}
+
+/*
+ * exact match > prefix > substring > chars in order;
+ * matches at word starts ("fB" in "fooBar", "b" in "foo_bar") and runs of chars score higher
+ */
+int SymbolIndex::matchScore(const QString &pattern, const QString &lowerPattern,
+                            const QString &text, const QString &lowerText)
+{
+    if (lowerPattern.length() > lowerText.length())
+        return -1;
+    int lengthPenalty = std::min(lowerText.length() - lowerPattern.length(), 100);
+    if (lowerText == lowerPattern)
+        return (text == pattern) ? 2000 : 1900;
+    if (lowerText.startsWith(lowerPattern))
+        return (text.startsWith(pattern) ? 1600 : 1500) - lengthPenalty;
+    int pos = lowerText.indexOf(lowerPattern);
+    if (pos >= 0)
+        return (isWordStart(text,pos) ? 1200 : 1000) - lengthPenalty;
+    int score = 0;
+    int i = 0;
+    int lastMatch = -2;
+    foreach (const QChar& ch, lowerPattern) {
+        while (i < lowerText.length() && lowerText[i] != ch)
+            i++;
+        if (i >= lowerText.length())
+            return -1;
+        if (i == lastMatch+1)
+            score += 10;
+        else if (isWordStart(text,i))
+            score += 8;
+        else
+            score += 1;
+        lastMatch = i;
+        i++;
+    }
+    return std::max(0, score * 900 / (lowerPattern.length()*10) - lengthPenalty);
+}
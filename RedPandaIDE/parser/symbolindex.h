@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef SYMBOLINDEX_H
+#define SYMBOLINDEX_H
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QVector>
+#include <memory>
+#include "parserutils.h"
+
+struct SymbolIndexEntry {
+    QString name; // "foo"
+    QString fullName; // "ClassA::foo"
+    QString type;
+    QString args;
+    StatementKind kind;
+    QString fileName;
+    int line;
+};
+
+struct SymbolSearchResult {
+    SymbolIndexEntry entry;
+    int score;
+};
+
+/**
+ * @brief Names, kinds and locations of the project's global and class members.
+ *
+ * The parser replaces the symbols of a file each time it finishes parsing the file.
+ * Searches only hold the index's own lock, so they don't wait for the parser.
+ */
+class SymbolIndex
+{
+public:
+    SymbolIndex();
+    void setFileSymbols(const QString& fileName, const QVector<SymbolIndexEntry>& symbols);
+    void removeFile(const QString& fileName);
+    /**
+     * @brief remove the symbols of the files not in the set
+     */
+    void retainFiles(const QSet<QString>& fileNames);
+    void clear();
+    int count();
+    /**
+     * @brief fuzzy search: the chars of the pattern must appear in the symbol's name in order.
+     * If the pattern contains "::", it's matched against the full name.
+     * @return at most maxCount results, best match first
+     */
+    QList<SymbolSearchResult> search(const QString& pattern, int maxCount);
+
+    /**
+     * @brief load saved symbols. Symbols of the files modified since saved are discarded.
+     */
+    bool load(const QString& fileName);
+    bool save(const QString& fileName);
+    bool modified();
+private:
+    struct FileSymbols {
+        qint64 lastModified; // of the file on disk when it's parsed
+        QVector<SymbolIndexEntry> symbols;
+        QVector<QString> lowerNames; // same order as symbols, for case insensitive matching
+        QVector<QString> lowerFullNames;
+    };
+    static void fillLowerNames(FileSymbols& fileSymbols);
+    static int matchScore(const QString& pattern, const QString& lowerPattern,
+                          const QString& text, const QString& lowerText);
+private:
+    QHash<QString,FileSymbols> mFiles;
+    bool mModified;
+    int mChangeCount; // to know if it's changed while saving
+    QReadWriteLock mLock;
+};
+
+using PSymbolIndex = std::shared_ptr<SymbolIndex>;
+
+#endif // SYMBOLINDEX_H
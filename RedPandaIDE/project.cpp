@@ -27,6 +27,7 @@
 #include "systemconsts.h"
 #include "iconsmanager.h"
 
+#include <QCryptographicHash>
 #include <QDir>
 #include <QFileDialog>
 #include <QFileInfo>
@@ -48,6 +49,16 @@ Project::Project(const QString &filename, const QString &name, QObject *parent)
                     &EditorList::getContentFromOpenedEditor,pMainWindow->editorList(),
                     std::placeholders::_1, std::placeholders::_2));
     resetCppParser(mParser);
+    // symbols saved in the last session can be searched before the project is parsed
+    mSymbolIndex = std::make_shared<SymbolIndex>();
+    mSymbolIndex->load(symbolIndexFilename());
+    mParser->setSymbolIndex(mSymbolIndex);
+    // save the symbols after each scan of the project, not only when it's closed
+    connect(mParser.get(), &CppParser::onEndParsing,
+            this, [this](int total, int) {
+        if (total > 1)
+            saveSymbolIndex();
+    });
     if (name == DEV_INTERNAL_OPEN) {
         open();
         mModified = false;
@@ -71,6 +82,23 @@ Project::~Project()
         }
     }
     pMainWindow->editorList()->endUpdate();
+    saveSymbolIndex();
+}
+
+void Project::saveSymbolIndex()
+{
+    if (mSymbolIndex->modified()) {
+        QDir().mkpath(extractFileDir(symbolIndexFilename()));
+        mSymbolIndex->save(symbolIndexFilename());
+    }
+}
+
+QString Project::symbolIndexFilename() const
+{
+    // kept in the config dir, so nothing is written into the project's folder
+    QByteArray hash = QCryptographicHash::hash(mFilename.toUtf8(),QCryptographicHash::Md5).toHex();
+    return includeTrailingPathDelimiter(pSettings->dirs().config())
+            + DEV_SYMBOLINDEX_DIR + "/" + QString::fromLatin1(hash) + ".symbols";
 }
 
 QString Project::directory() const
@@ -1487,6 +1515,11 @@ PCppParser Project::cppParser()
     return mParser;
 }
 
+const PSymbolIndex &Project::symbolIndex() const
+{
+    return mSymbolIndex;
+}
+
 void Project::sortUnitsByPriority()
 {
     mModel.beginUpdate();
@@ -25,6 +25,8 @@
 class Project;
 class Editor;
 class CppParser;
+class SymbolIndex;
+using PSymbolIndex = std::shared_ptr<SymbolIndex>;
 
 struct FolderNode;
 using PFolderNode = std::shared_ptr<FolderNode>;
@@ -184,6 +186,7 @@ public:
     //void saveToLog();
 
     std::shared_ptr<CppParser> cppParser();
+    const PSymbolIndex &symbolIndex() const;
     const QString &filename() const;
 
     const QString &name() const;
@@ -206,6 +209,8 @@ private:
     void removeFolderRecurse(PFolderNode node);
     void updateFolderNode(PFolderNode node);
     void updateCompilerSetType();
+    QString symbolIndexFilename() const;
+    void saveSymbolIndex();
 
 private:
     QList<PProjectUnit> mUnits;
@@ -215,6 +220,7 @@ private:
     bool mModified;
     QStringList mFolders;
     std::shared_ptr<CppParser> mParser;
+    PSymbolIndex mSymbolIndex;
     QList<PFolderNode> mFolderNodes;
     PFolderNode mNode;
     ProjectModel mModel;
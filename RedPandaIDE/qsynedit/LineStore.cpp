@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "LineStore.h"
+#include <algorithm>
+#include "../utils.h"
+
+#define LINE_BLOCK_MAX_LINES 1024
+#define LINE_BLOCK_MIN_LINES (LINE_BLOCK_MAX_LINES/2)
+
+static void ListIndexOutOfBounds(int index) {
+    throw IndexOutOfRange(index);
+}
+
+static uint rangeStateHash(const SynRangeState& range)
+{
+    uint hash = qHash(range.indents);
+    hash = hash * 31 + qHash(range.matchingIndents);
+    hash = hash * 31 + range.state;
+    hash = hash * 31 + range.braceLevel;
+    hash = hash * 31 + range.bracketLevel;
+    hash = hash * 31 + range.parenthesisLevel;
+    hash = hash * 31 + range.leftBraces;
+    hash = hash * 31 + range.rightBraces;
+    hash = hash * 31 + range.firstIndentThisLine;
+    return hash;
+}
+
+// SynRangeState::operator== only compares what the highlighter needs to continue
+static bool isSameRangeState(const SynRangeState& r1, const SynRangeState& r2)
+{
+    return r1.state == r2.state
+            && r1.braceLevel == r2.braceLevel
+            && r1.bracketLevel == r2.bracketLevel
+            && r1.parenthesisLevel == r2.parenthesisLevel
+            && r1.leftBraces == r2.leftBraces
+            && r1.rightBraces == r2.rightBraces
+            && r1.firstIndentThisLine == r2.firstIndentThisLine
+            && r1.indents == r2.indents
+            && r1.matchingIndents == r2.matchingIndents;
+}
+
+SynEditLineStore::SynEditLineStore():
+    mCount(0),
+    mLastBlock(0)
+{
+    clear();
+}
+
+int SynEditLineStore::count() const
+{
+    return mCount;
+}
+
+const QString &SynEditLineStore::string(int index) const
+{
+    int offset;
+    int b = findBlock(index,offset);
+    return mBlocks[b]->strings[offset];
+}
+
+void SynEditLineStore::setString(int index, const QString &s)
+{
+    int offset;
+    int b = findBlock(index,offset);
+    mBlocks[b]->strings[offset] = s;
+}
+
+const SynRangeState &SynEditLineStore::range(int index) const
+{
+    int offset;
+    int b = findBlock(index,offset);
+    return mRangeStates[mBlocks[b]->rangeIds[offset]];
+}
+
+void SynEditLineStore::setRange(int index, const SynRangeState &range)
+{
+    int offset;
+    int b = findBlock(index,offset);
+    int id = internRange(range);
+    int oldId = mBlocks[b]->rangeIds[offset];
+    mBlocks[b]->rangeIds[offset] = id;
+    releaseRange(oldId);
+}
+
+int SynEditLineStore::columns(int index) const
+{
+    int offset;
+    int b = findBlock(index,offset);
+    return mBlocks[b]->columns[offset];
+}
+
+void SynEditLineStore::setColumns(int index, int columns)
+{
+    int offset;
+    int b = findBlock(index,offset);
+    mBlocks[b]->columns[offset] = columns;
+}
+
+void *SynEditLineStore::object(int index) const
+{
+    int offset;
+    int b = findBlock(index,offset);
+    return mBlocks[b]->objects[offset];
+}
+
+void SynEditLineStore::setObject(int index, void *object)
+{
+    int offset;
+    int b = findBlock(index,offset);
+    mBlocks[b]->objects[offset] = object;
+}
+
+void SynEditLineStore::insertLines(int index, int count)
+{
+    if (count<=0)
+        return;
+    int b;
+    int offset;
+    if (mBlocks.isEmpty()) {
+        mBlocks.append(std::make_shared<Block>());
+        b = 0;
+        offset = 0;
+    } else if (index == mCount) {
+        b = mBlocks.count()-1;
+        offset = mBlocks[b]->strings.count();
+    } else {
+        b = findBlock(index,offset);
+    }
+    Block& block = *mBlocks[b];
+    block.strings.insert(offset,count,QString());
+    block.rangeIds.insert(offset,count,0);
+    block.columns.insert(offset,count,-1);
+    block.objects.insert(offset,count,nullptr);
+    mCount += count;
+    splitBlock(b);
+}
+
+void SynEditLineStore::insertStrings(int index, const QStringList &strings)
+{
+    insertLines(index,strings.count());
+    for (int i=0;i<strings.count();i++) {
+        setString(index+i,strings[i]);
+    }
+}
+
+void SynEditLineStore::remove(int index, int count)
+{
+    if (count<=0)
+        return;
+    int offset;
+    int b = findBlock(index,offset);
+    int firstBlock = b;
+    while (count>0 && b<mBlocks.count()) {
+        Block& block = *mBlocks[b];
+        int n = std::min(count, block.strings.count()-offset);
+        for (int i=offset;i<offset+n;i++)
+            releaseRange(block.rangeIds[i]);
+        block.strings.remove(offset,n);
+        block.rangeIds.remove(offset,n);
+        block.columns.remove(offset,n);
+        block.objects.remove(offset,n);
+        mCount -= n;
+        count -= n;
+        if (block.strings.isEmpty())
+            mBlocks.remove(b);
+        else
+            b++;
+        offset = 0;
+    }
+    // both the blocks before and after the removed lines may be too small now
+    if (firstBlock+1 < mBlocks.count())
+        mergeBlock(firstBlock+1);
+    mergeBlock(firstBlock);
+}
+
+void SynEditLineStore::exchange(int index1, int index2)
+{
+    int offset1,offset2;
+    Block& block1 = *mBlocks[findBlock(index1,offset1)];
+    Block& block2 = *mBlocks[findBlock(index2,offset2)];
+    std::swap(block1.strings[offset1],block2.strings[offset2]);
+    std::swap(block1.rangeIds[offset1],block2.rangeIds[offset2]);
+    std::swap(block1.columns[offset1],block2.columns[offset2]);
+    std::swap(block1.objects[offset1],block2.objects[offset2]);
+}
+
+void SynEditLineStore::clear()
+{
+    mBlocks.clear();
+    mStarts.clear();
+    mCount = 0;
+    mLastBlock = 0;
+    mRangeStates.clear();
+    mRangeRefCounts.clear();
+    mFreeRangeIds.clear();
+    mRangeIdsByHash.clear();
+    SynRangeState initialRange{};
+    mRangeStates.append(initialRange);
+    mRangeRefCounts.append(0);
+    mRangeIdsByHash.insert(rangeStateHash(initialRange),0);
+}
+
+void SynEditLineStore::resetColumns()
+{
+    foreach (const PBlock& block, mBlocks) {
+        block->columns.fill(-1);
+    }
+}
+
+int SynEditLineStore::findBlock(int index, int &offset) const
+{
+    if (index<0 || index>=mCount)
+        ListIndexOutOfBounds(index);
+    if (mLastBlock >= mBlocks.count()
+            || index < mStarts[mLastBlock]
+            || index >= mStarts[mLastBlock]+mBlocks[mLastBlock]->strings.count()) {
+        // the last block starting before or at the index
+        mLastBlock = std::upper_bound(mStarts.begin(),mStarts.end(),index) - mStarts.begin() - 1;
+    }
+    offset = index - mStarts[mLastBlock];
+    return mLastBlock;
+}
+
+void SynEditLineStore::splitBlock(int blockIndex)
+{
+    PBlock block = mBlocks[blockIndex];
+    int count = block->strings.count();
+    if (count > LINE_BLOCK_MAX_LINES) {
+        // spread the lines evenly, so each piece has LINE_BLOCK_MIN_LINES to LINE_BLOCK_MAX_LINES lines
+        int pieces = count / LINE_BLOCK_MIN_LINES;
+        mBlocks.remove(blockIndex);
+        int b = blockIndex;
+        for (int i=0;i<pieces;i++) {
+            int start = (qint64)count * i / pieces;
+            int n = (qint64)count * (i+1) / pieces - start;
+            PBlock newBlock = std::make_shared<Block>();
+            newBlock->strings = block->strings.mid(start,n);
+            newBlock->rangeIds = block->rangeIds.mid(start,n);
+            newBlock->columns = block->columns.mid(start,n);
+            newBlock->objects = block->objects.mid(start,n);
+            mBlocks.insert(b,newBlock);
+            b++;
+        }
+    }
+    updateStarts(blockIndex);
+}
+
+void SynEditLineStore::mergeBlock(int blockIndex)
+{
+    // join a small block with its next (or previous) one. If they are too big together,
+    // even them out instead, so both have at least LINE_BLOCK_MIN_LINES lines.
+    if (blockIndex < mBlocks.count() && mBlocks.count() > 1
+            && mBlocks[blockIndex]->strings.count() < LINE_BLOCK_MIN_LINES) {
+        int first = (blockIndex+1 < mBlocks.count()) ? blockIndex : blockIndex-1;
+        Block& block = *mBlocks[first];
+        Block& next = *mBlocks[first+1];
+        block.strings.append(next.strings);
+        block.rangeIds.append(next.rangeIds);
+        block.columns.append(next.columns);
+        block.objects.append(next.objects);
+        int total = block.strings.count();
+        if (total <= LINE_BLOCK_MAX_LINES) {
+            mBlocks.remove(first+1);
+        } else {
+            int n = total / 2;
+            next.strings = block.strings.mid(n);
+            next.rangeIds = block.rangeIds.mid(n);
+            next.columns = block.columns.mid(n);
+            next.objects = block.objects.mid(n);
+            block.strings.resize(n);
+            block.rangeIds.resize(n);
+            block.columns.resize(n);
+            block.objects.resize(n);
+        }
+    }
+    updateStarts(blockIndex-1);
+}
+
+void SynEditLineStore::updateStarts(int fromBlock)
+{
+    fromBlock = std::max(0,fromBlock);
+    mStarts.resize(mBlocks.count());
+    int start = 0;
+    if (fromBlock>0 && fromBlock<=mBlocks.count())
+        start = mStarts[fromBlock-1] + mBlocks[fromBlock-1]->strings.count();
+    for (int i=fromBlock;i<mBlocks.count();i++) {
+        mStarts[i] = start;
+        start += mBlocks[i]->strings.count();
+    }
+}
+
+int SynEditLineStore::internRange(const SynRangeState &range)
+{
+    uint hash = rangeStateHash(range);
+    int id = -1;
+    for (auto it=mRangeIdsByHash.constFind(hash);
+         it!=mRangeIdsByHash.constEnd() && it.key()==hash; ++it) {
+        if (isSameRangeState(mRangeStates[it.value()],range)) {
+            id = it.value();
+            break;
+        }
+    }
+    if (id<0) {
+        if (mFreeRangeIds.isEmpty()) {
+            id = mRangeStates.count();
+            mRangeStates.append(range);
+            mRangeRefCounts.append(0);
+        } else {
+            id = mFreeRangeIds.takeLast();
+            mRangeStates[id] = range;
+        }
+        mRangeIdsByHash.insert(hash,id);
+    }
+    mRangeRefCounts[id]++;
+    return id;
+}
+
+void SynEditLineStore::releaseRange(int id)
+{
+    // the initial state is never freed
+    if (id == 0)
+        return;
+    mRangeRefCounts[id]--;
+    if (mRangeRefCounts[id] == 0) {
+        mRangeIdsByHash.remove(rangeStateHash(mRangeStates[id]),id);
+        mRangeStates[id] = SynRangeState{};
+        mFreeRangeIds.append(id);
+    }
+}
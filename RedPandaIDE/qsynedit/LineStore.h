@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LINESTORE_H
+#define LINESTORE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMultiHash>
+#include <memory>
+#include "highlighter/base.h"
+
+/**
+ * @brief Lines of the text, kept in blocks of at most a thousand lines.
+ *
+ * Inserting or deleting lines only moves the lines in one block, instead of all
+ * the lines after them. The strings, range states and columns of a block are stored in
+ * separated arrays, so no object is allocated per line.
+ * Range states are interned: lines in the same state share one copy of it,
+ * and each line only keeps the id of its state.
+ */
+class SynEditLineStore {
+public:
+    explicit SynEditLineStore();
+    int count() const;
+    const QString& string(int index) const;
+    void setString(int index, const QString& s);
+    const SynRangeState& range(int index) const;
+    void setRange(int index, const SynRangeState& range);
+    int columns(int index) const;
+    void setColumns(int index, int columns);
+    void* object(int index) const;
+    void setObject(int index, void* object);
+
+    /**
+     * @brief insert count empty lines before the index
+     */
+    void insertLines(int index, int count);
+    void insertStrings(int index, const QStringList& strings);
+    void remove(int index, int count);
+    void exchange(int index1, int index2);
+    void clear();
+    void resetColumns();
+private:
+    struct Block {
+        QVector<QString> strings;
+        QVector<int> rangeIds;
+        QVector<int> columns; // -1 if not calculated yet
+        QVector<void*> objects;
+    };
+    using PBlock = std::shared_ptr<Block>;
+    int findBlock(int index, int& offset) const;
+    void splitBlock(int blockIndex);
+    void mergeBlock(int blockIndex);
+    void updateStarts(int fromBlock);
+    int internRange(const SynRangeState& range);
+    void releaseRange(int id);
+private:
+    QVector<PBlock> mBlocks;
+    QVector<int> mStarts; // index of the first line of each block
+    int mCount;
+    mutable int mLastBlock; // lines are mostly accessed in order
+    QVector<SynRangeState> mRangeStates; // indexed by id, id 0 is the initial state
+    QVector<int> mRangeRefCounts;
+    QVector<int> mFreeRangeIds;
+    QMultiHash<uint,int> mRangeIdsByHash;
+};
+
+#endif // LINESTORE_H
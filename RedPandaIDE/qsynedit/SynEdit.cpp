@@ -38,6 +38,12 @@
 #include <QDrag>
 #include <QMimeData>
 #include <QDesktopWidget>
+#include <QElapsedTimer>
+
+// inserting more lines than this (e.g. loading a file) highlights them in background
+#define SCAN_RANGES_IN_BACKGROUND_LINES 5000
+#define SCAN_RANGES_CHUNK_LINES 500
+#define SCAN_RANGES_TIME_SLICE 20 // ms
 
 SynEdit::SynEdit(QWidget *parent) : QAbstractScrollArea(parent)
 {
@@ -143,12 +149,20 @@ SynEdit::SynEdit(QWidget *parent) : QAbstractScrollArea(parent)
     //mScrollTimer->setInterval(100);
     connect(mScrollTimer, &QTimer::timeout,this, &SynEdit::onScrollTimeout);
 
+    mScannedLineCount = 0;
+    mScanRangesTimer = new QTimer(this);
+    mScanRangesTimer->setSingleShot(true);
+    mScanRangesTimer->setInterval(0);
+    connect(mScanRangesTimer, &QTimer::timeout,this, &SynEdit::onScanRangesTimeout);
+
     mScrollHintColor = Qt::yellow;
     mScrollHintFormat = SynScrollHintFormat::shfTopLineOnly;
 
     mContentImage = std::make_shared<QImage>(clientWidth(),clientHeight(),QImage::Format_ARGB32);
 
     mUseCodeFolding = true;
+    mFoldDirtyFrom = -1;
+    mFoldDirtyTo = -1;
     m_blinkTimerId = 0;
     m_blinkStatus = 0;
 
@@ -380,6 +394,8 @@ bool SynEdit::getHighlighterAttriAtRowCol(const BufferCoord &XY, QString &Token,
         if (PosY == 0) {
             mHighlighter->resetState();
         } else {
+            // the line may be after the lines scanned in the background
+            ensureLinesScanned(PosY);
             mHighlighter->setState(mLines->ranges(PosY-1));
         }
         mHighlighter->setLine(Line, PosY);
@@ -418,6 +434,8 @@ bool SynEdit::getHighlighterAttriAtRowColEx(const BufferCoord &XY, QString &Toke
         if (PosY == 0) {
             mHighlighter->resetState();
         } else {
+            // the line may be after the lines scanned in the background
+            ensureLinesScanned(PosY);
             mHighlighter->setState(mLines->ranges(PosY-1));
         }
         mHighlighter->setLine(Line, PosY);
@@ -3239,6 +3257,9 @@ int SynEdit::scanFrom(int Index, int canStopIndex)
     int Result = std::max(0,Index);
     if (Result >= mLines->count())
         return Result;
+    // not scanned yet, the background scan will do it
+    if (Result >= mScannedLineCount)
+        return Result;
 
     if (Result == 0) {
         mHighlighter->resetState();
@@ -3249,23 +3270,30 @@ int SynEdit::scanFrom(int Index, int canStopIndex)
         mHighlighter->setLine(mLines->getString(Result), Result);
         mHighlighter->nextToEol();
         iRange = mHighlighter->getRangeState();
+        SynRangeState oldRange = mLines->ranges(Result);
         if (Result > canStopIndex){
-            if (mLines->ranges(Result).state == iRange.state
-                    && mLines->ranges(Result).braceLevel == iRange.braceLevel
-                    && mLines->ranges(Result).parenthesisLevel == iRange.parenthesisLevel
-                    && mLines->ranges(Result).bracketLevel == iRange.bracketLevel
+            if (oldRange.state == iRange.state
+                    && oldRange.braceLevel == iRange.braceLevel
+                    && oldRange.parenthesisLevel == iRange.parenthesisLevel
+                    && oldRange.bracketLevel == iRange.bracketLevel
                     ) {
                 if (mUseCodeFolding)
-                    rescanFolds();
+                    updateFoldRanges();
                 return Result;// avoid the final Decrement
             }
         }
+        if (mUseCodeFolding) {
+            // folds only depend on the unpaired braces of each line
+            if (oldRange.leftBraces != iRange.leftBraces
+                    || oldRange.rightBraces != iRange.rightBraces)
+                markFoldsDirty(Result,Result);
+        }
         mLines->setRange(Result,iRange);
         Result ++ ;
-    } while (Result < mLines->count());
+    } while (Result < mScannedLineCount);
     Result--;
     if (mUseCodeFolding)
-        rescanFolds();
+        updateFoldRanges();
     return Result;
 }
 
@@ -3286,21 +3314,87 @@ void SynEdit::rescanRange(int line)
     mHighlighter->setLine(mLines->getString(line), line);
     mHighlighter->nextToEol();
     SynRangeState iRange = mHighlighter->getRangeState();
+    if (mUseCodeFolding) {
+        SynRangeState oldRange = mLines->ranges(line);
+        if (oldRange.leftBraces != iRange.leftBraces
+                || oldRange.rightBraces != iRange.rightBraces)
+            markFoldsDirty(line,line);
+    }
     mLines->setRange(line,iRange);
 }
 
 void SynEdit::rescanRanges()
 {
     if (mHighlighter && !mLines->empty()) {
+        // folds follow the changed braces as the lines are scanned
+        scanRangesInBackground(0);
+    } else if (mUseCodeFolding)
+        rescanFolds();
+}
+
+void SynEdit::scanLines(int toIndex)
+{
+    toIndex = std::min(toIndex, mLines->count()-1);
+    if (!mHighlighter || toIndex < mScannedLineCount)
+        return;
+    int line = mScannedLineCount;
+    if (line == 0) {
         mHighlighter->resetState();
-        for (int i =0;i<mLines->count();i++) {
-            mHighlighter->setLine(mLines->getString(i), i);
-            mHighlighter->nextToEol();
-            mLines->setRange(i, mHighlighter->getRangeState());
+    } else {
+        mHighlighter->setState(mLines->ranges(line-1));
+    }
+    for (;line<=toIndex;line++) {
+        mHighlighter->setLine(mLines->getString(line), line);
+        mHighlighter->nextToEol();
+        SynRangeState iRange = mHighlighter->getRangeState();
+        if (mUseCodeFolding) {
+            SynRangeState oldRange = mLines->ranges(line);
+            if (oldRange.leftBraces != iRange.leftBraces
+                    || oldRange.rightBraces != iRange.rightBraces)
+                markFoldsDirty(line,line);
         }
+        mLines->setRange(line,iRange);
     }
+    mScannedLineCount = toIndex + 1;
+}
+
+void SynEdit::ensureLinesScanned(int line)
+{
+    if (line <= mScannedLineCount)
+        return;
+    scanLines(line - 1);
     if (mUseCodeFolding)
-        rescanFolds();
+        updateFoldRanges();
+}
+
+/*
+ * Only the lines before the last visible one are scanned now, the rest are scanned
+ * by chunks when the event loop is idle. ensureLinesScanned() continues from the
+ * last scanned line when lines after it are needed, e.g. scrolled to.
+ */
+void SynEdit::scanRangesInBackground(int fromIndex)
+{
+    mScannedLineCount = std::min(mScannedLineCount, std::max(fromIndex,0));
+    ensureLinesScanned(rowToLine(mTopLine + mLinesInWindow));
+    if (mScannedLineCount < mLines->count())
+        mScanRangesTimer->start();
+}
+
+void SynEdit::onScanRangesTimeout()
+{
+    if (!mHighlighter)
+        return;
+    QElapsedTimer timer;
+    timer.start();
+    while (mScannedLineCount < mLines->count()
+           && timer.elapsed() < SCAN_RANGES_TIME_SLICE) {
+        scanLines(mScannedLineCount + SCAN_RANGES_CHUNK_LINES - 1);
+    }
+    if (mScannedLineCount < mLines->count()) {
+        mScanRangesTimer->start();
+    } else if (mUseCodeFolding) {
+        updateFoldRanges();
+    }
 }
 
 void SynEdit::uncollapse(PSynEditFoldRange FoldRange)
@@ -3335,14 +3429,19 @@ void SynEdit::collapse(PSynEditFoldRange FoldRange)
 
 void SynEdit::foldOnListInserted(int Line, int Count)
 {
-    // Delete collapsed inside selection
+    // Inserted lines with braces are marked dirty by scanFrom(),
+    // so we only need to keep the other folds at their lines
     for (int i = mAllFoldRanges.count()-1;i>=0;i--) {
         PSynEditFoldRange range = mAllFoldRanges[i];
-        if (range->collapsed || range->parentCollapsed()){
-            if (range->fromLine == Line - 1) // insertion starts at fold line
-                uncollapse(range);
-            else if (range->fromLine >= Line) // insertion of count lines above FromLine
-                range->move(Count);
+        if ((range->collapsed || range->parentCollapsed())
+                && range->fromLine == Line - 1) // insertion starts at fold line
+            uncollapse(range);
+        if (range->fromLine >= Line) // insertion of count lines above FromLine
+            range->move(Count);
+        else if (range->toLine >= Line) { // insertion inside the fold
+            range->toLine += Count;
+            if (range->collapsed)
+                range->linesCollapsed = range->toLine - range->fromLine;
         }
     }
 }
@@ -3353,12 +3452,25 @@ void SynEdit::foldOnListDeleted(int Line, int Count)
     for (int i = mAllFoldRanges.count()-1;i>=0;i--) {
         PSynEditFoldRange range = mAllFoldRanges[i];
         if (range->collapsed || range->parentCollapsed()){
-            if (range->fromLine == Line && Count == 1)  // open up because we are messing with the starting line
+            if (range->fromLine == Line && Count == 1) { // open up because we are messing with the starting line
                 uncollapse(range);
-            else if (range->fromLine >= Line - 1 && range->fromLine < Line + Count) // delete inside affectec area
+                markFoldsDirty(Line - 1, Line - 1);
+            } else if (range->fromLine >= Line - 1 && range->fromLine < Line + Count) // delete inside affectec area
                 mAllFoldRanges.remove(i);
             else if (range->fromLine >= Line + Count) // Move after affected area
                 range->move(-Count);
+        } else if (range->fromLine >= Line && range->fromLine < Line + Count) {
+            // the opening brace is deleted, rescan the lines it contained
+            mAllFoldRanges.remove(i);
+            markFoldsDirty(Line - 1, std::max(Line, range->toLine - Count) - 1);
+        } else if (range->fromLine >= Line + Count) {
+            range->move(-Count);
+        } else if (range->toLine >= Line && range->toLine < Line + Count) {
+            // the closing brace is deleted
+            range->toLine = range->fromLine;
+            markFoldsDirty(Line - 1, Line - 1);
+        } else if (range->toLine >= Line + Count) {
+            range->toLine -= Count;
         }
     }
 
@@ -3367,16 +3479,177 @@ void SynEdit::foldOnListDeleted(int Line, int Count)
 void SynEdit::foldOnListCleared()
 {
     mAllFoldRanges.clear();
+    mFoldDirtyFrom = -1;
+    mFoldDirtyTo = -1;
 }
 
 void SynEdit::rescanFolds()
 {
     if (!mUseCodeFolding)
         return;
+    mFoldDirtyFrom = -1;
+    mFoldDirtyTo = -1;
     rescanForFoldRanges();
     invalidateGutter();
 }
 
+void SynEdit::markFoldsDirty(int fromIndex, int toIndex)
+{
+    fromIndex = std::max(fromIndex,0);
+    toIndex = std::max(toIndex,fromIndex);
+    if (mFoldDirtyFrom < 0) {
+        mFoldDirtyFrom = fromIndex;
+        mFoldDirtyTo = toIndex;
+    } else {
+        mFoldDirtyFrom = std::min(mFoldDirtyFrom, fromIndex);
+        mFoldDirtyTo = std::max(mFoldDirtyTo, toIndex);
+    }
+}
+
+// the last line of the fold, or INT_MAX if its closing brace is missing
+static int foldLastLine(PSynEditFoldRange range)
+{
+    if (range->toLine > range->fromLine)
+        return range->toLine;
+    return INT_MAX;
+}
+
+/*
+ * Braces in the unchanged lines pair up the same as before, so only the lines between
+ * the innermost fold around the first dirty line, and the first line after the last
+ * dirty line where both the old and the new folds are all closed, are rescanned.
+ * Typing without changing any brace doesn't rescan at all.
+ */
+void SynEdit::updateFoldRanges()
+{
+    if (!mUseCodeFolding || mFoldDirtyFrom < 0)
+        return;
+    int firstLine = mFoldDirtyFrom + 1;
+    int lastIndex = mFoldDirtyTo;
+    mFoldDirtyFrom = -1;
+    mFoldDirtyTo = -1;
+    if (!mHighlighter)
+        return;
+    if (mCodeFolding.foldRegions.count()!=1
+            || mCodeFolding.foldRegions.get(0)->openSymbol != "{"
+            || mCodeFolding.foldRegions.get(0)->closeSymbol != "}") {
+        rescanFolds();
+        return;
+    }
+    PSynEditFoldRegion foldRegion = mCodeFolding.foldRegions.get(0);
+
+    // folds are sorted by fromLine, so the last one around the line is the innermost
+    PSynEditFoldRange innerFold;
+    int oldIndex = 0;
+    int startIndex = 0;
+    while (oldIndex < mAllFoldRanges.count()) {
+        PSynEditFoldRange range = mAllFoldRanges[oldIndex];
+        if (range->fromLine > firstLine)
+            break;
+        if (foldLastLine(range) >= firstLine) {
+            innerFold = range;
+            startIndex = oldIndex;
+        }
+        oldIndex++;
+    }
+    int startLine = firstLine;
+    PSynEditFoldRange startParent;
+    if (innerFold) {
+        // rescan the fold itself, its parent must start above it to be kept
+        while (innerFold->parent && innerFold->parent->fromLine == innerFold->fromLine)
+            innerFold = innerFold->parent;
+        startLine = innerFold->fromLine;
+        startParent = innerFold->parent;
+        while (startIndex>0 && mAllFoldRanges[startIndex-1]->fromLine >= startLine)
+            startIndex--;
+        oldIndex = startIndex;
+    }
+
+    PSynEditFoldRanges newFoldRanges = std::make_shared<SynEditFoldRanges>();
+    PSynEditFoldRange parent = startParent;
+    PSynEditFoldRanges parentFoldRanges = startParent ? startParent->subFoldRanges : newFoldRanges;
+    // the rescanned folds are added to the parent again
+    SynEditFoldRanges oldSiblings;
+    if (startParent) {
+        for (int i=0;i<startParent->subFoldRanges->count();i++)
+            oldSiblings.add(startParent->subFoldRanges->range(i));
+        startParent->subFoldRanges->clear();
+        for (int i=0;i<oldSiblings.count() && oldSiblings[i]->fromLine < startLine;i++)
+            startParent->subFoldRanges->add(oldSiblings[i]);
+    }
+    int oldLastLine = 0; // last line of the old folds started before the current line
+    int line = startLine - 1;
+    while (line < mLines->count()) {
+        PSynEditFoldRange collapsedFold;
+        while (oldIndex < mAllFoldRanges.count() && mAllFoldRanges[oldIndex]->fromLine <= line + 1) {
+            PSynEditFoldRange range = mAllFoldRanges[oldIndex];
+            oldLastLine = std::max(oldLastLine, foldLastLine(range));
+            if (range->fromLine == line + 1 && range->collapsed
+                    && range->toLine > range->fromLine && !collapsedFold)
+                collapsedFold = range;
+            oldIndex++;
+        }
+        if (collapsedFold) {
+            // keep the collapsed fold (and its sub folds), but attach it to the rescanned parent.
+            // Braces on its first and last lines other than its own pair are still counted.
+            SynRangeState range = mLines->ranges(line);
+            foldBraces(line, range.rightBraces, std::max(range.leftBraces-1,0),
+                       newFoldRanges, foldRegion, parent, parentFoldRanges);
+            collapsedFold->parent = parent;
+            if (parent)
+                parent->subFoldRanges->add(collapsedFold);
+            line = collapsedFold->toLine - 1;
+            range = mLines->ranges(line);
+            foldBraces(line, std::max(range.rightBraces-1,0), range.leftBraces,
+                       newFoldRanges, foldRegion, parent, parentFoldRanges);
+        } else {
+            foldBraceLine(line, newFoldRanges, foldRegion, parent, parentFoldRanges);
+        }
+        line++;
+        if (startParent) {
+            // a fold started above the rescanned lines is closed, its pairing is changed
+            PSynEditFoldRange p = parent;
+            while (p && p != startParent)
+                p = p->parent;
+            if (!p) {
+                rescanFolds();
+                return;
+            }
+        }
+        if (line > lastIndex && parent == startParent && oldLastLine <= line)
+            break;
+    }
+    int stopLine = line;
+    if (startParent) {
+        for (int i=0;i<oldSiblings.count();i++) {
+            if (oldSiblings[i]->fromLine > stopLine)
+                startParent->subFoldRanges->add(oldSiblings[i]);
+        }
+    }
+
+    SynEditFoldRanges foldRanges;
+    int j = 0;
+    for (int i = 0; i < mAllFoldRanges.count(); i++) {
+        PSynEditFoldRange range = mAllFoldRanges[i];
+        if (range->fromLine >= startLine && range->fromLine <= stopLine
+                && !range->collapsed && !range->parentCollapsed())
+            continue;
+        while (j < newFoldRanges->count() && newFoldRanges->range(j)->fromLine < range->fromLine) {
+            foldRanges.add(newFoldRanges->range(j));
+            j++;
+        }
+        foldRanges.add(range);
+    }
+    while (j < newFoldRanges->count()) {
+        foldRanges.add(newFoldRanges->range(j));
+        j++;
+    }
+    mAllFoldRanges = foldRanges;
+    // the folds hold a pointer to the list, don't let them keep each other alive
+    newFoldRanges->clear();
+    invalidateGutterLines(startLine, stopLine);
+}
+
 static void null_deleter(SynEditFoldRanges *) {}
 
 void SynEdit::rescanForFoldRanges()
@@ -3475,34 +3748,8 @@ void SynEdit::findSubFoldRange(PSynEditFoldRanges TopFoldRanges, int FoldIndex,P
 
         //we just use braceLevel
         if (useBraces) {
-            // Find an opening character on this line
-            CurLine = mLines->getString(Line);
-            if (mLines->rightBraces(Line)>0) {
-                for (int i=0; i<mLines->rightBraces(Line);i++) {
-                    // Stop the recursion if we find a closing char, and return to our parent
-                    if (Parent) {
-                      Parent->toLine = Line + 1;
-                      Parent = Parent->parent;
-                      if (!Parent) {
-                          parentFoldRanges = TopFoldRanges;
-                      } else {
-                          parentFoldRanges = Parent->subFoldRanges;
-                      }
-                    }
-                }
-            }
-            if (mLines->leftBraces(Line)>0) {
-                for (int i=0; i<mLines->leftBraces(Line);i++) {
-                    // Add it to the top list of folds
-                    Parent = parentFoldRanges->addByParts(
-                      Parent,
-                      TopFoldRanges,
-                      Line + 1,
-                      mCodeFolding.foldRegions.get(FoldIndex),
-                      Line + 1);
-                    parentFoldRanges = Parent->subFoldRanges;
-                }
-            }
+            foldBraceLine(Line, TopFoldRanges, mCodeFolding.foldRegions.get(FoldIndex),
+                          Parent, parentFoldRanges);
         } else {
 
             // Find an opening character on this line
@@ -3561,6 +3808,42 @@ void SynEdit::findSubFoldRange(PSynEditFoldRanges TopFoldRanges, int FoldIndex,P
     }
 }
 
+void SynEdit::foldBraceLine(int Line, PSynEditFoldRanges TopFoldRanges, PSynEditFoldRegion FoldRegion,
+                            PSynEditFoldRange &Parent, PSynEditFoldRanges &parentFoldRanges)
+{
+    SynRangeState range = mLines->ranges(Line);
+    foldBraces(Line, range.rightBraces, range.leftBraces,
+               TopFoldRanges, FoldRegion, Parent, parentFoldRanges);
+}
+
+void SynEdit::foldBraces(int Line, int rightBraces, int leftBraces,
+                         PSynEditFoldRanges TopFoldRanges, PSynEditFoldRegion FoldRegion,
+                         PSynEditFoldRange &Parent, PSynEditFoldRanges &parentFoldRanges)
+{
+    for (int i=0; i<rightBraces;i++) {
+        // Stop the recursion if we find a closing char, and return to our parent
+        if (Parent) {
+          Parent->toLine = Line + 1;
+          Parent = Parent->parent;
+          if (!Parent) {
+              parentFoldRanges = TopFoldRanges;
+          } else {
+              parentFoldRanges = Parent->subFoldRanges;
+          }
+        }
+    }
+    for (int i=0; i<leftBraces;i++) {
+        // Add it to the top list of folds
+        Parent = parentFoldRanges->addByParts(
+          Parent,
+          TopFoldRanges,
+          Line + 1,
+          FoldRegion,
+          Line + 1);
+        parentFoldRanges = Parent->subFoldRanges;
+    }
+}
+
 PSynEditFoldRange SynEdit::collapsedFoldStartAtLine(int Line)
 {
     for (int i = 0; i< mAllFoldRanges.count() - 1; i++ ) {
@@ -5868,6 +6151,7 @@ void SynEdit::paintEvent(QPaintEvent *event)
         // lines
         nL1 = minMax(mTopLine + rcClip.top() / mTextHeight, mTopLine, displayLineCount());
         nL2 = minMax(mTopLine + (rcClip.bottom() + mTextHeight - 1) / mTextHeight, 1, displayLineCount());
+        ensureLinesScanned(rowToLine(nL2));
 
         //qDebug()<<"Paint:"<<nL1<<nL2<<nC1<<nC2;
 
@@ -6375,6 +6659,7 @@ void SynEdit::onLinesChanging()
 
 void SynEdit::onLinesCleared()
 {
+    mScannedLineCount = 0;
     if (mUseCodeFolding)
         foldOnListCleared();
     clearUndo();
@@ -6391,6 +6676,8 @@ void SynEdit::onLinesCleared()
 
 void SynEdit::onLinesDeleted(int index, int count)
 {
+    if (index < mScannedLineCount)
+        mScannedLineCount -= std::min(count, mScannedLineCount - index);
     if (mUseCodeFolding)
         foldOnListDeleted(index + 1, count);
     if (mHighlighter && mLines->count() > 0)
@@ -6401,14 +6688,20 @@ void SynEdit::onLinesDeleted(int index, int count)
 
 void SynEdit::onLinesInserted(int index, int count)
 {
+    if (index <= mScannedLineCount)
+        mScannedLineCount += count;
     if (mUseCodeFolding)
         foldOnListInserted(index + 1, count);
     if (mHighlighter && mLines->count() > 0) {
+        if (count >= SCAN_RANGES_IN_BACKGROUND_LINES) {
+            scanRangesInBackground(index);
+        } else {
 //        int vLastScan = index;
 //        do {
           scanFrom(index, index+count);
 //            vLastScan++;
 //        } while (vLastScan < index + count) ;
+        }
     }
     invalidateLines(index + 1, INT_MAX);
     invalidateGutterLines(index + 1, INT_MAX);
@@ -198,6 +198,11 @@ public:
     int rowToLine(int aRow) const;
     int lineToRow(int aLine) const;
     int foldRowToLine(int Row) const;
+    /**
+     * @brief make sure the highlighting states of the lines before and at the line are ready.
+     * States of large documents are calculated in background.
+     */
+    void ensureLinesScanned(int line);
     int foldLineToRow(int Line) const;
     void setDefaultKeystrokes();
     void invalidateLine(int Line);
@@ -482,6 +487,8 @@ private:
     int scanFrom(int Index, int canStopIndex);
     void rescanRange(int line);
     void rescanRanges();
+    void scanLines(int toIndex);
+    void scanRangesInBackground(int fromIndex);
     void uncollapse(PSynEditFoldRange FoldRange);
     void collapse(PSynEditFoldRange FoldRange);
 
@@ -490,6 +497,13 @@ private:
     void foldOnListCleared();
     void rescanFolds(); // rescan for folds
     void rescanForFoldRanges();
+    void markFoldsDirty(int fromIndex, int toIndex);
+    void updateFoldRanges(); // only rescan the dirty lines for folds
+    void foldBraceLine(int Line, PSynEditFoldRanges TopFoldRanges, PSynEditFoldRegion FoldRegion,
+                       PSynEditFoldRange& Parent, PSynEditFoldRanges& parentFoldRanges);
+    void foldBraces(int Line, int rightBraces, int leftBraces,
+                    PSynEditFoldRanges TopFoldRanges, PSynEditFoldRegion FoldRegion,
+                    PSynEditFoldRange& Parent, PSynEditFoldRanges& parentFoldRanges);
     void scanForFoldRanges(PSynEditFoldRanges TopFoldRanges);
     int lineHasChar(int Line, int startChar, QChar character, const QString& highlighterAttrName);
     void findSubFoldRange(PSynEditFoldRanges TopFoldRanges,int FoldIndex,PSynEditFoldRanges& parentFoldRanges, PSynEditFoldRange Parent);
@@ -595,6 +609,7 @@ private slots:
     void onRedoAdded();
     void onScrollTimeout();
     void onDraggingScrollTimeout();
+    void onScanRangesTimeout();
     void onUndoAdded();
     void onSizeOrFontChanged(bool bFont);
     void onChanged();
@@ -605,6 +620,8 @@ private:
     SynEditFoldRanges mAllFoldRanges;
     SynEditCodeFolding mCodeFolding;
     bool mUseCodeFolding;
+    int mFoldDirtyFrom; // first line (0-based) whose braces changed since folds are updated, -1 if none
+    int mFoldDirtyTo;
     bool  mAlwaysShowCaret;
     BufferCoord mBlockBegin;
     BufferCoord mBlockEnd;
@@ -683,6 +700,8 @@ private:
     //  fFocusList: TList;
     //  fPlugins: TList;
     QTimer*  mScrollTimer;
+    QTimer*  mScanRangesTimer;
+    int mScannedLineCount; // highlighting states of lines after it are not calculated yet
     int mScrollDeltaX;
     int mScrollDeltaY;
 
@@ -20,7 +20,12 @@
 #include <QTextCodec>
 #include <QTextStream>
 #include <QMutexLocker>
+#include <QFutureInterface>
+#include <QtConcurrent>
 #include <stdexcept>
+#include <algorithm>
+#include <climits>
+#include <cstring>
 #include "SynEdit.h"
 #include "../utils.h"
 #include "../platform.h"
@@ -35,6 +40,7 @@ SynEditStringList::SynEditStringList(SynEdit *pEdit, QObject *parent):
     mFileEndingType = FileEndingType::Windows;
     mIndexOfLongestLine = -1;
     mUpdateCount = 0;
+    mLoadWatcher = nullptr;
 }
 
 static void ListIndexOutOfBounds(int index) {
@@ -46,8 +52,8 @@ static void ListIndexOutOfBounds(int index) {
 int SynEditStringList::parenthesisLevels(int Index)
 {
     QMutexLocker locker(&mMutex);
-    if (Index>=0 && Index < mList.size()) {
-        return mList[Index]->fRange.parenthesisLevel;
+    if (Index>=0 && Index < mList.count()) {
+        return mList.range(Index).parenthesisLevel;
     } else
         return 0;
 }
@@ -55,8 +61,8 @@ int SynEditStringList::parenthesisLevels(int Index)
 int SynEditStringList::bracketLevels(int Index)
 {
     QMutexLocker locker(&mMutex);
-    if (Index>=0 && Index < mList.size()) {
-        return mList[Index]->fRange.bracketLevel;
+    if (Index>=0 && Index < mList.count()) {
+        return mList.range(Index).bracketLevel;
     } else
         return 0;
 }
@@ -64,8 +70,8 @@ int SynEditStringList::bracketLevels(int Index)
 int SynEditStringList::braceLevels(int Index)
 {
     QMutexLocker locker(&mMutex);
-    if (Index>=0 && Index < mList.size()) {
-        return mList[Index]->fRange.braceLevel;
+    if (Index>=0 && Index < mList.count()) {
+        return mList.range(Index).braceLevel;
     } else
         return 0;
 }
@@ -84,11 +90,12 @@ int SynEditStringList::braceLevels(int Index)
 int SynEditStringList::lineColumns(int Index)
 {
     QMutexLocker locker(&mMutex);
-    if (Index>=0 && Index < mList.size()) {
-        if (mList[Index]->fColumns == -1) {
+    if (Index>=0 && Index < mList.count()) {
+        int columns = mList.columns(Index);
+        if (columns == -1) {
             return calculateLineColumns(Index);
         } else
-            return mList[Index]->fColumns;
+            return columns;
     } else
         return 0;
 }
@@ -96,8 +103,8 @@ int SynEditStringList::lineColumns(int Index)
 int SynEditStringList::leftBraces(int Index)
 {
     QMutexLocker locker(&mMutex);
-    if (Index>=0 && Index < mList.size()) {
-        return mList[Index]->fRange.leftBraces;
+    if (Index>=0 && Index < mList.count()) {
+        return mList.range(Index).leftBraces;
     } else
         return 0;
 }
@@ -105,8 +112,8 @@ int SynEditStringList::leftBraces(int Index)
 int SynEditStringList::rightBraces(int Index)
 {
     QMutexLocker locker(&mMutex);
-    if (Index>=0 && Index < mList.size()) {
-        return mList[Index]->fRange.rightBraces;
+    if (Index>=0 && Index < mList.count()) {
+        return mList.range(Index).rightBraces;
     } else
         return 0;
 }
@@ -117,7 +124,7 @@ int SynEditStringList::lengthOfLongestLine() {
         int MaxLen = -1;
         mIndexOfLongestLine = -1;
         if (mList.count() > 0 ) {
-            for (int i=0;i<mList.size();i++) {
+            for (int i=0;i<mList.count();i++) {
                 int len = lineColumns(i);
                 if (len > MaxLen) {
                     MaxLen = len;
@@ -127,7 +134,7 @@ int SynEditStringList::lengthOfLongestLine() {
         }
     }
     if (mIndexOfLongestLine >= 0)
-        return mList[mIndexOfLongestLine]->fColumns;
+        return mList.columns(mIndexOfLongestLine);
     else
         return 0;
 }
@@ -148,8 +155,8 @@ QString SynEditStringList::lineBreak() const
 SynRangeState SynEditStringList::ranges(int Index)
 {
     QMutexLocker locker(&mMutex);
-    if (Index>=0 && Index < mList.size()) {
-        return mList[Index]->fRange;
+    if (Index>=0 && Index < mList.count()) {
+        return mList.range(Index);
     } else {
          ListIndexOutOfBounds(Index);
     }
@@ -159,20 +166,19 @@ SynRangeState SynEditStringList::ranges(int Index)
 void SynEditStringList::insertItem(int Index, const QString &s)
 {
     beginUpdate();
-    PSynEditStringRec line = std::make_shared<SynEditStringRec>();
-    line->fString = s;
     mIndexOfLongestLine = -1;
-    mList.insert(Index,line);
+    mList.insertLines(Index,1);
+    mList.setString(Index,s);
     endUpdate();
 }
 
 void SynEditStringList::addItem(const QString &s)
 {
     beginUpdate();
-    PSynEditStringRec line = std::make_shared<SynEditStringRec>();
-    line->fString = s;
+    int index = mList.count();
     mIndexOfLongestLine = -1;
-    mList.append(line);
+    mList.insertLines(index,1);
+    mList.setString(index,s);
     endUpdate();
 }
 
@@ -194,9 +200,8 @@ void SynEditStringList::setRange(int Index, const SynRangeState& ARange)
     if (Index<0 || Index>=mList.count()) {
         ListIndexOutOfBounds(Index);
     }
-    beginUpdate();
-    mList[Index]->fRange = ARange;
-    endUpdate();
+    // highlighting states are not contents, don't notify the changes
+    mList.setRange(Index,ARange);
 }
 
 QString SynEditStringList::getString(int Index)
@@ -205,7 +210,7 @@ QString SynEditStringList::getString(int Index)
     if (Index<0 || Index>=mList.count()) {
         return QString();
     }
-    return mList[Index]->fString;
+    return mList.string(Index);
 }
 
 int SynEditStringList::count()
@@ -220,7 +225,7 @@ void *SynEditStringList::getObject(int Index)
     if (Index<0 || Index>=mList.count()) {
         return nullptr;
     }
-    return mList[Index]->fObject;
+    return mList.object(Index);
 }
 
 QString SynEditStringList::text()
@@ -258,9 +263,9 @@ QStringList SynEditStringList::contents()
 {
     QMutexLocker locker(&mMutex);
     QStringList Result;
-    SynEditStringRecList list = mList;
-    foreach (const PSynEditStringRec& line, list) {
-        Result.append(line->fString);
+    Result.reserve(mList.count());
+    for (int i=0;i<mList.count();i++) {
+        Result.append(mList.string(i));
     }
     return Result;
 }
@@ -315,8 +320,8 @@ int SynEditStringList::getTextLength()
 {
     QMutexLocker locker(&mMutex);
     int Result = 0;
-    foreach (const PSynEditStringRec& line, mList ) {
-        Result += line->fString.length();
+    for (int i=0;i<mList.count();i++) {
+        Result += mList.string(i).length();
         if (mFileEndingType == FileEndingType::Windows) {
             Result += 2;
         } else {
@@ -365,10 +370,7 @@ void SynEditStringList::exchange(int Index1, int Index2)
         ListIndexOutOfBounds(Index2);
     }
     beginUpdate();
-    PSynEditStringRec temp = mList[Index1];
-    mList[Index1]=mList[Index2];
-    mList[Index2]=temp;
-    //mList.swapItemsAt(Index1,Index2);
+    mList.exchange(Index1,Index2);
     if (mIndexOfLongestLine == Index1) {
         mIndexOfLongestLine = Index2;
     } else if (mIndexOfLongestLine == Index2) {
@@ -398,7 +400,7 @@ void SynEditStringList::deleteAt(int Index)
     beginUpdate();
     if (mIndexOfLongestLine == Index)
         mIndexOfLongestLine = -1;
-    mList.removeAt(Index);
+    mList.remove(Index,1);
     emit deleted(Index,1);
     endUpdate();
 }
@@ -407,12 +409,11 @@ QString SynEditStringList::getTextStr() const
 {
     QString result;
     for (int i=0;i<mList.count()-1;i++) {
-        const PSynEditStringRec& line = mList[i];
-        result.append(line->fString);
+        result.append(mList.string(i));
         result.append(lineBreak());
     }
-    if (mList.length()>0) {
-        result.append(mList.back()->fString);
+    if (mList.count()>0) {
+        result.append(mList.string(mList.count()-1));
     }
     return result;
 }
@@ -427,8 +428,8 @@ void SynEditStringList::putString(int Index, const QString &s, bool notify) {
         }
         beginUpdate();
         mIndexOfLongestLine = -1;
-        mList[Index]->fString = s;
-        mList[Index]->fColumns = -1;
+        mList.setString(Index,s);
+        mList.setColumns(Index,-1);
         if (notify)
             emit putted(Index,1);
         endUpdate();
@@ -442,7 +443,7 @@ void SynEditStringList::putObject(int Index, void *AObject)
         ListIndexOutOfBounds(Index);
     }
     beginUpdate();
-    mList[Index]->fObject = AObject;
+    mList.setObject(Index,AObject);
     endUpdate();
 }
 
@@ -456,10 +457,9 @@ void SynEditStringList::setUpdateState(bool Updating)
 
 int SynEditStringList::calculateLineColumns(int Index)
 {
-    PSynEditStringRec line = mList[Index];
-
-    line->fColumns = mEdit->stringColumns(line->fString,0);
-    return line->fColumns;
+    int columns = mEdit->stringColumns(mList.string(Index),0);
+    mList.setColumns(Index,columns);
+    return columns;
 }
 
 void SynEditStringList::insertLines(int Index, int NumLines)
@@ -474,12 +474,7 @@ void SynEditStringList::insertLines(int Index, int NumLines)
     auto action = finally([this]{
         endUpdate();
     });
-    PSynEditStringRec line;
-    mList.insert(Index,NumLines,line);
-    for (int i=Index;i<Index+NumLines;i++) {
-        line = std::make_shared<SynEditStringRec>();
-        mList[i]=line;
-    }
+    mList.insertLines(Index,NumLines);
     emit inserted(Index,NumLines);
 }
 
@@ -495,13 +490,7 @@ void SynEditStringList::insertStrings(int Index, const QStringList &NewStrings)
     auto action = finally([this]{
         endUpdate();
     });
-    PSynEditStringRec line;
-    mList.insert(Index,NewStrings.length(),line);
-    for (int i=0;i<NewStrings.length();i++) {
-        line = std::make_shared<SynEditStringRec>();
-        line->fString = NewStrings[i];
-        mList[i+Index]=line;
-    }
+    mList.insertStrings(Index,NewStrings);
     emit inserted(Index,NewStrings.length());
 }
 
@@ -517,92 +506,237 @@ void SynEditStringList::insertText(int Index, const QString &NewText)
     insertStrings(Index,lines);
 }
 
-void SynEditStringList::loadFromFile(const QString& filename, const QByteArray& encoding, QByteArray& realEncoding)
+// files are decoded a chunk at a time, so the progress can be reported
+#define LOAD_CHUNK_SIZE (1024*1024)
+
+using LoadProgressFunc = std::function<void (int percent)>;
+
+// lines are separated by '\n', and trailing spaces (and '\r') are removed
+static QStringList splitAsciiLines(const char* data, int size, const LoadProgressFunc& progress)
+{
+    QStringList lines;
+    int start = 0;
+    int nextReport = LOAD_CHUNK_SIZE;
+    while (start<size) {
+        const char* p = (const char*)memchr(data+start,'\n',size-start);
+        int end = p ? (p-data) : size;
+        int last = end - 1;
+        while (last>=start && (unsigned char)data[last]<=32)
+            last--;
+        lines.append(QString::fromLatin1(data+start,last-start+1));
+        start = end + 1;
+        if (start>=nextReport) {
+            progress((qint64)start*100/size);
+            nextReport = start + LOAD_CHUNK_SIZE;
+        }
+    }
+    return lines;
+}
+
+static QStringList splitLines(const QString& text)
+{
+    QStringList lines;
+    int start = 0;
+    while (start<text.length()) {
+        int end = text.indexOf('\n',start);
+        if (end<0)
+            end = text.length();
+        int last = end - 1;
+        while (last>=start && text[last]<=32)
+            last--;
+        lines.append(text.mid(start,last-start+1));
+        start = end + 1;
+    }
+    return lines;
+}
+
+// the state keeps the chars split between chunks
+static QString decodeText(QTextCodec* codec, const char* data, int size,
+                          QTextCodec::ConverterState* state, const LoadProgressFunc& progress)
 {
-    QMutexLocker locker(&mMutex);
-    QFile file(filename);
-    if (!file.open(QFile::ReadOnly ))
-        throw FileError(tr("Can't open file '%1' for read!").arg(file.fileName()));
-    beginUpdate();
-    auto action = finally([this]{
-        endUpdate();
-    });
-    //test for utf8 / utf 8 bom
+    QString text;
+    text.reserve(size);
+    for (int pos=0;pos<size;pos+=LOAD_CHUNK_SIZE) {
+        int n = std::min(LOAD_CHUNK_SIZE,size-pos);
+        text += codec->toUnicode(data+pos,n,state);
+        progress((qint64)(pos+n)*100/size);
+    }
+    return text;
+}
+
+/*
+ * Decode the whole file at once. When auto detecting, files without non-ascii chars
+ * are not decoded, and the others are decoded as UTF-8 (with or without BOM), or in
+ * the system default encoding if they are not valid UTF-8.
+ */
+static QStringList decodeLines(const char* data, int size, const QByteArray& encoding,
+                               const QByteArray& systemEncoding, QByteArray& realEncoding,
+                               const LoadProgressFunc& progress)
+{
+    bool hasBOM = (size>=3) && ((unsigned char)data[0]==0xEF)
+            && ((unsigned char)data[1]==0xBB) && ((unsigned char)data[2]==0xBF);
     if (encoding == ENCODING_AUTO_DETECT) {
-        if (file.atEnd()) {
-            realEncoding = ENCODING_ASCII;
-            return;
-        }
-        QByteArray line = file.readLine();
-        QTextCodec* codec;
-        QTextCodec::ConverterState state;
-        bool needReread = false;
-        bool allAscii = true;
-        //test for BOM
-        if ((line.length()>=3) && ((unsigned char)line[0]==0xEF) && ((unsigned char)line[1]==0xBB) && ((unsigned char)line[2]==0xBF) ) {
+        if (hasBOM) {
             realEncoding = ENCODING_UTF8_BOM;
-            line = line.mid(3);
-            codec = QTextCodec::codecForName(ENCODING_UTF8);
+        } else if (isTextAllAscii(data,size)) {
+            realEncoding = ENCODING_ASCII;
+            return splitAsciiLines(data,size,progress);
         } else {
             realEncoding = ENCODING_UTF8;
-            codec = QTextCodec::codecForName(ENCODING_UTF8);
         }
-        if (line.endsWith("\r\n")) {
-            mFileEndingType = FileEndingType::Windows;
-        } else if (line.endsWith("\n")) {
-            mFileEndingType = FileEndingType::Linux;
-        } else if (line.endsWith("\r")) {
-            mFileEndingType = FileEndingType::Mac;
+        QTextCodec* codec = QTextCodec::codecForName(ENCODING_UTF8);
+        QTextCodec::ConverterState state;
+        QString text = hasBOM ? decodeText(codec,data+3,size-3,&state,progress)
+                              : decodeText(codec,data,size,&state,progress);
+        if (state.invalidChars==0 && state.remainingChars==0)
+            return splitLines(text);
+        realEncoding = systemEncoding;
+    } else if (encoding == ENCODING_SYSTEM_DEFAULT) {
+        realEncoding = systemEncoding;
+    } else {
+        realEncoding = encoding;
+    }
+    QTextCodec* codec;
+    if (realEncoding == ENCODING_UTF8_BOM) {
+        codec = QTextCodec::codecForName(ENCODING_UTF8);
+        if (hasBOM) {
+            data += 3;
+            size -= 3;
         }
-        internalClear();
-        while (true) {
-            if (allAscii) {
-                allAscii = isTextAllAscii(line);
-            }
-            if (allAscii) {
-                addItem(trimRight(QString::fromLatin1(line)));
-            } else {
-                QString newLine = codec->toUnicode(line.constData(),line.length(),&state);
-                if (state.invalidChars>0) {
-                    needReread = true;
-                    break;
-                }
-                addItem(trimRight(newLine));
-            }
-            if (file.atEnd()){
-                break;
-            }
-            line = file.readLine();
+    } else {
+        codec = QTextCodec::codecForName(realEncoding);
+    }
+    if (!codec)
+        codec = QTextCodec::codecForLocale();
+    QTextCodec::ConverterState state;
+    return splitLines(decodeText(codec,data,size,&state,progress));
+}
+
+/*
+ * Read and decode the file. It doesn't touch any editor data, so it can be run in a
+ * worker thread.
+ */
+static SynDecodedFile decodeFile(const QString& filename, const QByteArray& encoding,
+                                 const QByteArray& systemEncoding, const LoadProgressFunc& progress)
+{
+    SynDecodedFile decoded;
+    decoded.fileEndingDetected = false;
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly )) {
+        decoded.error = SynEditStringList::tr("Can't open file '%1' for read!").arg(file.fileName());
+        return decoded;
+    }
+    QByteArray contents;
+    const char* data = nullptr;
+    int size = 0;
+    if (file.size()>0 && file.size()<=INT_MAX) {
+        uchar* mapped = file.map(0,file.size());
+        if (mapped) {
+            data = (const char*)mapped;
+            size = file.size();
         }
-        emit inserted(0,mList.count());
-        if (!needReread) {
-            if (allAscii)
-                realEncoding = ENCODING_ASCII;
-            return;
+    }
+    if (!data) {
+        contents = file.readAll();
+        data = contents.constData();
+        size = contents.size();
+    }
+
+    decoded.lines = decodeLines(data,size,encoding,systemEncoding,decoded.realEncoding,progress);
+    if (encoding == ENCODING_AUTO_DETECT) {
+        const char* lineEnd = (const char*)memchr(data,'\n',size);
+        if (lineEnd) {
+            decoded.fileEndingDetected = true;
+            if (lineEnd>data && *(lineEnd-1)=='\r')
+                decoded.fileEndingType = FileEndingType::Windows;
+            else
+                decoded.fileEndingType = FileEndingType::Linux;
+        } else if (memchr(data,'\r',size)) {
+            decoded.fileEndingDetected = true;
+            decoded.fileEndingType = FileEndingType::Mac;
         }
-        realEncoding = ENCODING_SYSTEM_DEFAULT;
-    } else {
-        realEncoding = encoding;
     }
+    return decoded;
+}
 
-    if (realEncoding == ENCODING_SYSTEM_DEFAULT) {
-        realEncoding = pCharsetInfoManager->getDefaultSystemEncoding();
+void SynEditStringList::loadFromFile(const QString& filename, const QByteArray& encoding, QByteArray& realEncoding)
+{
+    cancelLoading();
+    SynDecodedFile decoded = decodeFile(filename,encoding,
+                                        pCharsetInfoManager->getDefaultSystemEncoding(),
+                                        [](int){});
+    if (!decoded.error.isEmpty())
+        throw FileError(decoded.error);
+    realEncoding = decoded.realEncoding;
+    setDecodedFile(decoded);
+}
+
+void SynEditStringList::loadFromFileInBackground(const QString &filename, const QByteArray &encoding)
+{
+    cancelLoading();
+    QByteArray systemEncoding = pCharsetInfoManager->getDefaultSystemEncoding();
+    QFutureInterface<SynDecodedFile> futureInterface;
+    futureInterface.setProgressRange(0,100);
+    futureInterface.reportStarted();
+    mLoadWatcher = new QFutureWatcher<SynDecodedFile>(this);
+    connect(mLoadWatcher, &QFutureWatcher<SynDecodedFile>::progressValueChanged,
+            this, &SynEditStringList::loadProgress);
+    connect(mLoadWatcher, &QFutureWatcher<SynDecodedFile>::finished,
+            this, &SynEditStringList::onFileDecoded);
+    mLoadWatcher->setFuture(futureInterface.future());
+    QtConcurrent::run([futureInterface,filename,encoding,systemEncoding]() mutable {
+        SynDecodedFile decoded = decodeFile(filename,encoding,systemEncoding,
+                                            [&futureInterface](int percent){
+            futureInterface.setProgressValue(percent);
+        });
+        futureInterface.reportResult(decoded);
+        futureInterface.reportFinished();
+    });
+}
+
+bool SynEditStringList::loading() const
+{
+    return mLoadWatcher!=nullptr;
+}
+
+void SynEditStringList::cancelLoading()
+{
+    // the worker can't be stopped, its result is just dropped
+    if (mLoadWatcher) {
+        mLoadWatcher->disconnect(this);
+        mLoadWatcher->deleteLater();
+        mLoadWatcher = nullptr;
     }
-    file.reset();
-    QTextStream textStream(&file);
-    if (realEncoding == ENCODING_UTF8_BOM) {
-        textStream.setAutoDetectUnicode(true);
-        textStream.setCodec(ENCODING_UTF8);
-    } else {
-        textStream.setAutoDetectUnicode(false);
-        textStream.setCodec(realEncoding);
+}
+
+void SynEditStringList::onFileDecoded()
+{
+    SynDecodedFile decoded = mLoadWatcher->result();
+    mLoadWatcher->deleteLater();
+    mLoadWatcher = nullptr;
+    if (!decoded.error.isEmpty()) {
+        emit loadFailed(decoded.error);
+        return;
     }
-    QString line;
+    setDecodedFile(decoded);
+    emit loaded(decoded.realEncoding);
+}
+
+void SynEditStringList::setDecodedFile(const SynDecodedFile &decoded)
+{
+    QMutexLocker locker(&mMutex);
+    if (decoded.fileEndingDetected)
+        mFileEndingType = decoded.fileEndingType;
+    beginUpdate();
+    auto action = finally([this]{
+        endUpdate();
+    });
     internalClear();
-    while (textStream.readLineInto(&line)) {
-        addItem(trimRight(line));
+    if (!decoded.lines.isEmpty()) {
+        mIndexOfLongestLine = -1;
+        mList.insertStrings(0,decoded.lines);
+        emit inserted(0,mList.count());
     }
-    emit inserted(0,mList.count());
 }
 
 
@@ -613,7 +747,7 @@ void SynEditStringList::saveToFile(QFile &file, const QByteArray& encoding,
     QMutexLocker locker(&mMutex);
     if (!file.open(QFile::WriteOnly | QFile::Truncate))
         throw FileError(tr("Can't open file '%1' for save!").arg(file.fileName()));
-    if (mList.isEmpty())
+    if (mList.count()==0)
         return;
     bool allAscii = true;
 
@@ -633,14 +767,15 @@ void SynEditStringList::saveToFile(QFile &file, const QByteArray& encoding,
     } else {
         codec = QTextCodec::codecForName(realEncoding);
     }
-    for (PSynEditStringRec& line:mList) {
+    for (int i=0;i<mList.count();i++) {
+        const QString& line = mList.string(i);
         if (allAscii) {
-            allAscii = isTextAllAscii(line->fString);
+            allAscii = isTextAllAscii(line);
         }
         if (!allAscii) {
-            file.write(codec->fromUnicode(line->fString));
+            file.write(codec->fromUnicode(line));
         } else {
-            file.write(line->fString.toLatin1());
+            file.write(line.toLatin1());
         }
         file.write(lineBreak().toLatin1());
     }
@@ -684,7 +819,7 @@ void SynEditStringList::putTextStr(const QString &text)
 
 void SynEditStringList::internalClear()
 {
-    if (!mList.isEmpty()) {
+    if (mList.count()>0) {
         beginUpdate();
         int oldCount = mList.count();
         mIndexOfLongestLine = -1;
@@ -716,31 +851,16 @@ void SynEditStringList::resetColumns()
 {
     QMutexLocker locker(&mMutex);
     mIndexOfLongestLine = -1;
-    if (mList.count() > 0 ) {
-        for (int i=0;i<mList.size();i++) {
-            mList[i]->fColumns = -1;
-        }
-    }
+    mList.resetColumns();
 }
 
 void SynEditStringList::invalidAllLineColumns()
 {
     QMutexLocker locker(&mMutex);
     mIndexOfLongestLine = -1;
-    for (PSynEditStringRec& line:mList) {
-        line->fColumns = -1;
-    }
+    mList.resetColumns();
 }
 
-SynEditStringRec::SynEditStringRec():
-    fString(),
-    fObject(nullptr),
-    fRange{0,0,0,0,0},
-    fColumns(-1)
-{
-}
-
-
 SynEditUndoList::SynEditUndoList():QObject()
 {
     mMaxUndoActions = 1024;
@@ -20,11 +20,13 @@
 #include <QStringList>
 #include "highlighter/base.h"
 #include <QMutex>
+#include <QFutureWatcher>
 #include <QVector>
 #include <memory>
 #include "MiscProcs.h"
 #include "../utils.h"
 #include "Types.h"
+#include "LineStore.h"
 
 enum SynEditStringFlag {
     sfHasTabs = 0x0001,
@@ -34,22 +36,17 @@ enum SynEditStringFlag {
 
 typedef int SynEditStringFlags;
 
-struct SynEditStringRec {
-  QString fString;
-  void * fObject;
-  SynRangeState fRange;
-  int fColumns;  //
-
-public:
-  explicit SynEditStringRec();
+/**
+ * @brief a file read and decoded by a SynEditStringList
+ */
+struct SynDecodedFile {
+    QStringList lines;
+    QByteArray realEncoding;
+    bool fileEndingDetected;
+    FileEndingType fileEndingType;
+    QString error; // empty if the file is read
 };
 
-typedef std::shared_ptr<SynEditStringRec> PSynEditStringRec;
-
-typedef QVector<PSynEditStringRec> SynEditStringRecList;
-
-typedef std::shared_ptr<SynEditStringRecList> PSynEditStringRecList;
-
 class SynEditStringList;
 
 typedef std::shared_ptr<SynEditStringList> PSynEditStringList;
@@ -102,6 +99,13 @@ public:
     void insertStrings(int Index, const QStringList& NewStrings);
     void insertText(int Index,const QString& NewText);
     void loadFromFile(const QString& filename, const QByteArray& encoding, QByteArray& realEncoding);
+    /**
+     * @brief decode the file in a worker thread. The lines are replaced when it's done,
+     * then loaded() (or loadFailed()) is emitted.
+     */
+    void loadFromFileInBackground(const QString& filename, const QByteArray& encoding);
+    bool loading() const;
+    void cancelLoading();
     void saveToFile(QFile& file, const QByteArray& encoding,
                     const QByteArray& defaultEncoding, QByteArray& realEncoding);
 
@@ -116,6 +120,8 @@ public:
     void resetColumns();
 public slots:
     void invalidAllLineColumns();
+private slots:
+    void onFileDecoded();
 
 signals:
     void changed();
@@ -124,6 +130,9 @@ signals:
     void deleted(int index, int count);
     void inserted(int index, int count);
     void putted(int index, int count);
+    void loadProgress(int percent);
+    void loaded(const QByteArray& realEncoding);
+    void loadFailed(const QString& reason);
 protected:
     QString getTextStr() const;
     void setUpdateState(bool Updating);
@@ -131,9 +140,10 @@ protected:
     void addItem(const QString& s);
     void putTextStr(const QString& text);
     void internalClear();
+    void setDecodedFile(const SynDecodedFile& decoded);
 
 private:
-    SynEditStringRecList mList;
+    SynEditLineStore mList;
 
     SynEdit* mEdit;
     //int mCount;
@@ -143,6 +153,7 @@ private:
     int mIndexOfLongestLine;
     int mUpdateCount;
     QMutex mMutex;
+    QFutureWatcher<SynDecodedFile>* mLoadWatcher; // not null while loading in background
 
     int calculateLineColumns(int Index);
 };
@@ -3447,6 +3447,16 @@ void Settings::CodeCompletion::setClearWhenEditorHidden(bool newClearWhenEditorH
     mClearWhenEditorHidden = newClearWhenEditorHidden;
 }
 
+int Settings::CodeCompletion::parserThreads() const
+{
+    return mParserThreads;
+}
+
+void Settings::CodeCompletion::setParserThreads(int newParserThreads)
+{
+    mParserThreads = newParserThreads;
+}
+
 bool Settings::CodeCompletion::appendFunc() const
 {
     return mAppendFunc;
@@ -3572,6 +3582,7 @@ void Settings::CodeCompletion::doSave()
     saveValue("append_func",mAppendFunc);
     saveValue("show_code_ins",mShowCodeIns);
     saveValue("clear_when_editor_hidden",mClearWhenEditorHidden);
+    saveValue("parser_threads",mParserThreads);
 }
 
 
@@ -3590,6 +3601,7 @@ void Settings::CodeCompletion::doLoad()
     mIgnoreCase = boolValue("ignore_case",true);
     mAppendFunc = boolValue("append_func",true);
     mShowCodeIns = boolValue("show_code_ins",true);
+    mParserThreads = intValue("parser_threads",0);
 
     bool doClear = true;
 
@@ -572,6 +572,9 @@ public:
         bool clearWhenEditorHidden() const;
         void setClearWhenEditorHidden(bool newClearWhenEditorHidden);
 
+        int parserThreads() const;
+        void setParserThreads(int newParserThreads);
+
     private:
         int mWidth;
         int mHeight;
@@ -586,6 +589,7 @@ public:
         bool mAppendFunc;
         bool mShowCodeIns;
         bool mClearWhenEditorHidden;
+        int mParserThreads;
 
         // _Base interface
     protected:
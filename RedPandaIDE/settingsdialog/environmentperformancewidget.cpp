@@ -33,6 +33,7 @@ EnvironmentPerformanceWidget::~EnvironmentPerformanceWidget()
 void EnvironmentPerformanceWidget::doLoad()
 {
     ui->chkClearWhenEditorHidden->setChecked(pSettings->codeCompletion().clearWhenEditorHidden());
+    ui->spinParserThreads->setValue(pSettings->codeCompletion().parserThreads());
 #ifdef Q_OS_WIN
     MEMORYSTATUSEX statex;
 
@@ -50,6 +51,7 @@ void EnvironmentPerformanceWidget::doLoad()
 void EnvironmentPerformanceWidget::doSave()
 {
     pSettings->codeCompletion().setClearWhenEditorHidden(ui->chkClearWhenEditorHidden->isChecked());
+    pSettings->codeCompletion().setParserThreads(ui->spinParserThreads->value());
 
     pSettings->codeCompletion().save();
 }
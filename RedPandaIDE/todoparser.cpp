@@ -27,11 +27,11 @@ TodoParser::TodoParser(QObject *parent) : QObject(parent),
     mThread = nullptr;
 }
 
-void TodoParser::parseFile(const QString &filename)
+bool TodoParser::parseFile(const QString &filename)
 {
     QMutexLocker locker(&mMutex);
     if (mThread) {
-        return;
+        return false;
     }
     mThread = new TodoThread(filename);
     connect(mThread,&QThread::finished,
@@ -49,6 +49,7 @@ void TodoParser::parseFile(const QString &filename)
     connect(mThread, &TodoThread::parseFinished,
             pMainWindow, &MainWindow::onTodoParseFinished);
     mThread->start();
+    return true;
 }
 
 bool TodoParser::parsing() const
@@ -77,7 +77,10 @@ class TodoParser : public QObject
     Q_OBJECT
 public:
     explicit TodoParser(QObject *parent = nullptr);
-    void parseFile(const QString& filename);
+    /**
+     * @return false if a file is being parsed
+     */
+    bool parseFile(const QString& filename);
     bool parsing() const;
 
 private:
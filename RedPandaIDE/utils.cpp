@@ -198,15 +198,6 @@ bool directoryExists(const QString &file)
    return dir.exists() && dir.isDir();
 }
 
-QString includeTrailingPathDelimiter(const QString &path)
-{
-    if (path.endsWith('/') || path.endsWith(QDir::separator())) {
-        return path;
-    } else {
-        return path + "/";
-    }
-}
-
 QString excludeTrailingPathDelimiter(const QString &path)
 {
     int pos = path.length()-1;
@@ -380,28 +371,6 @@ void readFileToLines(const QString &fileName, QTextCodec *codec, LineProcessFunc
     }
 }
 
-BaseError::BaseError(const QString &reason):
-mReason(reason)
-{
-
-}
-
-QString BaseError::reason() const
-{
-    return mReason;
-}
-
-IndexOutOfRange::IndexOutOfRange(int Index):
-BaseError(QObject::tr("Index %1 out of range").arg(Index))
-{
-
-}
-
-FileError::FileError(const QString &reason): BaseError(reason)
-{
-
-}
-
 void decodeKey(const int combinedKey, int &key, Qt::KeyboardModifiers &modifiers)
 {
     modifiers = Qt::NoModifier;
@@ -538,43 +507,6 @@ QString changeFileExt(const QString& filename, QString ext)
     }
 }
 
-QStringList readFileToLines(const QString &fileName)
-{
-    QFile file(fileName);
-    if (file.size()<=0)
-        return QStringList();
-    QTextCodec* codec = QTextCodec::codecForLocale();
-    QStringList result;
-    QTextCodec::ConverterState state;
-    bool ok = true;
-    if (file.open(QFile::ReadOnly)) {
-        while (!file.atEnd()) {
-            QByteArray array = file.readLine();
-            QString s = codec->toUnicode(array,array.length(),&state);
-            if (state.invalidChars>0) {
-                ok=false;
-                break;
-            }
-            result.append(s);
-        }
-        if (!ok) {
-            file.seek(0);
-            result.clear();
-            codec = QTextCodec::codecForName("UTF-8");
-            while (!file.atEnd()) {
-                QByteArray array = file.readLine();
-                QString s = codec->toUnicode(array,array.length(),&state);
-                if (state.invalidChars>0) {
-                    result.clear();
-                    break;
-                }
-                result.append(s);
-            }
-        }
-    }
-    return result;
-}
-
 void stringsToFile(const QStringList &list, const QString &fileName)
 {
     QFile file(fileName);
@@ -586,47 +518,66 @@ void stringsToFile(const QStringList &list, const QString &fileName)
     }
 }
 
-void resetCppParser(std::shared_ptr<CppParser> parser)
+void resetCppParser(std::shared_ptr<CppParser> parser, const std::function<void ()>& onReset)
 {
     if (!parser)
         return;
+    // connect before trying, so we won't miss the signal if the parser gets idle meanwhile
+    std::shared_ptr<QMetaObject::Connection> connection = std::make_shared<QMetaObject::Connection>();
+    *connection = QObject::connect(parser.get(), &CppParser::onIdle,
+                                   pMainWindow, [parser,onReset,connection]() {
+        // signals queued before it's disconnected are still delivered
+        if (!QObject::disconnect(*connection))
+            return;
+        resetCppParser(parser, onReset);
+    }, Qt::QueuedConnection);
     // Configure parser
-    parser->reset();
+    if (!parser->reset()) {
+        // the running parse is asked to stop, try again when it's done
+        // and no one freezes the parser
+        return;
+    }
+    QObject::disconnect(*connection);
     //paser->enabled = pSettings-> devCodeCompletion.Enabled;
 //    CppParser.ParseLocalHeaders := devCodeCompletion.ParseLocalHeaders;
 //    CppParser.ParseGlobalHeaders := devCodeCompletion.ParseGlobalHeaders;
     parser->setEnabled(true);
     parser->setParseGlobalHeaders(true);
     parser->setParseLocalHeaders(true);
+    parser->setParserThreads(pSettings->codeCompletion().parserThreads());
+    // editors read the results of the last parse while the parser is busy
+    parser->setSnapshotWhileParsing(true);
     // Set options depending on the current compiler set
     // TODO: do this every time OnCompilerSetChanged
     Settings::PCompilerSet compilerSet = pSettings->compilerSets().defaultSet();
     parser->clearIncludePaths();
     if (compilerSet) {
-        foreach  (const QString& file,compilerSet->CppIncludeDirs()) {
-            parser->addIncludePath(file);
-        }
-        foreach  (const QString& file,compilerSet->CIncludeDirs()) {
-            parser->addIncludePath(file);
-        }
-        foreach  (const QString& file,compilerSet->defaultCppIncludeDirs()) {
-            parser->addIncludePath(file);
-        }
-        foreach  (const QString& file,compilerSet->defaultCIncludeDirs()) {
+        QStringList includeDirs;
+        includeDirs.append(compilerSet->CppIncludeDirs());
+        includeDirs.append(compilerSet->CIncludeDirs());
+        includeDirs.append(compilerSet->defaultCppIncludeDirs());
+        includeDirs.append(compilerSet->defaultCIncludeDirs());
+        QStringList defines = compilerSet->defines(); // predefined constants from -dM -E
+        // add a Red Pand C++ 's own macro
+        defines.append("#define EGE_FOR_AUTO_CODE_COMPLETETION_ONLY");
+        // add C/C++ default macro
+        defines.append("#define __FILE__  1");
+        defines.append("#define __LINE__  1");
+        defines.append("#define __DATE__  1");
+        defines.append("#define __TIME__  1");
+
+        foreach  (const QString& file,includeDirs) {
             parser->addIncludePath(file);
         }
         //TODO: Add default include dirs last, just like gcc does
         // Set defines
-        for (QString define:compilerSet->defines()) {
-            parser->addHardDefineByLine(define); // predefined constants from -dM -E
+        foreach (const QString& define,defines) {
+            parser->addHardDefineByLine(define);
         }
-        // add a Red Pand C++ 's own macro
-        parser->addHardDefineByLine("#define EGE_FOR_AUTO_CODE_COMPLETETION_ONLY");
-        // add C/C++ default macro
-        parser->addHardDefineByLine("#define __FILE__  1");
-        parser->addHardDefineByLine("#define __LINE__  1");
-        parser->addHardDefineByLine("#define __DATE__  1");
-        parser->addHardDefineByLine("#define __TIME__  1");
+        // system headers are parsed only once for all parsers using the same compiler set
+        parser->setSystemHeaderStore(CppSystemHeaderStore::acquire(
+                                        includeDirs,defines,
+                                        includeTrailingPathDelimiter(pSettings->dirs().config())+DEV_PARSER_CACHE_DIR));
     }
     parser->parseHardDefines();
     pMainWindow->disconnect(parser.get(),
@@ -653,6 +604,8 @@ void resetCppParser(std::shared_ptr<CppParser> parser)
                             &CppParser::onEndParsing,
                             pMainWindow,
                             &MainWindow::onEndParsing);
+    if (onReset)
+        onReset();
 }
 
 bool findComplement(const QString &s, const QChar &fromToken, const QChar &toToken, int &curPos, int increment)
@@ -752,12 +705,6 @@ int getNewFileNumber()
     return count;
 }
 
-QString extractFilePath(const QString &filePath)
-{
-    QFileInfo info(filePath);
-    return info.path();
-}
-
 QString extractAbsoluteFilePath(const QString &filePath)
 {
     QFileInfo info(filePath);
@@ -769,11 +716,6 @@ bool isReadOnly(const QString &filename)
     return QFile(filename).isWritable();
 }
 
-QString extractFileDir(const QString &fileName)
-{
-    return extractFilePath(fileName);
-}
-
 QByteArray toByteArray(const QString &s)
 {
     return s.toLocal8Bit();
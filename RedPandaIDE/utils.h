@@ -133,6 +133,7 @@ const QByteArray GuessTextEncoding(const QByteArray& text);
 
 bool isTextAllAscii(const QByteArray& text);
 bool isTextAllAscii(const QString& text);
+bool isTextAllAscii(const char* data, qint64 size);
 
 QByteArray runAndGetOutput(const QString& cmd, const QString& workingDir, const QStringList& arguments,
                            const QByteArray& inputContent = QByteArray(),
@@ -228,7 +229,11 @@ bool readRegistry(HKEY key,const QByteArray& subKey, const QByteArray& name, QSt
 #endif
 
 class CppParser;
-void resetCppParser(std::shared_ptr<CppParser> parser);
+/**
+ * @brief reset and configure the parser. If the parser is busy, it's done on the gui
+ * thread when the parser gets idle, onReset is called after that.
+ */
+void resetCppParser(std::shared_ptr<CppParser> parser, const std::function<void ()>& onReset = nullptr);
 
 float desktopDpi();
 float pointToPixel(float point);
@@ -133,6 +133,17 @@ int ClassBrowserModel::columnCount(const QModelIndex&) const
 //    return false;
 //}
 
+// inherited members are the base classes' statements, or copies marked as inherited
+static bool isInheritedMember(const ClassBrowserNode* node)
+{
+    if (node->statement->isInherited)
+        return true;
+    if (!node->parent || !node->parent->statement)
+        return false;
+    PStatement parentScope = node->statement->parentScope.lock();
+    return parentScope && parentScope->fullName != node->parent->statement->fullName;
+}
+
 QVariant ClassBrowserModel::data(const QModelIndex &index, int role) const
 {
     if (!index.isValid()){
@@ -194,7 +205,7 @@ QVariant ClassBrowserModel::data(const QModelIndex &index, int role) const
             case StatementKind::skDestructor:
                 if (statement->scope == StatementScope::ssGlobal)
                     return *(pIconsManager->getPixmap(IconsManager::PARSER_GLOBAL_METHOD));
-                if (statement->isInherited) {
+                if (isInheritedMember(node)) {
                     if (statement->classScope == StatementClassScope::scsProtected) {
                         return *(pIconsManager->getPixmap(IconsManager::PARSER_INHERITED_PROTECTED_METHOD));
                     } else if (statement->classScope == StatementClassScope::scsPublic) {
@@ -215,7 +226,7 @@ QVariant ClassBrowserModel::data(const QModelIndex &index, int role) const
             case StatementKind::skVariable:
 //                if (statement->scope == StatementScope::ssGlobal)
 //                    return QIcon(":/icons/images/classparser/global.ico");
-                if (statement->isInherited) {
+                if (isInheritedMember(node)) {
                     if (statement->classScope == StatementClassScope::scsProtected) {
                         return *(pIconsManager->getPixmap(IconsManager::PARSER_INHERITED_PROTECTD_VAR));
                     } else if (statement->classScope == StatementClassScope::scsPublic) {
@@ -320,7 +331,9 @@ void ClassBrowserModel::addChild(ClassBrowserNode *node, PStatement statement)
     mNodes.append(newNode);
     //don't show enum type's children values (they are displayed in parent scope)
     if (statement->kind != StatementKind::skEnumType)
-        filterChildren(newNode.get(), statement->children);
+        filterChildren(newNode.get(), pSettings->ui().classBrowserShowInherited()
+                       ? mParser->statementList().childrenStatements(statement)
+                       : statement->children);
 }
 
 void ClassBrowserModel::addMembers()
@@ -337,8 +350,13 @@ void ClassBrowserModel::filterChildren(ClassBrowserNode *node, const StatementMa
     for (PStatement statement:statements) {
         if (statement->kind == StatementKind::skBlock)
             continue;
-        if (statement->isInherited && !pSettings->ui().classBrowserShowInherited())
-            continue;
+        if (!pSettings->ui().classBrowserShowInherited()) {
+            PStatement parentScope = statement->parentScope.lock();
+            if (statement->isInherited
+                    || (node->statement && parentScope
+                        && parentScope->fullName != node->statement->fullName))
+                continue;
+        }
 
         if (statement == node->statement) // prevent infinite recursion
             continue;
@@ -62,6 +62,8 @@ CodeCompletionPopup::CodeCompletionPopup(QWidget *parent) :
     mShowCodeSnippets = true;
 
     mIgnoreCase = false;
+    mLastFilterValid = false;
+    mLastIgnoreCase = false;
 }
 
 CodeCompletionPopup::~CodeCompletionPopup()
@@ -98,6 +100,7 @@ void CodeCompletionPopup::prepareSearch(
     } else {
         getCompletionListForPreWord(preWord);
     }
+    buildCompletionIndex();
 
     setCursor(oldCursor);
 }
@@ -210,7 +213,7 @@ void CodeCompletionPopup::addStatement(PStatement statement, const QString &file
     mFullCompletionStatementList.append(statement);
 }
 
-static bool nameComparator(PStatement statement1,PStatement statement2) {
+static bool nameComparator(const PStatement& statement1,const PStatement& statement2) {
     if (statement1->caseMatch && !statement2->caseMatch) {
         return true;
     } else if (!statement1->caseMatch && statement2->caseMatch) {
@@ -219,7 +222,7 @@ static bool nameComparator(PStatement statement1,PStatement statement2) {
         return statement1->command < statement2->command;
 }
 
-static bool defaultComparator(PStatement statement1,PStatement statement2) {
+static bool defaultComparator(const PStatement& statement1,const PStatement& statement2) {
     // Show user template first
     if (statement1->kind == StatementKind::skUserCodeSnippet) {
         if (statement2->kind != StatementKind::skUserCodeSnippet)
@@ -239,7 +242,7 @@ static bool defaultComparator(PStatement statement1,PStatement statement2) {
         return nameComparator(statement1,statement2);
 }
 
-static bool sortByScopeComparator(PStatement statement1,PStatement statement2){
+static bool sortByScopeComparator(const PStatement& statement1,const PStatement& statement2){
     // Show user template first
     if (statement1->kind == StatementKind::skUserCodeSnippet) {
         if (statement2->kind != StatementKind::skUserCodeSnippet)
@@ -272,7 +275,7 @@ static bool sortByScopeComparator(PStatement statement1,PStatement statement2){
         return nameComparator(statement1,statement2);
 }
 
-static bool sortWithUsageComparator(PStatement statement1,PStatement statement2) {
+static bool sortWithUsageComparator(const PStatement& statement1,const PStatement& statement2) {
     // Show user template first
     if (statement1->kind == StatementKind::skUserCodeSnippet) {
         if (statement2->kind != StatementKind::skUserCodeSnippet)
@@ -297,7 +300,7 @@ static bool sortWithUsageComparator(PStatement statement1,PStatement statement2)
         return nameComparator(statement1,statement2);
 }
 
-static bool sortByScopeWithUsageComparator(PStatement statement1,PStatement statement2){
+static bool sortByScopeWithUsageComparator(const PStatement& statement1,const PStatement& statement2){
     // Show user template first
     if (statement1->kind == StatementKind::skUserCodeSnippet) {
         if (statement2->kind != StatementKind::skUserCodeSnippet)
@@ -338,43 +341,66 @@ static bool sortByScopeWithUsageComparator(PStatement statement1,PStatement stat
 void CodeCompletionPopup::filterList(const QString &member)
 {
     QMutexLocker locker(&mMutex);
-    mCompletionStatementList.clear();
-    if (!mParser)
-        return;
-    if (!mParser->enabled())
+    if (!mParser || !mParser->enabled()) {
+        mCompletionStatementList.clear();
+        mLastFilterValid = false;
         return;
+    }
     //we don't need to freeze here since we use smart pointers
     //  and data have been retrieved from the parser
-//    if (!mParser->freeze())
-//        return;
-//    {
-//        auto action = finally([this]{
-//            mParser->unFreeze();
-//        });
-//        if (mParserSerialId!=mParser->serialId()) {
-//            return;
-//        }
 
-    mCompletionStatementList.clear();
-    if (!member.isEmpty()) { // filter
-        mCompletionStatementList.reserve(mFullCompletionStatementList.size());
-        foreach (const PStatement& statement, mFullCompletionStatementList) {
-            Qt::CaseSensitivity cs = (mIgnoreCase?
-                                          Qt::CaseInsensitive:
-                                          Qt::CaseSensitive);
+    Qt::CaseSensitivity cs = (mIgnoreCase?
+                                  Qt::CaseInsensitive:
+                                  Qt::CaseSensitive);
+    // the order of the last result only changes if caseMatch or freqTop changes
+    bool orderChanged = true;
+    if (member.isEmpty()) {
+        mCompletionStatementList = mFullCompletionStatementList;
+    } else if (mLastFilterValid
+               && mLastIgnoreCase == mIgnoreCase
+               && !mLastFilter.isEmpty()
+               && member.startsWith(mLastFilter,cs)) {
+        // narrow the last result
+        orderChanged = false;
+        StatementList lastList = mCompletionStatementList;
+        mCompletionStatementList.clear();
+        foreach (const PStatement& statement, lastList) {
             if (statement->command.startsWith(member, cs)) {
-                if (mIgnoreCase) {
+                if (mIgnoreCase && statement->caseMatch) {
                     statement->caseMatch =
                             statement->command.startsWith(
                                 member,Qt::CaseSensitive);
-                } else {
-                    statement->caseMatch = true;
+                    if (!statement->caseMatch)
+                        orderChanged = true;
                 }
                 mCompletionStatementList.append(statement);
             }
         }
-    } else
-        mCompletionStatementList.append(mFullCompletionStatementList);
+    } else {
+        // find the statements starting with the member in the index
+        mCompletionStatementList.clear();
+        QString key = member.toCaseFolded();
+        auto it = std::lower_bound(mIndexKeys.constBegin(),mIndexKeys.constEnd(),key);
+        for (int i = it - mIndexKeys.constBegin();
+             i<mIndexKeys.count() && mIndexKeys[i].startsWith(key);
+             i++) {
+            const PStatement& statement = mIndexedStatements[i];
+            if (!statement->command.startsWith(member, cs))
+                continue;
+            if (mIgnoreCase) {
+                statement->caseMatch =
+                        statement->command.startsWith(
+                            member,Qt::CaseSensitive);
+            } else {
+                statement->caseMatch = true;
+            }
+            mCompletionStatementList.append(statement);
+        }
+    }
+    mLastFilter = member;
+    mLastIgnoreCase = mIgnoreCase;
+    mLastFilterValid = true;
+
     if (mRecordUsage) {
         int topCount = 0;
         int secondCount = 0;
@@ -407,16 +433,25 @@ void CodeCompletionPopup::filterList(const QString &member)
             }
         }
         foreach (const PStatement& statement, mCompletionStatementList) {
+            int freqTop = statement->freqTop;
             if (statement->usageCount == 0) {
-                statement->freqTop = 0;
+                freqTop = 0;
             } else if  (statement->usageCount == topCount) {
-                statement->freqTop = 30;
+                freqTop = 30;
             } else if  (statement->usageCount == secondCount) {
-                statement->freqTop = 20;
+                freqTop = 20;
             } else if  (statement->usageCount == thirdCount) {
-                statement->freqTop = 10;
+                freqTop = 10;
+            }
+            if (freqTop != statement->freqTop) {
+                statement->freqTop = freqTop;
+                orderChanged = true;
             }
         }
+    }
+    if (!orderChanged)
+        return;
+    if (mRecordUsage) {
         if (mSortByScope) {
             std::sort(mCompletionStatementList.begin(),
                       mCompletionStatementList.end(),
@@ -435,7 +470,29 @@ void CodeCompletionPopup::filterList(const QString &member)
                   mCompletionStatementList.end(),
                   defaultComparator);
     }
-    //    }
+}
+
+void CodeCompletionPopup::buildCompletionIndex()
+{
+    QVector<QPair<QString,PStatement>> entries;
+    entries.reserve(mFullCompletionStatementList.count());
+    foreach (const PStatement& statement, mFullCompletionStatementList) {
+        entries.append(QPair<QString,PStatement>(statement->command.toCaseFolded(),statement));
+    }
+    std::sort(entries.begin(),entries.end(),
+              [](const QPair<QString,PStatement>& entry1,
+                 const QPair<QString,PStatement>& entry2) {
+        return entry1.first < entry2.first;
+    });
+    mIndexKeys.clear();
+    mIndexedStatements.clear();
+    mIndexKeys.reserve(entries.count());
+    mIndexedStatements.reserve(entries.count());
+    for (const QPair<QString,PStatement>& entry:entries) {
+        mIndexKeys.append(entry.first);
+        mIndexedStatements.append(entry.second);
+    }
+    mLastFilterValid = false;
 }
 
 void CodeCompletionPopup::getCompletionFor(
@@ -883,6 +940,9 @@ void CodeCompletionPopup::hideEvent(QHideEvent *event)
     mListView->setKeypressedCallback(nullptr);
     mCompletionStatementList.clear();
     mFullCompletionStatementList.clear();
+    mIndexKeys.clear();
+    mIndexedStatements.clear();
+    mLastFilterValid = false;
     mIncludedFiles.clear();
     mUsings.clear();
     mAddedStatements.clear();
@@ -96,6 +96,7 @@ private:
                      int line);
     void addStatement(PStatement statement, const QString& fileName, int line);
     void filterList(const QString& member);
+    void buildCompletionIndex();
     void getCompletionFor(
             const QStringList& ownerExpression,
             const QString& memberOperator,
@@ -112,6 +113,13 @@ private:
     //QList<PStatement> mCodeInsStatements; //temporary (user code template) statements created when show code suggestion
     StatementList mFullCompletionStatementList;
     StatementList mCompletionStatementList;
+    // mFullCompletionStatementList sorted by case folded command, built in prepareSearch
+    QStringList mIndexKeys;
+    StatementList mIndexedStatements;
+    // filter and result of the last filterList(), the next longer filter narrows it
+    QString mLastFilter;
+    bool mLastFilterValid;
+    bool mLastIgnoreCase;
     QSet<QString> mIncludedFiles;
     QSet<QString> mUsings;
     QSet<QString> mAddedStatements;
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "symbolquickopenpopup.h"
+#include "../iconsmanager.h"
+#include "../utils.h"
+
+#include <QKeyEvent>
+#include <QVBoxLayout>
+
+#define SYMBOL_QUICK_OPEN_MAX_RESULTS 200
+
+SymbolQuickOpenModel::SymbolQuickOpenModel(QObject *parent):
+    QAbstractListModel(parent)
+{
+
+}
+
+int SymbolQuickOpenModel::rowCount(const QModelIndex &) const
+{
+    return mResults.count();
+}
+
+QVariant SymbolQuickOpenModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+    if (index.row()<0 || index.row()>=mResults.count())
+        return QVariant();
+    const SymbolIndexEntry& entry = mResults[index.row()].entry;
+    switch (role) {
+    case Qt::DisplayRole: {
+        QString fileName = mBaseDir.isEmpty() ? entry.fileName
+                                              : extractRelativePath(mBaseDir,entry.fileName);
+        return QString("%1%2    %3:%4").arg(entry.fullName,entry.args,fileName).arg(entry.line);
+    }
+    case Qt::ToolTipRole:
+        return QString("%1 %2%3\n%4:%5").arg(entry.type,entry.fullName,entry.args,entry.fileName)
+                .arg(entry.line);
+    case Qt::DecorationRole:
+        switch (entry.kind) {
+        case StatementKind::skTypedef:
+        case StatementKind::skAlias:
+            return *(pIconsManager->getPixmap(IconsManager::PARSER_TYPE));
+        case StatementKind::skClass:
+            return *(pIconsManager->getPixmap(IconsManager::PARSER_CLASS));
+        case StatementKind::skNamespace:
+        case StatementKind::skNamespaceAlias:
+            return *(pIconsManager->getPixmap(IconsManager::PARSER_NAMESPACE));
+        case StatementKind::skPreprocessor:
+            return *(pIconsManager->getPixmap(IconsManager::PARSER_DEFINE));
+        case StatementKind::skEnumClassType:
+        case StatementKind::skEnumType:
+        case StatementKind::skEnum:
+            return *(pIconsManager->getPixmap(IconsManager::PARSER_ENUM));
+        case StatementKind::skFunction:
+        case StatementKind::skConstructor:
+        case StatementKind::skDestructor:
+        case StatementKind::skOperator:
+            if (entry.fullName == entry.name)
+                return *(pIconsManager->getPixmap(IconsManager::PARSER_GLOBAL_METHOD));
+            return *(pIconsManager->getPixmap(IconsManager::PARSER_PUBLIC_METHOD));
+        case StatementKind::skGlobalVariable:
+            return *(pIconsManager->getPixmap(IconsManager::PARSER_GLOBAL_VAR));
+        case StatementKind::skVariable:
+            if (entry.fullName == entry.name)
+                return *(pIconsManager->getPixmap(IconsManager::PARSER_GLOBAL_VAR));
+            return *(pIconsManager->getPixmap(IconsManager::PARSER_PUBLIC_VAR));
+        default:
+            break;
+        }
+        break;
+    }
+    return QVariant();
+}
+
+void SymbolQuickOpenModel::setResults(const QList<SymbolSearchResult> &results)
+{
+    beginResetModel();
+    mResults = results;
+    endResetModel();
+}
+
+const SymbolIndexEntry &SymbolQuickOpenModel::entry(int row) const
+{
+    return mResults[row].entry;
+}
+
+void SymbolQuickOpenModel::setBaseDir(const QString &newBaseDir)
+{
+    mBaseDir = newBaseDir;
+}
+
+SymbolQuickOpenPopup::SymbolQuickOpenPopup(QWidget *parent) : QWidget(parent)
+{
+    setWindowFlags(Qt::Popup);
+    mEdit = new QLineEdit(this);
+    mEdit->setPlaceholderText(tr("Type a symbol name, or ClassName::member"));
+    mListView = new QListView(this);
+    mListView->setFocusPolicy(Qt::NoFocus);
+    mListView->setUniformItemSizes(true);
+    mModel = new SymbolQuickOpenModel(this);
+    mListView->setModel(mModel);
+    setLayout(new QVBoxLayout());
+    layout()->addWidget(mEdit);
+    layout()->addWidget(mListView);
+    layout()->setMargin(2);
+
+    mEdit->installEventFilter(this);
+    connect(mEdit, &QLineEdit::textChanged,
+            this, &SymbolQuickOpenPopup::onTextChanged);
+    connect(mListView, &QListView::activated,
+            this, &SymbolQuickOpenPopup::onActivated);
+}
+
+void SymbolQuickOpenPopup::setSymbolIndex(const PSymbolIndex &newSymbolIndex)
+{
+    mSymbolIndex = newSymbolIndex;
+    mModel->setResults(QList<SymbolSearchResult>());
+}
+
+void SymbolQuickOpenPopup::setBaseDir(const QString &newBaseDir)
+{
+    mModel->setBaseDir(includeTrailingPathDelimiter(newBaseDir));
+}
+
+void SymbolQuickOpenPopup::showAt(const QRect &rect)
+{
+    setGeometry(rect);
+    show();
+    mEdit->setFocus();
+    if (mEdit->text().isEmpty())
+        onTextChanged(QString());
+    else
+        mEdit->selectAll();
+}
+
+bool SymbolQuickOpenPopup::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == mEdit && event->type() == QEvent::KeyPress) {
+        QKeyEvent* keyEvent = static_cast<QKeyEvent*>(event);
+        switch (keyEvent->key()) {
+        case Qt::Key_Up:
+            moveCurrent(-1);
+            return true;
+        case Qt::Key_Down:
+            moveCurrent(1);
+            return true;
+        case Qt::Key_PageUp:
+            moveCurrent(-10);
+            return true;
+        case Qt::Key_PageDown:
+            moveCurrent(10);
+            return true;
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+            onActivated(mListView->currentIndex());
+            return true;
+        case Qt::Key_Escape:
+            hide();
+            return true;
+        }
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+void SymbolQuickOpenPopup::onTextChanged(const QString &text)
+{
+    if (!mSymbolIndex) {
+        mModel->setResults(QList<SymbolSearchResult>());
+        return;
+    }
+    mModel->setResults(mSymbolIndex->search(text, SYMBOL_QUICK_OPEN_MAX_RESULTS));
+    if (mModel->rowCount(QModelIndex())>0)
+        mListView->setCurrentIndex(mModel->index(0,0));
+}
+
+void SymbolQuickOpenPopup::onActivated(const QModelIndex &index)
+{
+    if (!index.isValid())
+        return;
+    SymbolIndexEntry entry = mModel->entry(index.row());
+    hide();
+    emit symbolChosen(entry.fileName, entry.line);
+}
+
+void SymbolQuickOpenPopup::moveCurrent(int delta)
+{
+    int count = mModel->rowCount(QModelIndex());
+    if (count==0)
+        return;
+    int row = mListView->currentIndex().row() + delta;
+    row = std::max(0, std::min(row, count-1));
+    mListView->setCurrentIndex(mModel->index(row,0));
+}
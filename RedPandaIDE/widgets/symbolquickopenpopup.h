@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef SYMBOLQUICKOPENPOPUP_H
+#define SYMBOLQUICKOPENPOPUP_H
+
+#include <QAbstractListModel>
+#include <QLineEdit>
+#include <QListView>
+#include <QWidget>
+#include "../parser/symbolindex.h"
+
+class SymbolQuickOpenModel: public QAbstractListModel {
+    Q_OBJECT
+public:
+    explicit SymbolQuickOpenModel(QObject *parent = nullptr);
+    int rowCount(const QModelIndex &parent) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    void setResults(const QList<SymbolSearchResult>& results);
+    const SymbolIndexEntry& entry(int row) const;
+    void setBaseDir(const QString &newBaseDir);
+private:
+    QList<SymbolSearchResult> mResults;
+    QString mBaseDir;
+};
+
+/**
+ * @brief "Go to symbol" popup: fuzzy search the symbol index while typing
+ */
+class SymbolQuickOpenPopup : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit SymbolQuickOpenPopup(QWidget *parent = nullptr);
+    void setSymbolIndex(const PSymbolIndex &newSymbolIndex);
+    /**
+     * @brief file names are shown relative to the dir
+     */
+    void setBaseDir(const QString &newBaseDir);
+    void showAt(const QRect& rect);
+signals:
+    void symbolChosen(const QString& fileName, int line);
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+private slots:
+    void onTextChanged(const QString& text);
+    void onActivated(const QModelIndex& index);
+private:
+    void moveCurrent(int delta);
+private:
+    QLineEdit* mEdit;
+    QListView* mListView;
+    SymbolQuickOpenModel* mModel;
+    PSymbolIndex mSymbolIndex;
+};
+
+#endif // SYMBOLQUICKOPENPOPUP_H
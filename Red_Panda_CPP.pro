@@ -3,7 +3,8 @@ TEMPLATE = subdirs
 SUBDIRS += \
     RedPandaIDE \
     astyle \
-    consolepauser
+    consolepauser \
+    parserbenchmark
 
 APP_NAME = RedPandaCPP
 
@@ -0,0 +1,912 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Parser throughput and memory benchmark.
+ *
+ * Runs the preprocessor, the tokenizer and the whole CppParser over three corpora:
+ *  - stdlib:  all standard C++ headers of the compiler's include dirs
+ *  - cp:      a large single-file competitive programming template
+ *  - project: a synthetic 500-file project
+ * and writes lines/s, tokens/s, statements created, peak RSS and allocations as JSON.
+ * The "ranges" corpus scans a synthetic 100k-line file with the C++ highlighter, and
+ * compares keeping a copy of each line's range state with the editor's interned line store.
+ *
+ * Usage: parserbenchmark [--compiler g++] [--repeat 3] [--corpus stdlib,cp,project,ranges]
+ *                        [--range-lines 100000] [--output result.json]
+ */
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include "parser/cppparser.h"
+#include "parser/cpppreprocessor.h"
+#include "parser/cpptokenizer.h"
+#include "qsynedit/LineStore.h"
+#include "qsynedit/highlighter/cpp.h"
+#include "utils.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+/*
+ * Allocation counters.
+ *
+ * QString/QVector data is allocated with malloc() and not operator new, so on glibc
+ * the malloc family itself is replaced (operator new calls malloc there, too).
+ * On other platforms only operator new is counted.
+ */
+static std::atomic<quint64> allocationCount(0);
+static std::atomic<quint64> allocatedBytes(0);
+
+static inline void countAllocation(std::size_t size)
+{
+    allocationCount.fetch_add(1,std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size,std::memory_order_relaxed);
+}
+
+#ifdef __GLIBC__
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size)
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    countAllocation(count*size);
+    return __libc_calloc(count,size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    countAllocation(size);
+    return __libc_realloc(ptr,size);
+}
+}
+#else
+void* operator new(std::size_t size)
+{
+    countAllocation(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif
+
+/**
+ * @brief peak resident set size of the process, in KB. -1 if unknown.
+ */
+static qint64 peakRss()
+{
+#if defined(Q_OS_LINUX)
+    QFile file("/proc/self/status");
+    if (!file.open(QFile::ReadOnly))
+        return -1;
+    foreach (const QByteArray& line, file.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:"))
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+    }
+    return -1;
+#elif defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(),&counters,sizeof(counters)))
+        return -1;
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    return -1;
+#endif
+}
+
+/**
+ * @brief try to start a new peak RSS measurement (only possible on linux)
+ */
+static void resetPeakRss()
+{
+#if defined(Q_OS_LINUX)
+    QFile file("/proc/self/clear_refs");
+    if (file.open(QFile::WriteOnly))
+        file.write("5");
+#endif
+}
+
+/**
+ * @brief time, allocations and memory of one benchmarked action
+ */
+class Measure {
+public:
+    Measure() {
+        resetPeakRss();
+        mAllocations = allocationCount.load();
+        mAllocatedBytes = allocatedBytes.load();
+        mTimer.start();
+    }
+    QJsonObject finish() {
+        qint64 elapsed = mTimer.nsecsElapsed();
+        QJsonObject result;
+        mSeconds = elapsed / 1e9;
+        result["seconds"] = mSeconds;
+        result["allocations"] = (qint64)(allocationCount.load() - mAllocations);
+        result["allocatedBytes"] = (qint64)(allocatedBytes.load() - mAllocatedBytes);
+        result["peakRssKB"] = peakRss();
+        return result;
+    }
+    double seconds() const {
+        return mSeconds;
+    }
+private:
+    QElapsedTimer mTimer;
+    quint64 mAllocations;
+    quint64 mAllocatedBytes;
+    double mSeconds;
+};
+
+static double perSecond(qint64 count, double seconds)
+{
+    if (seconds<=0)
+        return 0;
+    return count/seconds;
+}
+
+/**
+ * @brief compiler configuration, queried the same way the IDE does for a compiler set
+ */
+struct CompilerInfo {
+    QStringList includeDirs;
+    QStringList defines;
+};
+
+static CompilerInfo queryCompiler(const QString& compiler)
+{
+    CompilerInfo info;
+    QProcess process;
+    process.start(compiler, {"-xc++","-E","-v","-"});
+    process.closeWriteChannel();
+    process.waitForFinished();
+    QStringList lines = QString::fromLocal8Bit(process.readAllStandardError()).split('\n');
+    bool inList = false;
+    foreach (const QString& line, lines) {
+        if (line.startsWith("#include <...> search starts here:")) {
+            inList = true;
+        } else if (line.startsWith("End of search list.")) {
+            inList = false;
+        } else if (inList) {
+            info.includeDirs.append(QDir::cleanPath(line.trimmed()));
+        }
+    }
+
+    process.start(compiler, {"-xc++","-dM","-E","-"});
+    process.closeWriteChannel();
+    process.waitForFinished();
+    foreach (const QString& line,
+             QString::fromLocal8Bit(process.readAllStandardOutput()).split('\n')) {
+        if (!line.trimmed().isEmpty())
+            info.defines.append(line.trimmed());
+    }
+    // same additional defines as resetCppParser()
+    info.defines.append("#define EGE_FOR_AUTO_CODE_COMPLETETION_ONLY");
+    info.defines.append("#define __FILE__  1");
+    info.defines.append("#define __LINE__  1");
+    info.defines.append("#define __DATE__  1");
+    info.defines.append("#define __TIME__  1");
+    return info;
+}
+
+static const QStringList StandardHeaders {
+    "algorithm", "any", "array", "atomic", "bitset", "cassert", "cctype", "cerrno",
+    "cfloat", "chrono", "climits", "cmath", "complex", "condition_variable", "cstddef",
+    "cstdint", "cstdio", "cstdlib", "cstring", "ctime", "deque", "exception",
+    "filesystem", "forward_list", "fstream", "functional", "future", "initializer_list",
+    "iomanip", "ios", "iosfwd", "iostream", "istream", "iterator", "limits", "list",
+    "locale", "map", "memory", "mutex", "new", "numeric", "optional", "ostream", "queue",
+    "random", "ratio", "regex", "set", "shared_mutex", "sstream", "stack", "stdexcept",
+    "streambuf", "string", "string_view", "system_error", "thread", "tuple",
+    "type_traits", "typeindex", "typeinfo", "unordered_map", "unordered_set", "utility",
+    "valarray", "variant", "vector"
+};
+
+/**
+ * @brief a benchmark corpus: the files parsed as one project, and the root files
+ * preprocessed and tokenized on their own
+ */
+struct Corpus {
+    QString name;
+    QStringList files;
+};
+
+static void writeFile(const QString& fileName, const QString& text)
+{
+    QFile file(fileName);
+    if (file.open(QFile::WriteOnly | QFile::Truncate))
+        file.write(text.toUtf8());
+}
+
+static Corpus createStdlibCorpus(const QString& dir, const CompilerInfo& compiler)
+{
+    QString text;
+    foreach (const QString& header, StandardHeaders) {
+        foreach (const QString& includeDir, compiler.includeDirs) {
+            if (QFile::exists(includeTrailingPathDelimiter(includeDir)+header)) {
+                text += QString("#include <%1>\n").arg(header);
+                break;
+            }
+        }
+    }
+    text += "int main() {\n    return 0;\n}\n";
+    QString fileName = includeTrailingPathDelimiter(dir)+"stdlib.cpp";
+    writeFile(fileName,text);
+    return Corpus{"stdlib",{fileName}};
+}
+
+static Corpus createCPCorpus(const QString& dir)
+{
+    QString text;
+    QTextStream out(&text);
+    out << "#include <bits/stdc++.h>\n"
+           "using namespace std;\n"
+           "typedef long long ll;\n"
+           "typedef unsigned long long ull;\n"
+           "typedef pair<int,int> pii;\n"
+           "typedef pair<ll,ll> pll;\n"
+           "typedef vector<int> vi;\n"
+           "typedef vector<ll> vll;\n"
+           "#define rep(i,a,b) for (int i=(a);i<(b);i++)\n"
+           "#define per(i,a,b) for (int i=(b)-1;i>=(a);i--)\n"
+           "#define all(x) (x).begin(),(x).end()\n"
+           "#define sz(x) ((int)(x).size())\n"
+           "#define pb push_back\n"
+           "#define mp make_pair\n"
+           "#define fi first\n"
+           "#define se second\n"
+           "const int MOD = 1000000007;\n"
+           "const int MAXN = 200005;\n"
+           "const ll INF = 0x3f3f3f3f3f3f3f3fLL;\n"
+           "\n"
+           "template<int M>\n"
+           "struct ModInt {\n"
+           "    int v;\n"
+           "    ModInt(ll x=0) { v = (int)((x%M+M)%M); }\n"
+           "    ModInt& operator+=(const ModInt& o) { v+=o.v; if (v>=M) v-=M; return *this; }\n"
+           "    ModInt& operator-=(const ModInt& o) { v-=o.v; if (v<0) v+=M; return *this; }\n"
+           "    ModInt& operator*=(const ModInt& o) { v=(int)((ll)v*o.v%M); return *this; }\n"
+           "    friend ModInt operator+(ModInt a, const ModInt& b) { return a+=b; }\n"
+           "    friend ModInt operator-(ModInt a, const ModInt& b) { return a-=b; }\n"
+           "    friend ModInt operator*(ModInt a, const ModInt& b) { return a*=b; }\n"
+           "    ModInt pow(ll e) const { ModInt r(1), b(*this); while (e) { if (e&1) r*=b; b*=b; e>>=1; } return r; }\n"
+           "    ModInt inv() const { return pow(M-2); }\n"
+           "};\n"
+           "using mint = ModInt<MOD>;\n"
+           "\n"
+           "struct DSU {\n"
+           "    vi parent, size;\n"
+           "    DSU(int n): parent(n), size(n,1) { iota(all(parent),0); }\n"
+           "    int find(int x) { return parent[x]==x ? x : parent[x]=find(parent[x]); }\n"
+           "    bool unite(int a, int b) {\n"
+           "        a=find(a); b=find(b);\n"
+           "        if (a==b) return false;\n"
+           "        if (size[a]<size[b]) swap(a,b);\n"
+           "        parent[b]=a; size[a]+=size[b];\n"
+           "        return true;\n"
+           "    }\n"
+           "};\n"
+           "\n"
+           "template<typename T>\n"
+           "struct Fenwick {\n"
+           "    int n; vector<T> tree;\n"
+           "    Fenwick(int n): n(n), tree(n+1) {}\n"
+           "    void add(int i, T v) { for (i++;i<=n;i+=i&-i) tree[i]+=v; }\n"
+           "    T sum(int i) { T s{}; for (i++;i>0;i-=i&-i) s+=tree[i]; return s; }\n"
+           "};\n"
+           "\n"
+           "template<typename T, typename Op>\n"
+           "struct SegTree {\n"
+           "    int n; vector<T> tree; T identity; Op op;\n"
+           "    SegTree(int n, T identity, Op op): n(n), tree(2*n,identity), identity(identity), op(op) {}\n"
+           "    void update(int p, T v) { for (tree[p+=n]=v;p>1;p>>=1) tree[p>>1]=op(tree[p],tree[p^1]); }\n"
+           "    T query(int l, int r) {\n"
+           "        T res=identity;\n"
+           "        for (l+=n,r+=n;l<r;l>>=1,r>>=1) {\n"
+           "            if (l&1) res=op(res,tree[l++]);\n"
+           "            if (r&1) res=op(res,tree[--r]);\n"
+           "        }\n"
+           "        return res;\n"
+           "    }\n"
+           "};\n"
+           "\n"
+           "struct Edge { int to; ll w; };\n"
+           "vector<Edge> graph[MAXN];\n"
+           "ll dist[MAXN];\n"
+           "void dijkstra(int s, int n) {\n"
+           "    fill(dist,dist+n,INF);\n"
+           "    priority_queue<pll,vector<pll>,greater<pll>> pq;\n"
+           "    dist[s]=0; pq.push(mp(0,s));\n"
+           "    while (!pq.empty()) {\n"
+           "        auto [d,u] = pq.top(); pq.pop();\n"
+           "        if (d>dist[u]) continue;\n"
+           "        for (const Edge& e: graph[u]) {\n"
+           "            if (dist[e.to]>d+e.w) { dist[e.to]=d+e.w; pq.push(mp(dist[e.to],e.to)); }\n"
+           "        }\n"
+           "    }\n"
+           "}\n"
+           "\n";
+    // the problem specific part, repeated to get a file of about 10k lines
+    for (int i=0;i<200;i++) {
+        out << QString("struct Node%1 {\n"
+                       "    int id;\n"
+                       "    ll value;\n"
+                       "    vector<int> children;\n"
+                       "    Node%1(int id=0, ll value=0): id(id), value(value) {}\n"
+                       "    bool operator<(const Node%1& other) const { return value<other.value; }\n"
+                       "    ll total() const { ll s=value; for (int c: children) s+=c; return s; }\n"
+                       "};\n"
+                       "\n"
+                       "namespace task%1 {\n"
+                       "    vector<Node%1> nodes;\n"
+                       "    map<int,ll> memo;\n"
+                       "    ll solve(int n, const vi& a) {\n"
+                       "        DSU dsu(n);\n"
+                       "        Fenwick<ll> fw(n);\n"
+                       "        mint answer = 0;\n"
+                       "        rep(i,0,n) {\n"
+                       "            fw.add(i,a[i]);\n"
+                       "            if (i>0 && a[i]==a[i-1]) dsu.unite(i,i-1);\n"
+                       "            answer += mint(fw.sum(i)) * mint(i+1);\n"
+                       "        }\n"
+                       "        nodes.clear();\n"
+                       "        rep(i,0,n) nodes.pb(Node%1(i,a[i]));\n"
+                       "        sort(all(nodes));\n"
+                       "        for (const auto& node: nodes) memo[node.id] = node.total();\n"
+                       "        return answer.v + sz(memo);\n"
+                       "    }\n"
+                       "}\n"
+                       "\n").arg(i);
+    }
+    out << "int main() {\n"
+           "    ios::sync_with_stdio(false);\n"
+           "    cin.tie(nullptr);\n"
+           "    int n; cin>>n;\n"
+           "    vi a(n);\n"
+           "    for (int& x: a) cin>>x;\n";
+    for (int i=0;i<200;i++) {
+        out << QString("    cout<<task%1::solve(n,a)<<'\\n';\n").arg(i);
+    }
+    out << "    return 0;\n"
+           "}\n";
+    out.flush();
+    QString fileName = includeTrailingPathDelimiter(dir)+"template.cpp";
+    writeFile(fileName,text);
+    return Corpus{"cp",{fileName}};
+}
+
+static Corpus createProjectCorpus(const QString& dir, int fileCount)
+{
+    Corpus corpus;
+    corpus.name = "project";
+    int moduleCount = fileCount / 2;
+    for (int i=0;i<moduleCount;i++) {
+        QString header;
+        QTextStream out(&header);
+        QString guard = QString("MODULE%1_H").arg(i);
+        out << "#ifndef " << guard << "\n"
+            << "#define " << guard << "\n";
+        if (i==0) {
+            out << "#include <string>\n"
+                   "#include <vector>\n";
+        } else {
+            out << QString("#include \"module%1.h\"\n").arg(i-1);
+            if (i/2 != i-1)
+                out << QString("#include \"module%1.h\"\n").arg(i/2);
+        }
+        out << QString("\n"
+                       "namespace project {\n"
+                       "\n"
+                       "enum class State%1 {\n"
+                       "    Idle,\n"
+                       "    Running,\n"
+                       "    Finished\n"
+                       "};\n"
+                       "\n"
+                       "struct Point%1 {\n"
+                       "    int x;\n"
+                       "    int y;\n"
+                       "};\n"
+                       "\n"
+                       "typedef std::vector<Point%1> Points%1;\n"
+                       "\n").arg(i);
+        if (i==0) {
+            out << "class Module0 {\n";
+        } else {
+            out << QString("class Module%1 : public Module%2 {\n").arg(i).arg(i/2);
+        }
+        out << QString("public:\n"
+                       "    explicit Module%1(const std::string& name);\n"
+                       "    virtual ~Module%1();\n"
+                       "    const std::string& name%1() const;\n"
+                       "    void setName%1(const std::string& name);\n"
+                       "    int count%1() const;\n"
+                       "    void addPoint%1(int x, int y);\n"
+                       "    State%1 state%1() const;\n"
+                       "    Points%1 points%1() const;\n"
+                       "private:\n"
+                       "    std::string mName%1;\n"
+                       "    Points%1 mPoints%1;\n"
+                       "    State%1 mState%1;\n"
+                       "};\n"
+                       "\n"
+                       "int helper%1(int value);\n"
+                       "\n"
+                       "}\n"
+                       "\n"
+                       "#endif\n").arg(i);
+        out.flush();
+        QString headerName = includeTrailingPathDelimiter(dir)+QString("module%1.h").arg(i);
+        writeFile(headerName,header);
+
+        QString source;
+        QTextStream sourceOut(&source);
+        sourceOut << QString("#include \"module%1.h\"\n"
+                             "\n"
+                             "namespace project {\n"
+                             "\n").arg(i);
+        if (i==0) {
+            sourceOut << "Module0::Module0(const std::string& name):\n";
+        } else {
+            sourceOut << QString("Module%1::Module%1(const std::string& name):\n"
+                                 "    Module%2(name),\n").arg(i).arg(i/2);
+        }
+        sourceOut << QString("    mName%1(name),\n"
+                             "    mState%1(State%1::Idle)\n"
+                             "{\n"
+                             "}\n"
+                             "\n"
+                             "Module%1::~Module%1()\n"
+                             "{\n"
+                             "}\n"
+                             "\n"
+                             "const std::string& Module%1::name%1() const\n"
+                             "{\n"
+                             "    return mName%1;\n"
+                             "}\n"
+                             "\n"
+                             "void Module%1::setName%1(const std::string& name)\n"
+                             "{\n"
+                             "    mName%1 = name;\n"
+                             "}\n"
+                             "\n"
+                             "int Module%1::count%1() const\n"
+                             "{\n"
+                             "    int result = 0;\n"
+                             "    for (const Point%1& point:mPoints%1) {\n"
+                             "        if (point.x>0 && point.y>0)\n"
+                             "            result++;\n"
+                             "    }\n"
+                             "    return result;\n"
+                             "}\n"
+                             "\n"
+                             "void Module%1::addPoint%1(int x, int y)\n"
+                             "{\n"
+                             "    Point%1 point;\n"
+                             "    point.x = helper%1(x);\n"
+                             "    point.y = helper%1(y);\n"
+                             "    mPoints%1.push_back(point);\n"
+                             "    mState%1 = State%1::Running;\n"
+                             "}\n"
+                             "\n"
+                             "State%1 Module%1::state%1() const\n"
+                             "{\n"
+                             "    return mState%1;\n"
+                             "}\n"
+                             "\n"
+                             "Points%1 Module%1::points%1() const\n"
+                             "{\n"
+                             "    return mPoints%1;\n"
+                             "}\n"
+                             "\n"
+                             "int helper%1(int value)\n"
+                             "{\n").arg(i);
+        if (i==0)
+            sourceOut << "    return value;\n";
+        else
+            sourceOut << QString("    return helper%1(value) + 1;\n").arg(i-1);
+        sourceOut << "}\n"
+                     "\n"
+                     "}\n";
+        sourceOut.flush();
+        QString sourceName = includeTrailingPathDelimiter(dir)+QString("module%1.cpp").arg(i);
+        writeFile(sourceName,source);
+        corpus.files.append(headerName);
+        corpus.files.append(sourceName);
+    }
+    return corpus;
+}
+
+static void setupParser(CppParser& parser, const CompilerInfo& compiler)
+{
+    parser.setEnabled(true);
+    parser.setParseGlobalHeaders(true);
+    parser.setParseLocalHeaders(true);
+    foreach (const QString& dir, compiler.includeDirs)
+        parser.addIncludePath(dir);
+    foreach (const QString& define, compiler.defines)
+        parser.addHardDefineByLine(define);
+    parser.parseHardDefines();
+}
+
+static void setupPreprocessor(CppPreprocessor& preprocessor, const CompilerInfo& compiler)
+{
+    preprocessor.setScanOptions(true,true);
+    foreach (const QString& dir, compiler.includeDirs)
+        preprocessor.addIncludePath(includeTrailingPathDelimiter(dir));
+    foreach (const QString& define, compiler.defines) {
+        if (define.startsWith('#'))
+            preprocessor.addHardDefineByLine(define.mid(1).trimmed());
+        else
+            preprocessor.addHardDefineByLine(define);
+    }
+}
+
+/**
+ * @brief the best (fastest) of the repeated runs
+ */
+static QJsonObject best(const QJsonObject& a, const QJsonObject& b)
+{
+    if (a.isEmpty() || b["seconds"].toDouble()<a["seconds"].toDouble())
+        return b;
+    return a;
+}
+
+/**
+ * @brief preprocess and tokenize each file of the corpus on its own. This covers macro
+ * expansion over the included headers, and the tokenizer alone.
+ */
+static QJsonObject benchmarkPreprocessAndTokenize(const Corpus& corpus, const CompilerInfo& compiler)
+{
+    QJsonObject result;
+    QList<QStringList> buffers;
+    {
+        CppPreprocessor preprocessor;
+        setupPreprocessor(preprocessor,compiler);
+        qint64 lines = 0;
+        Measure measure;
+        foreach (const QString& file, corpus.files) {
+            preprocessor.preprocess(file);
+            QStringList buffer = preprocessor.result();
+            preprocessor.clearResult();
+            preprocessor.reset();
+            lines += buffer.count();
+            buffers.append(buffer);
+        }
+        QJsonObject preprocess = measure.finish();
+        const PreprocessStatistics& statistics = preprocessor.statistics();
+        preprocess["linesRead"] = statistics.linesRead;
+        preprocess["filesRead"] = statistics.filesRead;
+        preprocess["includes"] = statistics.includes;
+        preprocess["ifEvaluations"] = statistics.ifEvaluations;
+        preprocess["ifCacheHits"] = statistics.ifCacheHits;
+        preprocess["linesOutput"] = lines;
+        preprocess["linesPerSecond"] = perSecond(statistics.linesRead,measure.seconds());
+        result["preprocess"] = preprocess;
+    }
+    {
+        CppTokenizer tokenizer;
+        qint64 tokens = 0;
+        Measure measure;
+        foreach (const QStringList& buffer, buffers) {
+            tokenizer.tokenize(buffer);
+            tokens += tokenizer.tokenCount();
+        }
+        tokenizer.reset();
+        QJsonObject tokenize = measure.finish();
+        tokenize["tokens"] = tokens;
+        tokenize["tokensPerSecond"] = perSecond(tokens,measure.seconds());
+        result["tokenize"] = tokenize;
+    }
+    return result;
+}
+
+/**
+ * @brief parse the whole corpus with a new parser, like a project is parsed in the IDE
+ */
+static QJsonObject benchmarkParse(const Corpus& corpus, const CompilerInfo& compiler,
+                                  std::unique_ptr<CppParser>& parser)
+{
+    parser = std::unique_ptr<CppParser>(new CppParser());
+    setupParser(*parser,compiler);
+    Measure measure;
+    if (corpus.files.count()==1) {
+        parser->parseFile(corpus.files.first(),true,false,false);
+    } else {
+        foreach (const QString& file, corpus.files)
+            parser->addFileToScan(file,true);
+        parser->parseFileList(false);
+    }
+    QJsonObject result = measure.finish();
+    PreprocessStatistics statistics = parser->preprocessStatistics();
+    result["files"] = parser->scannedFiles().count();
+    result["linesRead"] = statistics.linesRead;
+    result["linesPerSecond"] = perSecond(statistics.linesRead,measure.seconds());
+    result["statements"] = parser->statementList().count();
+    return result;
+}
+
+/**
+ * @brief look up every identifier of the file, like hover tips and go to definition do
+ */
+static QJsonObject benchmarkFindStatementOf(const QString& fileName, CppParser& parser)
+{
+    QStringList lines = readFileToLines(fileName);
+    QRegularExpression identifier("[A-Za-z_][A-Za-z0-9_]*");
+    qint64 lookups = 0;
+    qint64 found = 0;
+    Measure measure;
+    for (int i=0;i<lines.count();i++) {
+        QRegularExpressionMatchIterator it = identifier.globalMatch(lines[i]);
+        while (it.hasNext()) {
+            QRegularExpressionMatch match = it.next();
+            lookups++;
+            if (parser.findStatementOf(fileName,match.captured(),i+1))
+                found++;
+        }
+    }
+    QJsonObject result = measure.finish();
+    result["lookups"] = lookups;
+    result["found"] = found;
+    result["lookupsPerSecond"] = perSecond(lookups,measure.seconds());
+    return result;
+}
+
+/**
+ * @brief a C++ file of (at least) lineCount lines, with nested blocks, comments and
+ * unclosed parenthesis, so the lines are in different range states
+ */
+static QStringList createRangeStateLines(int lineCount)
+{
+    QStringList lines;
+    for (int i=0;lines.count()<lineCount;i++) {
+        lines.append(QString("namespace ns%1 {").arg(i));
+        lines.append("/*");
+        lines.append(QString(" * block comment %1").arg(i));
+        lines.append(" */");
+        lines.append(QString("class Class%1 {").arg(i));
+        lines.append("public:");
+        lines.append(QString("    int method%1(const std::vector<int>& values) {").arg(i));
+        lines.append("        for (int j=0;j<values.size();j++) {");
+        lines.append("            if (j%2==0) {");
+        lines.append(QString("                mNames.push_back(std::make_pair(j,\"value %1\"));").arg(i));
+        lines.append("            } else {");
+        lines.append("                mTotal += compute(j,");
+        lines.append("                                  values[j],");
+        lines.append("                                  (j+1));");
+        lines.append("            }");
+        lines.append("        }");
+        lines.append("        return mTotal; // the total");
+        lines.append("    }");
+        lines.append("private:");
+        lines.append("    int mTotal;");
+        lines.append("};");
+        lines.append("}");
+        lines.append("");
+    }
+    return lines;
+}
+
+template<typename SetRange>
+static void scanRangeStates(SynHighlighter& highlighter, const QStringList& lines, SetRange setRange)
+{
+    highlighter.resetState();
+    for (int i=0;i<lines.count();i++) {
+        highlighter.setLine(lines[i],i);
+        highlighter.nextToEol();
+        setRange(i,highlighter.getRangeState());
+    }
+}
+
+/**
+ * @brief scan the lines with the C++ highlighter like the editor does after loading the
+ * file ("scan"), and after a brace is typed at its first line ("rescan"), which changes
+ * the state of every line. The states are kept either as one copy per line ("copied"),
+ * or in the editor's line store, which interns them ("interned").
+ */
+static QJsonObject benchmarkRangeStates(const QStringList& lines)
+{
+    QJsonObject result;
+    SynEditCppHighlighter highlighter;
+    QStringList editedLines = lines;
+    editedLines[0] = "{" + editedLines[0];
+    {
+        QVector<SynRangeState> ranges(lines.count());
+        auto setRange = [&ranges](int index, const SynRangeState& range) {
+            ranges[index] = range;
+        };
+        Measure scan;
+        scanRangeStates(highlighter,lines,setRange);
+        result["copiedScan"] = scan.finish();
+        Measure rescan;
+        scanRangeStates(highlighter,editedLines,setRange);
+        result["copiedRescan"] = rescan.finish();
+    }
+    {
+        SynEditLineStore store;
+        store.insertLines(0,lines.count());
+        auto setRange = [&store](int index, const SynRangeState& range) {
+            store.setRange(index,range);
+        };
+        Measure scan;
+        scanRangeStates(highlighter,lines,setRange);
+        result["internedScan"] = scan.finish();
+        Measure rescan;
+        scanRangeStates(highlighter,editedLines,setRange);
+        result["internedRescan"] = rescan.finish();
+    }
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser cmdParser;
+    cmdParser.setApplicationDescription("Red Panda C++ parser benchmark");
+    cmdParser.addHelpOption();
+    QCommandLineOption compilerOption("compiler","compiler to get include dirs and defines from","compiler","g++");
+    QCommandLineOption repeatOption("repeat","number of runs, the fastest one is reported","count","3");
+    QCommandLineOption corpusOption("corpus","corpora to run (stdlib,cp,project,ranges)","corpus","stdlib,cp,project,ranges");
+    QCommandLineOption filesOption("project-files","number of files in the synthetic project","count","500");
+    QCommandLineOption rangeLinesOption("range-lines","number of lines scanned by the ranges corpus","count","100000");
+    QCommandLineOption outputOption("output","write the JSON result to file instead of stdout","file");
+    cmdParser.addOption(compilerOption);
+    cmdParser.addOption(repeatOption);
+    cmdParser.addOption(corpusOption);
+    cmdParser.addOption(filesOption);
+    cmdParser.addOption(rangeLinesOption);
+    cmdParser.addOption(outputOption);
+    cmdParser.process(app);
+
+    int repeat = std::max(1,cmdParser.value(repeatOption).toInt());
+    QStringList corpusNames = cmdParser.value(corpusOption).split(',',QString::SkipEmptyParts);
+    CompilerInfo compiler = queryCompiler(cmdParser.value(compilerOption));
+    if (compiler.includeDirs.isEmpty()) {
+        fprintf(stderr,"Can't get include dirs from compiler '%s'.\n",
+                cmdParser.value(compilerOption).toLocal8Bit().constData());
+        return 1;
+    }
+
+    QTemporaryDir tempDir;
+    if (!tempDir.isValid()) {
+        fprintf(stderr,"Can't create temporary dir.\n");
+        return 1;
+    }
+    QList<Corpus> corpora;
+    if (corpusNames.contains("stdlib"))
+        corpora.append(createStdlibCorpus(tempDir.path(),compiler));
+    if (corpusNames.contains("cp"))
+        corpora.append(createCPCorpus(tempDir.path()));
+    if (corpusNames.contains("project")) {
+        QString projectDir = includeTrailingPathDelimiter(tempDir.path())+"project";
+        QDir().mkpath(projectDir);
+        corpora.append(createProjectCorpus(projectDir,cmdParser.value(filesOption).toInt()));
+    }
+
+    QJsonArray corpusResults;
+    foreach (const Corpus& corpus, corpora) {
+        fprintf(stderr,"%s: %d file(s)\n",corpus.name.toLocal8Bit().constData(),corpus.files.count());
+        QJsonObject preprocess;
+        QJsonObject tokenize;
+        QJsonObject parse;
+        QJsonObject findStatementOf;
+        for (int i=0;i<repeat;i++) {
+            QJsonObject stages = benchmarkPreprocessAndTokenize(corpus,compiler);
+            preprocess = best(preprocess,stages["preprocess"].toObject());
+            tokenize = best(tokenize,stages["tokenize"].toObject());
+            std::unique_ptr<CppParser> parser;
+            parse = best(parse,benchmarkParse(corpus,compiler,parser));
+            if (corpus.name == "cp")
+                findStatementOf = best(findStatementOf,benchmarkFindStatementOf(corpus.files.first(),*parser));
+        }
+        QJsonObject result;
+        result["name"] = corpus.name;
+        result["files"] = corpus.files.count();
+        result["preprocess"] = preprocess;
+        result["tokenize"] = tokenize;
+        result["parse"] = parse;
+        if (!findStatementOf.isEmpty())
+            result["findStatementOf"] = findStatementOf;
+        corpusResults.append(result);
+    }
+    if (corpusNames.contains("ranges")) {
+        QStringList lines = createRangeStateLines(std::max(1,cmdParser.value(rangeLinesOption).toInt()));
+        fprintf(stderr,"ranges: %d line(s)\n",lines.count());
+        QJsonObject stages;
+        for (int i=0;i<repeat;i++) {
+            QJsonObject runStages = benchmarkRangeStates(lines);
+            foreach (const QString& key, runStages.keys())
+                stages[key] = best(stages[key].toObject(),runStages[key].toObject());
+        }
+        QJsonObject result = stages;
+        result["name"] = "ranges";
+        result["lines"] = lines.count();
+        corpusResults.append(result);
+    }
+
+    QJsonObject root;
+    root["compiler"] = cmdParser.value(compilerOption);
+    root["includeDirs"] = QJsonArray::fromStringList(compiler.includeDirs);
+    root["repeat"] = repeat;
+#ifdef __GLIBC__
+    root["allocationCounting"] = "malloc";
+#else
+    root["allocationCounting"] = "operator new";
+#endif
+    root["corpora"] = corpusResults;
+    root["peakRssKB"] = peakRss();
+    QByteArray json = QJsonDocument(root).toJson();
+    if (cmdParser.isSet(outputOption)) {
+        QFile file(cmdParser.value(outputOption));
+        if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+            fprintf(stderr,"Can't write to '%s'.\n",file.fileName().toLocal8Bit().constData());
+            return 1;
+        }
+        file.write(json);
+    } else {
+        fwrite(json.constData(),1,json.size(),stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+# the syntax highlighter used by the parser needs QtGui (QColor), but no widgets
+QT += core gui concurrent
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# Headless benchmark of the code parser (preprocessor, tokenizer and CppParser),
+# and of the range states the editor keeps for the highlighter.
+# It's built from the parser sources of RedPandaIDE and never installed.
+IDE_DIR = $$PWD/../RedPandaIDE
+
+INCLUDEPATH += $${IDE_DIR}
+
+gcc {
+    QMAKE_CXXFLAGS_RELEASE += -Werror=return-type
+    QMAKE_CXXFLAGS_DEBUG += -Werror=return-type
+}
+
+SOURCES += \
+    main.cpp \
+    $${IDE_DIR}/fileutils.cpp \
+    $${IDE_DIR}/parser/cppparser.cpp \
+    $${IDE_DIR}/parser/cpppreprocessor.cpp \
+    $${IDE_DIR}/parser/cppsystemheaderstore.cpp \
+    $${IDE_DIR}/parser/cpptokenizer.cpp \
+    $${IDE_DIR}/parser/parserutils.cpp \
+    $${IDE_DIR}/parser/statementmodel.cpp \
+    $${IDE_DIR}/parser/symbolindex.cpp \
+    $${IDE_DIR}/qsynedit/Constants.cpp \
+    $${IDE_DIR}/qsynedit/LineStore.cpp \
+    $${IDE_DIR}/qsynedit/highlighter/base.cpp \
+    $${IDE_DIR}/qsynedit/highlighter/cpp.cpp
+
+HEADERS += \
+    $${IDE_DIR}/utils.h \
+    $${IDE_DIR}/parser/cppparser.h \
+    $${IDE_DIR}/parser/cpppreprocessor.h \
+    $${IDE_DIR}/parser/cppsystemheaderstore.h \
+    $${IDE_DIR}/parser/cpptokenizer.h \
+    $${IDE_DIR}/parser/parserutils.h \
+    $${IDE_DIR}/parser/statementmodel.h \
+    $${IDE_DIR}/parser/symbolindex.h \
+    $${IDE_DIR}/qsynedit/Constants.h \
+    $${IDE_DIR}/qsynedit/LineStore.h \
+    $${IDE_DIR}/qsynedit/highlighter/base.h \
+    $${IDE_DIR}/qsynedit/highlighter/cpp.h
+
+win32: {
+    LIBS+= \
+        -lpsapi
+}